@@ -7,5 +7,7 @@
 
 namespace ASMJS
 {
-	void print(std::ostream& outputStream,const AST::Module* module);
+	// Prints a module as ASM.JS. The module's functions are lowered and printed on numThreads threads, but are written to outputStream
+	// in the same order as printing them on a single thread would.
+	void print(std::ostream& outputStream,const AST::Module* module,uintptr_t numThreads = 1);
 }
\ No newline at end of file
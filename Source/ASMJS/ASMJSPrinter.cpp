@@ -1,5 +1,6 @@
 #include "Core/Core.h"
 #include "Core/MemoryArena.h"
+#include "Core/Parallel.h"
 #include "Core/SExpressions.h"
 #include "AST/AST.h"
 #include "AST/ASTExpressions.h"
@@ -90,7 +91,7 @@ namespace ASMJS
 		uintptr_t createLocalVariable(TypeId type)
 		{
 			auto index = function->locals.size();
-			function->locals.push_back({type,nullptr});
+			function->locals.push_back(arena,{type,nullptr});
 			return index;
 		}
 
@@ -116,7 +117,7 @@ namespace ASMJS
 			auto address = dispatch(*this,load->address,load->isFarAddress ? TypeId::I64 : TypeId::I32);
 			return LoweredExpression(
 				address.statements,
-				TypedExpression(new(arena) Load<Class>(load->op(),load->isFarAddress,load->isAligned,as<IntClass>(address.value),load->memoryType),type)
+				TypedExpression(new(arena) Load<Class>(load->op(),load->isFarAddress,load->alignmentLog2,as<IntClass>(address.value),load->memoryType),type)
 				);
 		}
 		template<typename Class>
@@ -126,7 +127,7 @@ namespace ASMJS
 			auto value = dispatch(*this,store->value);
 			return LoweredExpression(
 				concatStatements(arena,address.statements,value.statements),
-				TypedExpression(new(arena) Store<Class>(store->isFarAddress,store->isAligned,as<IntClass>(address.value),value.value,store->memoryType),value.value.type)
+				TypedExpression(new(arena) Store<Class>(store->isFarAddress,store->alignmentLog2,as<IntClass>(address.value),value.value,store->memoryType),value.value.type)
 				);
 		}
 
@@ -167,8 +168,8 @@ namespace ASMJS
 			const FunctionType* functionType;
 			switch(call->op())
 			{
-			case AnyOp::callDirect: functionType = &module->functions[call->functionIndex]->type; break;
-			case AnyOp::callImport: functionType = &module->functionImports[call->functionIndex].type; break;
+			case AnyOp::callDirect: functionType = module->functions[call->functionIndex]->type; break;
+			case AnyOp::callImport: functionType = module->functionImports[call->functionIndex].type; break;
 			default: throw;
 			}
 
@@ -191,17 +192,17 @@ namespace ASMJS
 		}
 		LoweredExpression visitCallIndirect(TypeId type,const CallIndirect* callIndirect)
 		{
-			const FunctionType& functionType = module->functionTables[callIndirect->tableIndex].type;
+			const FunctionType* functionType = module->functionTables[callIndirect->tableIndex].type;
 			
 			// Lower the function index.
 			auto functionIndex = dispatch(*this,callIndirect->functionIndex,TypeId::I32);
 			VoidExpression* statements = functionIndex.statements;
 
 			// Lower the call parameters.
-			auto parameters = new(arena) UntypedExpression*[functionType.parameters.size()];
-			for(uintptr_t parameterIndex = 0;parameterIndex < functionType.parameters.size();++parameterIndex)
+			auto parameters = new(arena) UntypedExpression*[functionType->parameters.size()];
+			for(uintptr_t parameterIndex = 0;parameterIndex < functionType->parameters.size();++parameterIndex)
 			{
-				auto parameterType = functionType.parameters[parameterIndex];
+				auto parameterType = functionType->parameters[parameterIndex];
 				auto parameter = dispatch(*this,callIndirect->parameters[parameterIndex],parameterType);
 				parameters[parameterIndex] = parameter.value.expression;
 				statements = concatStatements(arena,statements,parameter.statements);
@@ -315,8 +316,8 @@ namespace ASMJS
 		template<typename Class>
 		LoweredExpression visitReturn(TypeId type,const Return<Class>* ret)
 		{
-			auto value = function->type.returnType == TypeId::Void ? LoweredExpression()
-				: dispatch(*this,ret->value,function->type.returnType);
+			auto value = function->type->returnType == TypeId::Void ? LoweredExpression()
+				: dispatch(*this,ret->value,function->type->returnType);
 			return LoweredExpression(concatStatements(arena,value.statements,new(arena) Return<VoidClass>(value.value.expression)));
 		}
 		template<typename Class>
@@ -379,14 +380,159 @@ namespace ASMJS
 			auto expression = dispatch(*this,discardResult->expression);
 			return LoweredExpression(concatStatements(arena,expression.statements,new(arena) DiscardResult(expression.value)));
 		}
+
+		// Helpers for building the byte loops that bulk memory operations are lowered to.
+		Expression<IntClass>* getIntLocal(uintptr_t localIndex)
+		{
+			return as<IntClass>(new(arena) GetVariable(AnyOp::getLocal,TypeClassId::Int,localIndex));
+		}
+		VoidExpression* setIntLocal(uintptr_t localIndex,Expression<IntClass>* value)
+		{
+			return as<VoidClass>(new(arena) SetVariable(AnyOp::setLocal,TypeClassId::Void,value,localIndex));
+		}
+		VoidExpression* addToIntLocal(uintptr_t localIndex,IntOp op)
+		{
+			return setIntLocal(localIndex,new(arena) Binary<IntClass>(op,getIntLocal(localIndex),new(arena) Literal<I32Type>(1)));
+		}
+		VoidExpression* storeByte(Expression<IntClass>* address,Expression<IntClass>* value)
+		{
+			return new(arena) DiscardResult(TypedExpression(new(arena) Store<IntClass>(false,0,address,TypedExpression(value,TypeId::I32),TypeId::I8),TypeId::I32));
+		}
+		Expression<IntClass>* loadByte(Expression<IntClass>* address)
+		{
+			return new(arena) Load<IntClass>(IntOp::loadZExt,false,0,address,TypeId::I8);
+		}
+		// Creates a loop that exits when the byte count local is zero, and otherwise executes body.
+		VoidExpression* createByteLoop(uintptr_t numBytesLocalIndex,BranchTarget* breakTarget,VoidExpression* body)
+		{
+			auto continueTarget = new(arena) BranchTarget(TypeId::Void);
+			auto isDone = new(arena) Comparison(BoolOp::eq,TypeId::I32,getIntLocal(numBytesLocalIndex),new(arena) Literal<I32Type>(0));
+			auto exitIfDone = new(arena) IfElse<VoidClass>(isDone,new(arena) Branch<VoidClass>(breakTarget,nullptr),Nop::get());
+			return new(arena) Loop<VoidClass>(new(arena) Sequence<VoidClass>(exitIfDone,body),breakTarget,continueTarget);
+		}
+		
+		// ASM.JS doesn't have bulk memory operations, so lower them to byte loops.
+		LoweredExpression visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			auto destAddress = dispatch(*this,bulkMemory->destAddress,TypeId::I32);
+			auto source = dispatch(*this,bulkMemory->source,TypeId::I32);
+			auto numBytes = dispatch(*this,bulkMemory->numBytes,TypeId::I32);
+
+			// Evaluate the operands into local variables.
+			auto destLocalIndex = createLocalVariable(TypeId::I32);
+			auto sourceLocalIndex = createLocalVariable(TypeId::I32);
+			auto numBytesLocalIndex = createLocalVariable(TypeId::I32);
+			VoidExpression* statements = setValueToLocal(arena,destAddress,destLocalIndex);
+			statements = concatStatements(arena,statements,setValueToLocal(arena,source,sourceLocalIndex));
+			statements = concatStatements(arena,statements,setValueToLocal(arena,numBytes,numBytesLocalIndex));
+
+			// Iterate backward from the end of the range: n = n - 1; dest[n] = source[n] (or the fill value).
+			auto backwardLoop = createByteLoop(numBytesLocalIndex,new(arena) BranchTarget(TypeId::Void),
+				new(arena) Sequence<VoidClass>(
+					addToIntLocal(numBytesLocalIndex,IntOp::sub),
+					storeByte(
+						new(arena) Binary<IntClass>(IntOp::add,getIntLocal(destLocalIndex),getIntLocal(numBytesLocalIndex)),
+						bulkMemory->op() == VoidOp::fillMemory ? getIntLocal(sourceLocalIndex)
+							: loadByte(new(arena) Binary<IntClass>(IntOp::add,getIntLocal(sourceLocalIndex),getIntLocal(numBytesLocalIndex)))
+						)
+					));
+			if(bulkMemory->op() == VoidOp::fillMemory) { return LoweredExpression(concatStatements(arena,statements,backwardLoop)); }
+
+			// Copies and moves iterate backward if the destination is above the source, and forward otherwise, so overlapping ranges are handled.
+			auto forwardLoop = createByteLoop(numBytesLocalIndex,new(arena) BranchTarget(TypeId::Void),
+				new(arena) Sequence<VoidClass>(
+					storeByte(getIntLocal(destLocalIndex),loadByte(getIntLocal(sourceLocalIndex))),
+					new(arena) Sequence<VoidClass>(
+						new(arena) Sequence<VoidClass>(addToIntLocal(destLocalIndex,IntOp::add),addToIntLocal(sourceLocalIndex,IntOp::add)),
+						addToIntLocal(numBytesLocalIndex,IntOp::sub)
+						)
+					));
+			auto isDestAboveSource = new(arena) Comparison(BoolOp::gtu,TypeId::I32,getIntLocal(destLocalIndex),getIntLocal(sourceLocalIndex));
+			return LoweredExpression(concatStatements(arena,statements,new(arena) IfElse<VoidClass>(isDestAboveSource,backwardLoop,forwardLoop)));
+		}
+
+		// ASM.JS code runs on a single thread, so lower atomic operations to ordinary loads and stores.
+		// atomicWait can't be woken by another thread, so it results in "not-equal" or "timed-out" without blocking.
+		template<typename OpAsType>
+		LoweredExpression visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			auto op = atomic->op();
+			auto memoryType = Atomic::getOperandType(op,type);
+
+			// Evaluate the operands into local variables.
+			auto addressLocalIndex = createLocalVariable(TypeId::I32);
+			VoidExpression* statements = setValueToLocal(arena,dispatch(*this,atomic->address,TypeId::I32),addressLocalIndex);
+			uintptr_t operandLocalIndex = 0;
+			if(atomic->operand)
+			{
+				operandLocalIndex = createLocalVariable(memoryType);
+				statements = concatStatements(arena,statements,setValueToLocal(arena,dispatch(*this,atomic->operand,memoryType),operandLocalIndex));
+			}
+			uintptr_t replacementLocalIndex = 0;
+			if(atomic->replacement)
+			{
+				auto replacementType = Atomic::getReplacementType(op,type);
+				replacementLocalIndex = createLocalVariable(replacementType);
+				statements = concatStatements(arena,statements,setValueToLocal(arena,dispatch(*this,atomic->replacement,replacementType),replacementLocalIndex));
+			}
+
+			auto load = new(arena) Load<IntClass>(IntOp::load,false,getNaturalAlignmentLog2(memoryType),getIntLocal(addressLocalIndex),memoryType);
+			auto store = [&](Expression<IntClass>* value) -> VoidExpression*
+				{ return new(arena) DiscardResult(TypedExpression(new(arena) Store<IntClass>(false,getNaturalAlignmentLog2(memoryType),getIntLocal(addressLocalIndex),TypedExpression(value,memoryType),memoryType),memoryType)); };
+			if(op == IntOp::atomicLoad) { return LoweredExpression(statements,TypedExpression(load,type)); }
+			else if(op == IntOp::atomicStore) { return LoweredExpression(concatStatements(arena,statements,store(getIntLocal(operandLocalIndex))),TypedExpression(getIntLocal(operandLocalIndex),type)); }
+			else if(op == IntOp::atomicNotify) { return LoweredExpression(statements,TypedExpression(new(arena) Literal<I32Type>(0),type)); }
+
+			// The remaining ops read the old value from memory into a local variable, and result in some function of it.
+			auto oldValueLocalIndex = createLocalVariable(memoryType);
+			statements = concatStatements(arena,statements,setValueToLocal(arena,TypedExpression(load,memoryType),oldValueLocalIndex));
+			VoidExpression* update = nullptr;
+			switch(op)
+			{
+			case IntOp::atomicAdd: update = store(new(arena) Binary<IntClass>(IntOp::add,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex))); break;
+			case IntOp::atomicSub: update = store(new(arena) Binary<IntClass>(IntOp::sub,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex))); break;
+			case IntOp::atomicAnd: update = store(new(arena) Binary<IntClass>(IntOp::bitwiseAnd,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex))); break;
+			case IntOp::atomicOr: update = store(new(arena) Binary<IntClass>(IntOp::bitwiseOr,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex))); break;
+			case IntOp::atomicXor: update = store(new(arena) Binary<IntClass>(IntOp::bitwiseXor,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex))); break;
+			case IntOp::atomicExchange: update = store(getIntLocal(operandLocalIndex)); break;
+			case IntOp::atomicCompareExchange:
+			{
+				auto isExpectedValue = new(arena) Comparison(BoolOp::eq,memoryType,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex));
+				update = new(arena) IfElse<VoidClass>(isExpectedValue,store(getIntLocal(replacementLocalIndex)),Nop::get());
+				break;
+			}
+			case IntOp::atomicWait:
+			{
+				auto resultLocalIndex = createLocalVariable(TypeId::I32);
+				auto isExpectedValue = new(arena) Comparison(BoolOp::eq,TypeId::I32,getIntLocal(oldValueLocalIndex),getIntLocal(operandLocalIndex));
+				auto setResult = new(arena) IfElse<VoidClass>(isExpectedValue,
+					setIntLocal(resultLocalIndex,new(arena) Literal<I32Type>(2)),
+					setIntLocal(resultLocalIndex,new(arena) Literal<I32Type>(1)));
+				return LoweredExpression(concatStatements(arena,statements,setResult),TypedExpression(getIntLocal(resultLocalIndex),type));
+			}
+			default: throw;
+			}
+			return LoweredExpression(concatStatements(arena,statements,update),TypedExpression(getIntLocal(oldValueLocalIndex),type));
+		}
+
+		// ASM.JS doesn't have a 128-bit vector type, so V128 operations aren't supported.
+		template<typename OpAsType>
+		LoweredExpression visitLaneUnary(const LaneUnary* laneUnary,OpAsType) { throw; }
+		template<typename OpAsType>
+		LoweredExpression visitLaneBinary(const LaneBinary* laneBinary,OpAsType) { throw; }
+		LoweredExpression visitSplat(const Splat* splat) { throw; }
+		template<typename Class>
+		LoweredExpression visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane) { throw; }
+		LoweredExpression visitReplaceLane(const ReplaceLane* replaceLane) { throw; }
+		LoweredExpression visitShuffle(const Shuffle* shuffle) { throw; }
 	};
 	
 	// Lowers a function into the subset of the AST's semantics that ASM.JS supports.
 	Function lowerFunction(Memory::Arena& arena,const AST::Module* module,const Function& inFunction)
 	{
-		Function loweredFunction = inFunction;
+		Function loweredFunction(arena,inFunction);
 		LoweringVisitor loweringVisitor(arena,module,&loweredFunction);
-		auto returnType = loweredFunction.type.returnType;
+		auto returnType = loweredFunction.type->returnType;
 		auto loweredExpression = loweringVisitor(TypedExpression(loweredFunction.expression,returnType));
 		VoidExpression* loweredStatements = nullptr;
 		if(returnType == TypeId::Void) { loweredStatements = sequenceValue(arena,loweredExpression); }
@@ -546,8 +692,10 @@ namespace ASMJS
 		const Module* module;
 		std::ostream& out;
 
-		ModulePrintContext(const Module* inModule,std::ostream& inOutputStream)
-		: module(inModule), out(inOutputStream) {}
+		uintptr_t numThreads;
+
+		ModulePrintContext(const Module* inModule,std::ostream& inOutputStream,uintptr_t inNumThreads = 1)
+		: module(inModule), out(inOutputStream), numThreads(inNumThreads) {}
 		
 		std::ostream& printGlobalName(uintptr_t variableIndex) const
 		{
@@ -715,13 +863,13 @@ namespace ASMJS
 			const FunctionType* functionType;
 			if(call->op() == AnyOp::callDirect)
 			{
-				functionType = &module->functions[call->functionIndex]->type;
+				functionType = module->functions[call->functionIndex]->type;
 				printCoercePrefix(out,functionType->returnType);
 				moduleContext.printFunctionName(call->functionIndex);
 			}
 			else
 			{
-				functionType = &module->functionImports[call->functionIndex].type;
+				functionType = module->functionImports[call->functionIndex].type;
 				printCoercePrefix(out,functionType->returnType);
 				moduleContext.printFunctionImportName(call->functionIndex);
 			}
@@ -731,15 +879,15 @@ namespace ASMJS
 		}
 		DispatchResult visitCallIndirect(TypeId type,const CallIndirect* callIndirect)
 		{
-			auto& functionType = module->functionTables[callIndirect->tableIndex].type;
-			printCoercePrefix(out,functionType.returnType);
+			auto functionType = module->functionTables[callIndirect->tableIndex].type;
+			printCoercePrefix(out,functionType->returnType);
 			moduleContext.printFunctionTableName(callIndirect->tableIndex);
 			out << '[';
 			printCoercePrefix(out,TypeId::I32);
 			dispatch(*this,callIndirect->functionIndex,TypeId::I32);
 			out << ']';
-			compileCallParameters(functionType.parameters,callIndirect->parameters);
-			printCoerceSuffix(out,functionType.returnType);
+			compileCallParameters(functionType->parameters,callIndirect->parameters);
+			printCoerceSuffix(out,functionType->returnType);
 			return out;
 		}
 		
@@ -793,7 +941,7 @@ namespace ASMJS
 		DispatchResult visitReturn(TypeId type,const Return<Class>* ret)
 		{
 			out << "return";
-			if(function->type.returnType != TypeId::Void) { out << " "; dispatch(*this,ret->value,function->type.returnType); };
+			if(function->type->returnType != TypeId::Void) { out << " "; dispatch(*this,ret->value,function->type->returnType); };
 			return out;
 		}
 		template<typename Class>
@@ -830,6 +978,33 @@ namespace ASMJS
 		{
 			return dispatch(*this,discardResult->expression);
 		}
+		DispatchResult visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			// Bulk memory operations are lowered to loops by the LoweringVisitor.
+			throw;
+		}
+		template<typename OpAsType>
+		DispatchResult visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			// Atomic operations are lowered to loads and stores by the LoweringVisitor.
+			throw;
+		}
+
+		// The LoweringVisitor rejects V128 operations.
+		DispatchResult visitLiteral(const Literal<V128Type>* literal) { throw; }
+		template<typename OpAsType>
+		DispatchResult visitUnary(TypeId type,const Unary<V128Class>* unary,OpAsType) { throw; }
+		template<typename OpAsType>
+		DispatchResult visitBinary(TypeId type,const Binary<V128Class>* binary,OpAsType) { throw; }
+		template<typename OpAsType>
+		DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpAsType) { throw; }
+		template<typename OpAsType>
+		DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpAsType) { throw; }
+		DispatchResult visitSplat(const Splat* splat) { throw; }
+		template<typename Class>
+		DispatchResult visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane) { throw; }
+		DispatchResult visitReplaceLane(const ReplaceLane* replaceLane) { throw; }
+		DispatchResult visitShuffle(const Shuffle* shuffle) { throw; }
 	};
 
 	std::ostream& ModulePrintContext::printFunction(uintptr_t functionIndex)
@@ -855,7 +1030,7 @@ namespace ASMJS
 		for(uintptr_t parameterIndex = 0;parameterIndex < loweredFunction.parameterLocalIndices.size();++parameterIndex)
 		{
 			auto parameterLocalIndex = loweredFunction.parameterLocalIndices[parameterIndex];
-			auto parameterType = loweredFunction.type.parameters[parameterIndex];
+			auto parameterType = loweredFunction.type->parameters[parameterIndex];
 			functionContext.printLocalName(parameterLocalIndex);
 			out << '=';
 			printCoercePrefix(out,parameterType);
@@ -865,9 +1040,9 @@ namespace ASMJS
 		}
 
 		// Print the function return type.
-		if(loweredFunction.type.returnType != TypeId::Void)
+		if(loweredFunction.type->returnType != TypeId::Void)
 		{
-			out << "if(0){return " << getZero(loweredFunction.type.returnType) << ";}\n";
+			out << "if(0){return " << getZero(loweredFunction.type->returnType) << ";}\n";
 		}
 
 		// Print the function's locals.
@@ -944,9 +1119,25 @@ namespace ASMJS
 		}
 
 		// Print the module functions.
-		for(uintptr_t functionIndex = 0;functionIndex < module->functions.size();++functionIndex)
+		if(numThreads <= 1)
+		{
+			for(uintptr_t functionIndex = 0;functionIndex < module->functions.size();++functionIndex)
+			{
+				printFunction(functionIndex);
+			}
+		}
+		else
 		{
-			printFunction(functionIndex);
+			// The functions are independent once they're lowered, so lower and print each function on a worker thread into its own
+			// buffer, then write the buffers out in function order so the output is the same as printing them on a single thread.
+			std::vector<std::string> functionStrings(module->functions.size());
+			Parallel::forEach(module->functions.size(),numThreads,[&](uintptr_t,uintptr_t functionIndex)
+			{
+				std::ostringstream functionStream;
+				ModulePrintContext(module,functionStream).printFunction(functionIndex);
+				functionStrings[functionIndex] = functionStream.str();
+			});
+			for(auto& functionString : functionStrings) { out << functionString; }
 		}
 
 		// Print the module function tables.
@@ -967,18 +1158,18 @@ namespace ASMJS
 		// Print the module exports.
 		out << "return {";
 		bool needsComma = false;
-		for(auto exportIt : module->exportNameToFunctionIndexMap)
+		for(auto export_ : module->exports)
 		{
 			if(needsComma) { out << ','; }
-			out << exportIt.first << ':';
-			printFunctionName(exportIt.second);
+			out << export_.name << ':';
+			printFunctionName(export_.functionIndex);
 			needsComma = true;
 		}
 		return out << "};\n})";
 	}
 
-	void print(std::ostream& outputStream,const Module* module)
+	void print(std::ostream& outputStream,const Module* module,uintptr_t numThreads)
 	{
-		ModulePrintContext(module,outputStream).print();
+		ModulePrintContext(module,outputStream,numThreads).print();
 	}
 }
\ No newline at end of file
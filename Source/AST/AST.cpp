@@ -1,4 +1,7 @@
 #include "AST.h"
+#include "Core/Platform.h"
+
+#include <atomic>
 
 namespace AST
 {
@@ -15,6 +18,7 @@ namespace AST
 	#define I64LowerCaseString "i64"
 	#define F32LowerCaseString "f32"
 	#define F64LowerCaseString "f64"
+	#define V128LowerCaseString "v128"
 	#define BoolLowerCaseString "bool"
 	#define VoidLowerCaseString "void"
 	#define AST_TYPE(typeName,className,...) \
@@ -38,6 +42,7 @@ namespace AST
 			case TypeId::I64: return typeClass == TypeClassId::Int;
 			case TypeId::F32: return typeClass == TypeClassId::Float;
 			case TypeId::F64: return typeClass == TypeClassId::Float;
+			case TypeId::V128: return typeClass == TypeClassId::V128;
 			case TypeId::Bool: return typeClass == TypeClassId::Bool;
 			case TypeId::Void: return typeClass == TypeClassId::Void;
 			default: throw;
@@ -55,6 +60,7 @@ namespace AST
 		case TypeId::I64: return TypeClassId::Int;
 		case TypeId::F32: return TypeClassId::Float;
 		case TypeId::F64: return TypeClassId::Float;
+		case TypeId::V128: return TypeClassId::V128;
 		case TypeId::Bool: return TypeClassId::Bool;
 		case TypeId::Void: return TypeClassId::Void;
 		default: throw;
@@ -74,6 +80,7 @@ namespace AST
 		case TypeId::I64: return 64;
 		case TypeId::F32: return 32;
 		case TypeId::F64: return 64;
+		case TypeId::V128: return 128;
 		case TypeId::Bool: return 1;
 		case TypeId::Void: return 0;
 		default: throw;
@@ -91,4 +98,46 @@ namespace AST
 	ENUM_AST_TYPECLASSES()
 	#undef AST_OP
 	#undef AST_TYPECLASS
+
+	const FunctionType* FunctionType::get(TypeId returnType,const std::vector<TypeId>& parameters)
+	{
+		return get(returnType,parameters.data(),parameters.size());
+	}
+
+	const FunctionType* FunctionType::find(const FunctionType* bucketHead,TypeId returnType,const TypeId* parameters,size_t numParameters)
+	{
+		for(auto type = bucketHead;type;type = type->nextInBucket)
+		{
+			if(type->returnType == returnType
+			&& type->parameters.size() == numParameters
+			&& std::equal(parameters,parameters + numParameters,type->parameters.begin()))
+			{
+				return type;
+			}
+		}
+		return nullptr;
+	}
+
+	const FunctionType* FunctionType::get(TypeId returnType,const TypeId* parameters,size_t numParameters)
+	{
+		// The interned types are kept in a fixed number of hash buckets, each a list linked through nextInBucket. Types are only added
+		// to the head of a list, and never removed or freed, so looking up a type that was already interned reads the lists without
+		// locking or allocating. A lookup that misses takes the lock, and checks the bucket again before adding the type.
+		// The buckets have static storage, so they are zeroed before the intrinsics intern their types during static initialization.
+		enum { numBuckets = 256 };
+		static std::atomic<const FunctionType*> buckets[numBuckets];
+		static Platform::Mutex* typeTableMutex = new Platform::Mutex();
+		static uint32 numTypes = 0;
+
+		const uint64 hash = Core::hashString(numParameters ? (const char*)parameters : "",numParameters * sizeof(TypeId)) ^ (uint64)returnType;
+		auto& bucket = buckets[hash & (numBuckets - 1)];
+		if(auto type = find(bucket.load(std::memory_order_acquire),returnType,parameters,numParameters)) { return type; }
+
+		Platform::Lock typeTableLock(*typeTableMutex);
+		auto bucketHead = bucket.load(std::memory_order_relaxed);
+		if(auto type = find(bucketHead,returnType,parameters,numParameters)) { return type; }
+		auto type = new FunctionType(returnType,parameters,numParameters,numTypes++,bucketHead);
+		bucket.store(type,std::memory_order_release);
+		return type;
+	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Core/Core.h"
 #include "Core/MemoryArena.h"
+#include "Core/StringHashMap.h"
 
 #include <cstdint>
 #include <vector>
@@ -99,45 +100,64 @@ namespace AST
 		const char* name;
 	};
 
+	// A function signature. Function types are interned: FunctionType::get returns the same object for every request for a signature,
+	// so function types are compared by comparing pointers, and the parameter list of each distinct signature is only allocated once.
+	// The interned types are shared by every module in the process instead of being owned by a module, so a module's imports are
+	// matched against the intrinsics' types, which are interned during static initialization, by comparing pointers too.
 	struct FunctionType
 	{
-		std::vector<TypeId> parameters;
-		TypeId returnType;
+		const std::vector<TypeId> parameters;
+		const TypeId returnType;
+		// A small integer that identifies the signature within the process, in the order the signatures were first interned.
+		const uint32 id;
 
-		FunctionType(TypeId inReturnType = TypeId::Void,const std::vector<TypeId>& inParameters = {})
-		: parameters(inParameters), returnType(inReturnType) {}
-		
-		friend bool operator==(const FunctionType& left,const FunctionType& right)
-		{
-			return left.returnType == right.returnType && left.parameters == right.parameters;
-		}
-		friend bool operator!=(const FunctionType& left,const FunctionType& right)
-		{
-			return left.returnType != right.returnType || left.parameters != right.parameters;
-		}
+		// Returns the interned type for a signature. Safe to call from multiple threads, and only locks or allocates memory the first
+		// time a signature is requested.
+		static const FunctionType* get(TypeId returnType = TypeId::Void,const std::vector<TypeId>& parameters = {});
+		static const FunctionType* get(TypeId returnType,const TypeId* parameters,size_t numParameters);
+
+	private:
+		// The next interned type in the same hash bucket.
+		const FunctionType* nextInBucket;
+
+		FunctionType(TypeId inReturnType,const TypeId* inParameters,size_t numParameters,uint32 inId,const FunctionType* inNextInBucket)
+		: parameters(inParameters,inParameters + numParameters), returnType(inReturnType), id(inId), nextInBucket(inNextInBucket) {}
+		FunctionType(const FunctionType&) = delete;
+
+		// Returns the type in a hash bucket's list with the given signature, or nullptr if there isn't one.
+		static const FunctionType* find(const FunctionType* bucketHead,TypeId returnType,const TypeId* parameters,size_t numParameters);
 	};
 
 	struct Function
 	{
 		const char* name;
-		std::vector<Variable> locals;
-		std::vector<uintptr_t> parameterLocalIndices;
-		FunctionType type;
+		// The function's locals and parameter indices are allocated from the module's arena.
+		Memory::ArenaArray<Variable> locals;
+		Memory::ArenaArray<uintptr_t> parameterLocalIndices;
+		const FunctionType* type;
 		UntypedExpression* expression;
 
-		Function(): name(nullptr), expression(nullptr) {}
+		Function(): name(nullptr), type(nullptr), expression(nullptr) {}
+
+		// Copies a function, allocating the copy's locals and parameter indices from the given arena.
+		Function(Memory::Arena& arena,const Function& inCopy)
+		: name(inCopy.name), type(inCopy.type), expression(inCopy.expression)
+		{
+			locals.assign(arena,inCopy.locals.data(),inCopy.locals.size());
+			parameterLocalIndices.assign(arena,inCopy.parameterLocalIndices.data(),inCopy.parameterLocalIndices.size());
+		}
 	};
 
 	struct FunctionTable
 	{
-		FunctionType type;
+		const FunctionType* type;
 		uintptr_t* functionIndices;
 		size_t numFunctions;
 	};
 
 	struct FunctionImport
 	{
-		FunctionType type;
+		const FunctionType* type;
 		const char* name;
 	};
 
@@ -161,8 +181,49 @@ namespace AST
 		ErrorRecord(std::string&& inMessage) : message(std::move(inMessage)) {}
 	};
 
-	struct CaseInsensitiveStringCompareFunctor { bool operator()(const char* left,const char* right) const { return strcmp(left,right) < 0; } };
-	typedef std::map<const char*,uintptr_t,CaseInsensitiveStringCompareFunctor> ExportNameToFunctionIndexMap;
+	struct Export
+	{
+		const char* name;
+		uintptr_t functionIndex;
+	};
+
+	// The functions exported by a module, in the order they were declared. Exports are looked up by name with a hash table,
+	// and the name a function is exported with is looked up with an array indexed by function index.
+	struct ExportTable
+	{
+		// Adds an export. Returns false if there's already an export with the same name, in which case the table isn't changed.
+		// The name isn't copied, so it must outlive the table.
+		bool add(const char* name,uintptr_t functionIndex)
+		{
+			if(!nameToExportIndexMap.add(name,exports.size())) { return false; }
+			exports.push_back({name,functionIndex});
+			if(functionIndex >= functionIndexToExportNameMap.size()) { functionIndexToExportNameMap.resize(functionIndex + 1,nullptr); }
+			if(!functionIndexToExportNameMap[functionIndex]) { functionIndexToExportNameMap[functionIndex] = name; }
+			return true;
+		}
+
+		// Looks up an export by name. Returns nullptr if there's no export with the name.
+		const Export* get(const char* name) const
+		{
+			const uintptr_t* exportIndex = nameToExportIndexMap.get(name);
+			return exportIndex ? &exports[*exportIndex] : nullptr;
+		}
+
+		// Returns the name a function is exported with, or nullptr if it isn't exported. If it's exported with several names, returns the first.
+		const char* getExportName(uintptr_t functionIndex) const
+		{
+			return functionIndex < functionIndexToExportNameMap.size() ? functionIndexToExportNameMap[functionIndex] : nullptr;
+		}
+
+		size_t size() const { return exports.size(); }
+		std::vector<Export>::const_iterator begin() const { return exports.begin(); }
+		std::vector<Export>::const_iterator end() const { return exports.end(); }
+
+	private:
+		std::vector<Export> exports;
+		Core::StringHashMap<uintptr_t> nameToExportIndexMap;
+		std::vector<const char*> functionIndexToExportNameMap;
+	};
 
 	struct Module
 	{
@@ -170,7 +231,7 @@ namespace AST
 
 		std::vector<Function*> functions;
 		std::vector<Variable> globals;
-		ExportNameToFunctionIndexMap exportNameToFunctionIndexMap;
+		ExportTable exports;
 		std::vector<FunctionTable> functionTables;
 		std::vector<FunctionImport> functionImports;
 		std::vector<VariableImport> variableImports;
@@ -186,7 +247,7 @@ namespace AST
 		Module(const Module& inCopy)
 		: functions(inCopy.functions)
 		, globals(inCopy.globals)
-		, exportNameToFunctionIndexMap(inCopy.exportNameToFunctionIndexMap)
+		, exports(inCopy.exports)
 		, functionTables(inCopy.functionTables)
 		, functionImports(inCopy.functionImports)
 		, variableImports(inCopy.variableImports)
@@ -0,0 +1,717 @@
+#include "Core/Core.h"
+#include "Core/Platform.h"
+#include "ASTCache.h"
+#include "ASTExpressions.h"
+#include "ASTDispatch.h"
+
+#include <fstream>
+#include <cstddef>
+
+// A module cache file is an image of the module's data with every pointer stored as an offset from the start of the file.
+// The offsets of all the pointers in the file are stored in a relocation table, so loading the file only requires mapping
+// it into memory and adding the base address to each pointer: the expressions are used in place without any per-node allocation.
+// The image depends on the layout of the AST structures, so the header records the pointer size and expression sizes of the build
+// that wrote it, and the file will be rejected by a build with a different layout.
+
+namespace AST
+{
+	// Increment this whenever the serialized AST changes in a way the layout below doesn't capture, e.g. adding or reordering ops.
+	enum { moduleCacheVersion = 4 };
+	static const char moduleCacheMagic[8] = {'W','A','V','M','A','S','T','C'};
+
+	// Identifies the layout of the AST structures that are stored in the cache.
+	static const uint32 moduleCacheLayout = (uint32)(sizeof(void*) | (sizeof(UntypedExpression) << 8) | (sizeof(Switch<VoidClass>) << 16) | (sizeof(Load<IntClass>) << 24));
+
+	struct ModuleCacheHeader
+	{
+		char magic[8];
+		uint32 version;
+		uint32 layout;
+		uint64 sourceChecksum;
+		uint64 imageChecksum; // The checksum of all the bytes following the header.
+		uint64 numImageBytes;
+		uint64 moduleOffset;
+		uint64 relocationsOffset;
+		uint64 numRelocations;
+		uint64 nopRelocationsOffset;
+		uint64 numNopRelocations;
+	};
+
+	struct CachedFunctionType
+	{
+		TypeId returnType;
+		uint64 numParameters;
+		const TypeId* parameters;
+	};
+
+	struct CachedFunction
+	{
+		const char* name;
+		uint64 numLocals;
+		const Variable* locals;
+		uint64 numParameters;
+		const uintptr_t* parameterLocalIndices;
+		CachedFunctionType type;
+		UntypedExpression* expression;
+	};
+
+	struct CachedExport
+	{
+		const char* name;
+		uint64 functionIndex;
+	};
+
+	struct CachedFunctionTable
+	{
+		CachedFunctionType type;
+		uint64 numFunctions;
+		uintptr_t* functionIndices;
+	};
+
+	struct CachedFunctionImport
+	{
+		CachedFunctionType type;
+		const char* name;
+	};
+
+	struct CachedModule
+	{
+		uint64 numFunctions;
+		const CachedFunction* functions;
+		uint64 numGlobals;
+		const Variable* globals;
+		uint64 numExports;
+		const CachedExport* exports;
+		uint64 numFunctionTables;
+		const CachedFunctionTable* functionTables;
+		uint64 numFunctionImports;
+		const CachedFunctionImport* functionImports;
+		uint64 numVariableImports;
+		const VariableImport* variableImports;
+		uint64 numDataSegments;
+		const DataSegment* dataSegments;
+		uint64 initialNumBytesMemory;
+		uint64 maxNumBytesMemory;
+	};
+
+	uint64 computeCacheChecksum(const uint8* data,size_t numBytes)
+	{
+		// A word-at-a-time variant of FNV-1a. It only needs to detect truncated, stale, or corrupted files.
+		uint64 hash = 0xcbf29ce484222325ull;
+		size_t numWords = numBytes / sizeof(uint64);
+		for(uintptr_t wordIndex = 0;wordIndex < numWords;++wordIndex)
+		{
+			uint64 word;
+			memcpy(&word,data + wordIndex * sizeof(uint64),sizeof(uint64));
+			hash = (hash ^ word) * 0x100000001b3ull;
+			hash ^= hash >> 29;
+		}
+		for(uintptr_t byteIndex = numWords * sizeof(uint64);byteIndex < numBytes;++byteIndex)
+		{
+			hash = (hash ^ data[byteIndex]) * 0x100000001b3ull;
+		}
+		return hash ^ numBytes;
+	}
+
+	// Builds the image of a module cache file.
+	struct ModuleCacheWriter
+	{
+		// Returned by the expression writer for references to the Nop singleton, which are fixed up to point to the loading process's Nop.
+		static const uint64 nopOffset = ~0ull;
+
+		std::vector<uint8> image;
+		std::vector<uint64> relocations;
+		std::vector<uint64> nopRelocations;
+
+		// Allocates zeroed space in the image, and returns its offset. All allocations are aligned to 8 bytes.
+		uint64 allocate(size_t numBytes)
+		{
+			auto offset = (image.size() + 7) & ~(size_t)7;
+			image.resize(offset + ((numBytes + 7) & ~(size_t)7));
+			return offset;
+		}
+
+		template<typename Value>
+		Value& at(uint64 offset) { return *(Value*)(image.data() + offset); }
+
+		template<typename Value>
+		uint64 appendArray(const Value* values,size_t numValues)
+		{
+			if(!numValues) { return 0; }
+			auto offset = allocate(sizeof(Value) * numValues);
+			memcpy(image.data() + offset,values,sizeof(Value) * numValues);
+			return offset;
+		}
+		template<typename Value>
+		uint64 append(const Value& value) { return appendArray(&value,1); }
+
+		uint64 appendString(const char* string)
+		{
+			if(!string) { return 0; }
+			return appendArray(string,strlen(string) + 1);
+		}
+
+		// Writes a pointer to the given offset in the image, and records it in the relocation table. An offset of zero is a null pointer.
+		void setPointer(uint64 pointerOffset,uint64 targetOffset)
+		{
+			if(targetOffset == nopOffset)
+			{
+				at<uintptr_t>(pointerOffset) = 0;
+				nopRelocations.push_back(pointerOffset);
+			}
+			else
+			{
+				at<uintptr_t>(pointerOffset) = (uintptr_t)targetOffset;
+				if(targetOffset) { relocations.push_back(pointerOffset); }
+			}
+		}
+
+		// Writes an array of variables, relocating their names.
+		uint64 appendVariables(const Variable* variables,size_t numVariables)
+		{
+			auto offset = appendArray(variables,numVariables);
+			for(uintptr_t variableIndex = 0;variableIndex < numVariables;++variableIndex)
+			{
+				setPointer(offset + variableIndex * sizeof(Variable) + offsetof(Variable,name),appendString(variables[variableIndex].name));
+			}
+			return offset;
+		}
+
+		void setFunctionType(uint64 typeOffset,const FunctionType* type)
+		{
+			at<CachedFunctionType>(typeOffset).returnType = type->returnType;
+			at<CachedFunctionType>(typeOffset).numParameters = type->parameters.size();
+			setPointer(typeOffset + offsetof(CachedFunctionType,parameters),appendArray(type->parameters.data(),type->parameters.size()));
+		}
+	};
+
+	// Copies an expression tree into the image, and returns the offset of the root expression.
+	struct ExpressionCacheWriter
+	{
+		typedef uint64 DispatchResult;
+
+		ModuleCacheWriter& writer;
+		const Module* module;
+		const Function* function;
+		std::map<const BranchTarget*,uint64> branchTargetOffsets;
+		bool hasErrors;
+
+		ExpressionCacheWriter(ModuleCacheWriter& inWriter,const Module* inModule,const Function* inFunction)
+		: writer(inWriter), module(inModule), function(inFunction), hasErrors(false) {}
+
+		uint64 write(const UntypedExpression* expression,TypeId type)
+		{
+			if(!expression) { return 0; }
+			return dispatch(*this,(UntypedExpression*)expression,type);
+		}
+
+		// Writes a child expression, and sets the child pointer of the copied node to point to it.
+		template<typename Node,typename Child>
+		void writeChild(uint64 nodeOffset,const Node* node,Child* const& child,TypeId type)
+		{
+			auto childOffset = write(child,type);
+			writer.setPointer(nodeOffset + ((const uint8*)&child - (const uint8*)node),childOffset);
+		}
+
+		// Sets a branch target pointer of the copied node. Each unique branch target is copied into the image once.
+		template<typename Node>
+		void writeBranchTarget(uint64 nodeOffset,const Node* node,BranchTarget* const& branchTarget)
+		{
+			auto targetIt = branchTargetOffsets.find(branchTarget);
+			uint64 targetOffset;
+			if(targetIt != branchTargetOffsets.end()) { targetOffset = targetIt->second; }
+			else
+			{
+				targetOffset = writer.append(*branchTarget);
+				branchTargetOffsets[branchTarget] = targetOffset;
+			}
+			writer.setPointer(nodeOffset + ((const uint8*)&branchTarget - (const uint8*)node),targetOffset);
+		}
+
+		// Writes an array of parameters with the given types, and sets the parameter array pointer of the copied node to point to it.
+		template<typename Node>
+		void writeParameters(uint64 nodeOffset,const Node* node,const FunctionType& functionType)
+		{
+			auto numParameters = functionType.parameters.size();
+			uint64 parametersOffset = numParameters ? writer.allocate(sizeof(UntypedExpression*) * numParameters) : 0;
+			for(uintptr_t parameterIndex = 0;parameterIndex < numParameters;++parameterIndex)
+			{
+				auto parameterOffset = write(node->parameters[parameterIndex],functionType.parameters[parameterIndex]);
+				writer.setPointer(parametersOffset + parameterIndex * sizeof(UntypedExpression*),parameterOffset);
+			}
+			writer.setPointer(nodeOffset + ((const uint8*)&node->parameters - (const uint8*)node),parametersOffset);
+		}
+
+		template<typename Type>
+		DispatchResult visitLiteral(const Literal<Type>* literal)
+		{
+			return writer.append(*literal);
+		}
+		template<typename Class>
+		DispatchResult visitError(TypeId type,const Error<Class>* error)
+		{
+			hasErrors = true;
+			return 0;
+		}
+		template<typename OpAsType>
+		DispatchResult visitGetVariable(TypeId type,const GetVariable* getVariable,OpAsType)
+		{
+			return writer.append(*getVariable);
+		}
+		template<typename OpAsType>
+		DispatchResult visitSetVariable(const SetVariable* setVariable,OpAsType)
+		{
+			TypeId variableType;
+			switch(setVariable->op())
+			{
+			case AnyOp::setLocal: variableType = function->locals[setVariable->variableIndex].type; break;
+			case AnyOp::setGlobal: variableType = module->globals[setVariable->variableIndex].type; break;
+			default: throw;
+			}
+			auto offset = writer.append(*setVariable);
+			writeChild(offset,setVariable,setVariable->value,variableType);
+			return offset;
+		}
+		template<typename Class,typename OpAsType>
+		DispatchResult visitLoad(TypeId type,const Load<Class>* load,OpAsType)
+		{
+			auto offset = writer.append(*load);
+			writeChild(offset,load,load->address,load->isFarAddress ? TypeId::I64 : TypeId::I32);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitStore(const Store<Class>* store)
+		{
+			auto offset = writer.append(*store);
+			writeChild(offset,store,store->address,store->isFarAddress ? TypeId::I64 : TypeId::I32);
+			writeChild(offset,store,store->value.expression,store->value.type);
+			return offset;
+		}
+		template<typename Class,typename OpAsType>
+		DispatchResult visitUnary(TypeId type,const Unary<Class>* unary,OpAsType)
+		{
+			auto offset = writer.append(*unary);
+			writeChild(offset,unary,unary->operand,type);
+			return offset;
+		}
+		template<typename Class,typename OpAsType>
+		DispatchResult visitBinary(TypeId type,const Binary<Class>* binary,OpAsType)
+		{
+			auto offset = writer.append(*binary);
+			writeChild(offset,binary,binary->left,type);
+			writeChild(offset,binary,binary->right,type);
+			return offset;
+		}
+		template<typename Class,typename OpAsType>
+		DispatchResult visitCast(TypeId type,const Cast<Class>* cast,OpAsType)
+		{
+			auto offset = writer.append(*cast);
+			writeChild(offset,cast,cast->source.expression,cast->source.type);
+			return offset;
+		}
+		template<typename OpAsType>
+		DispatchResult visitCall(TypeId type,const Call* call,OpAsType)
+		{
+			const FunctionType* functionType;
+			switch(call->op())
+			{
+			case AnyOp::callDirect: functionType = module->functions[call->functionIndex]->type; break;
+			case AnyOp::callImport: functionType = module->functionImports[call->functionIndex].type; break;
+			default: throw;
+			}
+			auto offset = writer.append(*call);
+			writeParameters(offset,call,*functionType);
+			return offset;
+		}
+		DispatchResult visitCallIndirect(TypeId type,const CallIndirect* callIndirect)
+		{
+			auto offset = writer.append(*callIndirect);
+			writeParameters(offset,callIndirect,*module->functionTables[callIndirect->tableIndex].type);
+			writeChild(offset,callIndirect,callIndirect->functionIndex,TypeId::I32);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitSwitch(TypeId type,const Switch<Class>* switch_)
+		{
+			auto offset = writer.append(*switch_);
+			writeBranchTarget(offset,switch_,switch_->endTarget);
+			writeChild(offset,switch_,switch_->key.expression,switch_->key.type);
+
+			auto armsOffset = writer.appendArray(switch_->arms,switch_->numArms);
+			for(uintptr_t armIndex = 0;armIndex < switch_->numArms;++armIndex)
+			{
+				auto armType = armIndex + 1 == switch_->numArms ? type : TypeId::Void;
+				auto valueOffset = write(switch_->arms[armIndex].value,armType);
+				writer.setPointer(armsOffset + armIndex * sizeof(SwitchArm) + offsetof(SwitchArm,value),valueOffset);
+			}
+			writer.setPointer(offset + ((const uint8*)&switch_->arms - (const uint8*)switch_),armsOffset);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitIfElse(TypeId type,const IfElse<Class>* ifElse)
+		{
+			auto offset = writer.append(*ifElse);
+			writeChild(offset,ifElse,ifElse->condition,TypeId::Bool);
+			writeChild(offset,ifElse,ifElse->thenExpression,type);
+			writeChild(offset,ifElse,ifElse->elseExpression,type);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitLabel(TypeId type,const Label<Class>* label)
+		{
+			auto offset = writer.append(*label);
+			writeBranchTarget(offset,label,label->endTarget);
+			writeChild(offset,label,label->expression,type);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitSequence(TypeId type,const Sequence<Class>* seq)
+		{
+			auto offset = writer.append(*seq);
+			writeChild(offset,seq,seq->voidExpression,TypeId::Void);
+			writeChild(offset,seq,seq->resultExpression,type);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitReturn(TypeId type,const Return<Class>* ret)
+		{
+			auto offset = writer.append(*ret);
+			auto valueOffset = function->type->returnType == TypeId::Void ? 0 : write(ret->value,function->type->returnType);
+			writer.setPointer(offset + ((const uint8*)&ret->value - (const uint8*)ret),valueOffset);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitLoop(TypeId type,const Loop<Class>* loop)
+		{
+			auto offset = writer.append(*loop);
+			writeBranchTarget(offset,loop,loop->breakTarget);
+			writeBranchTarget(offset,loop,loop->continueTarget);
+			writeChild(offset,loop,loop->expression,TypeId::Void);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitBranch(TypeId type,const Branch<Class>* branch)
+		{
+			auto offset = writer.append(*branch);
+			writeBranchTarget(offset,branch,branch->branchTarget);
+			auto valueOffset = branch->branchTarget->type == TypeId::Void ? 0 : write(branch->value,branch->branchTarget->type);
+			writer.setPointer(offset + ((const uint8*)&branch->value - (const uint8*)branch),valueOffset);
+			return offset;
+		}
+		template<typename OpAsType>
+		DispatchResult visitComparison(const Comparison* compare,OpAsType)
+		{
+			auto offset = writer.append(*compare);
+			writeChild(offset,compare,compare->left,compare->operandType);
+			writeChild(offset,compare,compare->right,compare->operandType);
+			return offset;
+		}
+		DispatchResult visitNop(const Nop* nop)
+		{
+			return ModuleCacheWriter::nopOffset;
+		}
+		DispatchResult visitDiscardResult(const DiscardResult* discardResult)
+		{
+			auto offset = writer.append(*discardResult);
+			writeChild(offset,discardResult,discardResult->expression.expression,discardResult->expression.type);
+			return offset;
+		}
+		DispatchResult visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			auto offset = writer.append(*bulkMemory);
+			writeChild(offset,bulkMemory,bulkMemory->destAddress,TypeId::I32);
+			writeChild(offset,bulkMemory,bulkMemory->source,TypeId::I32);
+			writeChild(offset,bulkMemory,bulkMemory->numBytes,TypeId::I32);
+			return offset;
+		}
+		template<typename OpAsType>
+		DispatchResult visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			auto offset = writer.append(*atomic);
+			writeChild(offset,atomic,atomic->address,TypeId::I32);
+			if(atomic->operand) { writeChild(offset,atomic,atomic->operand,Atomic::getOperandType(atomic->op(),type)); }
+			if(atomic->replacement) { writeChild(offset,atomic,atomic->replacement,Atomic::getReplacementType(atomic->op(),type)); }
+			return offset;
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpAsType)
+		{
+			auto offset = writer.append(*laneUnary);
+			writeChild(offset,laneUnary,laneUnary->operand,TypeId::V128);
+			return offset;
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpAsType)
+		{
+			auto offset = writer.append(*laneBinary);
+			writeChild(offset,laneBinary,laneBinary->left,TypeId::V128);
+			writeChild(offset,laneBinary,laneBinary->right,TypeId::V128);
+			return offset;
+		}
+		DispatchResult visitSplat(const Splat* splat)
+		{
+			auto offset = writer.append(*splat);
+			writeChild(offset,splat,splat->scalar.expression,splat->scalar.type);
+			return offset;
+		}
+		template<typename Class>
+		DispatchResult visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane)
+		{
+			auto offset = writer.append(*extractLane);
+			writeChild(offset,extractLane,extractLane->vector,TypeId::V128);
+			return offset;
+		}
+		DispatchResult visitReplaceLane(const ReplaceLane* replaceLane)
+		{
+			auto offset = writer.append(*replaceLane);
+			writeChild(offset,replaceLane,replaceLane->vector,TypeId::V128);
+			writeChild(offset,replaceLane,replaceLane->scalar.expression,replaceLane->scalar.type);
+			return offset;
+		}
+		DispatchResult visitShuffle(const Shuffle* shuffle)
+		{
+			auto offset = writer.append(*shuffle);
+			writeChild(offset,shuffle,shuffle->left,TypeId::V128);
+			writeChild(offset,shuffle,shuffle->right,TypeId::V128);
+			return offset;
+		}
+	};
+
+	bool saveModuleCache(const Module* module,uint64 sourceChecksum,const char* filename)
+	{
+		ModuleCacheWriter writer;
+		auto headerOffset = writer.allocate(sizeof(ModuleCacheHeader));
+		auto moduleOffset = writer.allocate(sizeof(CachedModule));
+
+		// Write the functions.
+		auto functionsOffset = writer.allocate(sizeof(CachedFunction) * module->functions.size());
+		for(uintptr_t functionIndex = 0;functionIndex < module->functions.size();++functionIndex)
+		{
+			auto function = module->functions[functionIndex];
+			auto cachedFunctionOffset = functionsOffset + functionIndex * sizeof(CachedFunction);
+			writer.at<CachedFunction>(cachedFunctionOffset).numLocals = function->locals.size();
+			writer.at<CachedFunction>(cachedFunctionOffset).numParameters = function->parameterLocalIndices.size();
+			writer.setPointer(cachedFunctionOffset + offsetof(CachedFunction,name),writer.appendString(function->name));
+			writer.setPointer(cachedFunctionOffset + offsetof(CachedFunction,locals),writer.appendVariables(function->locals.data(),function->locals.size()));
+			writer.setPointer(cachedFunctionOffset + offsetof(CachedFunction,parameterLocalIndices),writer.appendArray(function->parameterLocalIndices.data(),function->parameterLocalIndices.size()));
+			writer.setFunctionType(cachedFunctionOffset + offsetof(CachedFunction,type),function->type);
+
+			ExpressionCacheWriter expressionWriter(writer,module,function);
+			auto expressionOffset = expressionWriter.write(function->expression,function->type->returnType);
+			if(expressionWriter.hasErrors) { return false; }
+			writer.setPointer(cachedFunctionOffset + offsetof(CachedFunction,expression),expressionOffset);
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,functions),functionsOffset);
+		writer.at<CachedModule>(moduleOffset).numFunctions = module->functions.size();
+
+		// Write the globals.
+		writer.setPointer(moduleOffset + offsetof(CachedModule,globals),writer.appendVariables(module->globals.data(),module->globals.size()));
+		writer.at<CachedModule>(moduleOffset).numGlobals = module->globals.size();
+
+		// Write the exports.
+		auto exportsOffset = writer.allocate(sizeof(CachedExport) * module->exports.size());
+		uintptr_t exportIndex = 0;
+		for(auto export_ : module->exports)
+		{
+			auto cachedExportOffset = exportsOffset + exportIndex++ * sizeof(CachedExport);
+			writer.at<CachedExport>(cachedExportOffset).functionIndex = export_.functionIndex;
+			writer.setPointer(cachedExportOffset + offsetof(CachedExport,name),writer.appendString(export_.name));
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,exports),exportsOffset);
+		writer.at<CachedModule>(moduleOffset).numExports = module->exports.size();
+
+		// Write the function tables.
+		auto functionTablesOffset = writer.allocate(sizeof(CachedFunctionTable) * module->functionTables.size());
+		for(uintptr_t tableIndex = 0;tableIndex < module->functionTables.size();++tableIndex)
+		{
+			const FunctionTable& functionTable = module->functionTables[tableIndex];
+			auto cachedTableOffset = functionTablesOffset + tableIndex * sizeof(CachedFunctionTable);
+			writer.at<CachedFunctionTable>(cachedTableOffset).numFunctions = functionTable.numFunctions;
+			writer.setFunctionType(cachedTableOffset + offsetof(CachedFunctionTable,type),functionTable.type);
+			writer.setPointer(cachedTableOffset + offsetof(CachedFunctionTable,functionIndices),writer.appendArray(functionTable.functionIndices,functionTable.numFunctions));
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,functionTables),functionTablesOffset);
+		writer.at<CachedModule>(moduleOffset).numFunctionTables = module->functionTables.size();
+
+		// Write the function imports.
+		auto functionImportsOffset = writer.allocate(sizeof(CachedFunctionImport) * module->functionImports.size());
+		for(uintptr_t importIndex = 0;importIndex < module->functionImports.size();++importIndex)
+		{
+			const FunctionImport& functionImport = module->functionImports[importIndex];
+			auto cachedImportOffset = functionImportsOffset + importIndex * sizeof(CachedFunctionImport);
+			writer.setFunctionType(cachedImportOffset + offsetof(CachedFunctionImport,type),functionImport.type);
+			writer.setPointer(cachedImportOffset + offsetof(CachedFunctionImport,name),writer.appendString(functionImport.name));
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,functionImports),functionImportsOffset);
+		writer.at<CachedModule>(moduleOffset).numFunctionImports = module->functionImports.size();
+
+		// Write the variable imports.
+		auto variableImportsOffset = writer.appendArray(module->variableImports.data(),module->variableImports.size());
+		for(uintptr_t importIndex = 0;importIndex < module->variableImports.size();++importIndex)
+		{
+			auto nameOffset = writer.appendString(module->variableImports[importIndex].name);
+			writer.setPointer(variableImportsOffset + importIndex * sizeof(VariableImport) + offsetof(VariableImport,name),nameOffset);
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,variableImports),variableImportsOffset);
+		writer.at<CachedModule>(moduleOffset).numVariableImports = module->variableImports.size();
+
+		// Write the data segments.
+		auto dataSegmentsOffset = writer.appendArray(module->dataSegments.data(),module->dataSegments.size());
+		for(uintptr_t segmentIndex = 0;segmentIndex < module->dataSegments.size();++segmentIndex)
+		{
+			const DataSegment& dataSegment = module->dataSegments[segmentIndex];
+			auto dataOffset = writer.appendArray(dataSegment.data,(size_t)dataSegment.numBytes);
+			writer.setPointer(dataSegmentsOffset + segmentIndex * sizeof(DataSegment) + offsetof(DataSegment,data),dataOffset);
+		}
+		writer.setPointer(moduleOffset + offsetof(CachedModule,dataSegments),dataSegmentsOffset);
+		writer.at<CachedModule>(moduleOffset).numDataSegments = module->dataSegments.size();
+
+		writer.at<CachedModule>(moduleOffset).initialNumBytesMemory = module->initialNumBytesMemory;
+		writer.at<CachedModule>(moduleOffset).maxNumBytesMemory = module->maxNumBytesMemory;
+
+		// Write the relocation tables.
+		auto numRelocations = writer.relocations.size();
+		auto numNopRelocations = writer.nopRelocations.size();
+		auto relocationsOffset = writer.appendArray(writer.relocations.data(),numRelocations);
+		auto nopRelocationsOffset = writer.appendArray(writer.nopRelocations.data(),numNopRelocations);
+
+		// Fill in the header.
+		ModuleCacheHeader& header = writer.at<ModuleCacheHeader>(headerOffset);
+		memcpy(header.magic,moduleCacheMagic,sizeof(moduleCacheMagic));
+		header.version = moduleCacheVersion;
+		header.layout = moduleCacheLayout;
+		header.sourceChecksum = sourceChecksum;
+		header.numImageBytes = writer.image.size();
+		header.moduleOffset = moduleOffset;
+		header.relocationsOffset = relocationsOffset;
+		header.numRelocations = numRelocations;
+		header.nopRelocationsOffset = nopRelocationsOffset;
+		header.numNopRelocations = numNopRelocations;
+		header.imageChecksum = computeCacheChecksum(writer.image.data() + sizeof(ModuleCacheHeader),writer.image.size() - sizeof(ModuleCacheHeader));
+
+		std::ofstream stream(filename,std::ios::binary | std::ios::trunc);
+		if(!stream.is_open()) { return false; }
+		stream.write((const char*)writer.image.data(),writer.image.size());
+		stream.close();
+		return !stream.fail();
+	}
+
+	// Returns whether an 8-byte aligned array of numElements elements of elementBytes each at the given offset is within the image.
+	static bool isValidImageRange(uint64 offset,uint64 numElements,uint64 elementBytes,size_t numBytes)
+	{
+		return !(offset & 7) && offset <= numBytes && numElements <= (numBytes - offset) / elementBytes;
+	}
+
+	static bool isValidModuleCache(const uint8* image,size_t numBytes,uint64 sourceChecksum)
+	{
+		if(numBytes < sizeof(ModuleCacheHeader)) { return false; }
+		const ModuleCacheHeader& header = *(const ModuleCacheHeader*)image;
+		if(memcmp(header.magic,moduleCacheMagic,sizeof(moduleCacheMagic))
+		|| header.version != moduleCacheVersion
+		|| header.layout != moduleCacheLayout
+		|| header.sourceChecksum != sourceChecksum
+		|| header.numImageBytes != numBytes)
+		{
+			return false;
+		}
+		if(!isValidImageRange(header.moduleOffset,1,sizeof(CachedModule),numBytes)
+		|| !isValidImageRange(header.relocationsOffset,header.numRelocations,sizeof(uint64),numBytes)
+		|| !isValidImageRange(header.nopRelocationsOffset,header.numNopRelocations,sizeof(uint64),numBytes))
+		{
+			return false;
+		}
+		if(header.imageChecksum != computeCacheChecksum(image + sizeof(ModuleCacheHeader),numBytes - sizeof(ModuleCacheHeader))) { return false; }
+
+		// Check that each relocated pointer is an aligned pointer within the image, and that each relocated pointer's target is the
+		// offset of an (8-byte aligned) allocation within the image. Otherwise a corrupt file could make the module reference memory
+		// outside the image.
+		const uint64* relocations = (const uint64*)(image + header.relocationsOffset);
+		for(uintptr_t relocationIndex = 0;relocationIndex < header.numRelocations;++relocationIndex)
+		{
+			auto relocationOffset = relocations[relocationIndex];
+			if(!isValidImageRange(relocationOffset,1,sizeof(uintptr_t),numBytes)) { return false; }
+			auto targetOffset = *(const uintptr_t*)(image + relocationOffset);
+			if((targetOffset & 7) || targetOffset >= numBytes) { return false; }
+		}
+		const uint64* nopRelocations = (const uint64*)(image + header.nopRelocationsOffset);
+		for(uintptr_t relocationIndex = 0;relocationIndex < header.numNopRelocations;++relocationIndex)
+		{
+			if(!isValidImageRange(nopRelocations[relocationIndex],1,sizeof(uintptr_t),numBytes)) { return false; }
+		}
+		return true;
+	}
+
+	static const FunctionType* loadFunctionType(const CachedFunctionType& type)
+	{
+		return FunctionType::get(type.returnType,type.parameters,(size_t)type.numParameters);
+	}
+
+	Module* loadModuleCache(const char* filename,uint64 sourceChecksum)
+	{
+		size_t numBytes;
+		uint8* image = Platform::mapFile(filename,numBytes);
+		if(!image) { return nullptr; }
+		if(!isValidModuleCache(image,numBytes,sourceChecksum))
+		{
+			Platform::unmapFile(image,numBytes);
+			return nullptr;
+		}
+		const ModuleCacheHeader& header = *(const ModuleCacheHeader*)image;
+
+		// Relocate the pointers in the image. The image is mapped copy-on-write, so this doesn't modify the file.
+		// isValidModuleCache has checked that the relocations are within the image.
+		const uint64* relocations = (const uint64*)(image + header.relocationsOffset);
+		for(uintptr_t relocationIndex = 0;relocationIndex < header.numRelocations;++relocationIndex)
+		{
+			*(uintptr_t*)(image + relocations[relocationIndex]) += reinterpret_cast<uintptr_t>(image);
+		}
+		const uint64* nopRelocations = (const uint64*)(image + header.nopRelocationsOffset);
+		for(uintptr_t relocationIndex = 0;relocationIndex < header.numNopRelocations;++relocationIndex)
+		{
+			*(UntypedExpression**)(image + nopRelocations[relocationIndex]) = Nop::get();
+		}
+
+		// Create the module's declarations, referencing the relocated image.
+		const CachedModule& cachedModule = *(const CachedModule*)(image + header.moduleOffset);
+		auto module = new Module();
+
+		module->functions.resize((size_t)cachedModule.numFunctions);
+		for(uintptr_t functionIndex = 0;functionIndex < cachedModule.numFunctions;++functionIndex)
+		{
+			const CachedFunction& cachedFunction = cachedModule.functions[functionIndex];
+			auto function = new(module->arena) Function();
+			function->name = cachedFunction.name;
+			function->locals.assign(module->arena,cachedFunction.locals,cachedFunction.numLocals);
+			function->parameterLocalIndices.assign(module->arena,cachedFunction.parameterLocalIndices,cachedFunction.numParameters);
+			function->type = loadFunctionType(cachedFunction.type);
+			function->expression = cachedFunction.expression;
+			module->functions[functionIndex] = function;
+		}
+
+		module->globals.assign(cachedModule.globals,cachedModule.globals + cachedModule.numGlobals);
+
+		for(uintptr_t exportIndex = 0;exportIndex < cachedModule.numExports;++exportIndex)
+		{
+			module->exports.add(cachedModule.exports[exportIndex].name,(uintptr_t)cachedModule.exports[exportIndex].functionIndex);
+		}
+
+		for(uintptr_t tableIndex = 0;tableIndex < cachedModule.numFunctionTables;++tableIndex)
+		{
+			const CachedFunctionTable& cachedTable = cachedModule.functionTables[tableIndex];
+			module->functionTables.push_back({loadFunctionType(cachedTable.type),cachedTable.functionIndices,(size_t)cachedTable.numFunctions});
+		}
+
+		for(uintptr_t importIndex = 0;importIndex < cachedModule.numFunctionImports;++importIndex)
+		{
+			const CachedFunctionImport& cachedImport = cachedModule.functionImports[importIndex];
+			module->functionImports.push_back({loadFunctionType(cachedImport.type),cachedImport.name});
+		}
+
+		module->variableImports.assign(cachedModule.variableImports,cachedModule.variableImports + cachedModule.numVariableImports);
+		module->dataSegments.assign(cachedModule.dataSegments,cachedModule.dataSegments + cachedModule.numDataSegments);
+		module->initialNumBytesMemory = cachedModule.initialNumBytesMemory;
+		module->maxNumBytesMemory = cachedModule.maxNumBytesMemory;
+
+		return module;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "AST.h"
+
+namespace AST
+{
+	// Computes the checksum used to validate module cache files. Also used to identify the source a module cache was created from.
+	uint64 computeCacheChecksum(const uint8* data,size_t numBytes);
+
+	// Writes a module to a cache file that can be loaded with loadModuleCache. sourceChecksum identifies the source the module was parsed from.
+	// Returns false if the module contains errors, or the file couldn't be written.
+	bool saveModuleCache(const Module* module,uint64 sourceChecksum,const char* filename);
+
+	// Loads a module from a cache file written by saveModuleCache. The file is mapped into memory, and the module's expressions,
+	// names, and data segments are used in place without copying them. The file stays mapped for the lifetime of the process.
+	// Returns nullptr if the file doesn't exist, was written by a different version or build, doesn't match sourceChecksum, or is corrupt.
+	Module* loadModuleCache(const char* filename,uint64 sourceChecksum);
+}
\ No newline at end of file
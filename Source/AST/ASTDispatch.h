@@ -66,6 +66,12 @@ namespace AST
 		case IntOp::lit: return dispatchLiteral(visitor,expression,type);
 		case IntOp::loadZExt: return visitor.visitLoad(type,(Load<IntClass>*)expression,OpTypes<IntClass>::loadZExt());
 		case IntOp::loadSExt: return visitor.visitLoad(type,(Load<IntClass>*)expression,OpTypes<IntClass>::loadSExt());
+
+		#define AST_OP(op) case IntOp::op: return visitor.visitAtomic(type,(Atomic*)expression,OpTypes<IntClass>::op());
+		ENUM_AST_ATOMIC_OPS_Int()
+		#undef AST_OP
+
+		case IntOp::extractLane: return visitor.visitExtractLane(type,(ExtractLane<IntClass>*)expression);
 		default: return dispatchAny(visitor,expression,type);
 		}
 	}
@@ -89,6 +95,37 @@ namespace AST
 		#undef AST_OP
 		
 		case FloatOp::lit: return dispatchLiteral(visitor,expression,type);
+		case FloatOp::extractLane: return visitor.visitExtractLane(type,(ExtractLane<FloatClass>*)expression);
+		default: return dispatchAny(visitor,expression,type);
+		}
+	}
+
+	// Dispatch opcodes that can occur in type contexts expecting a 128-bit vector result.
+	template<typename Visitor>
+	static typename Visitor::DispatchResult dispatch(Visitor& visitor,Expression<V128Class>* expression,TypeId type = TypeId::V128)
+	{
+		switch(expression->op())
+		{
+		#define AST_OP(op) case V128Op::op: return visitor.visitUnary(type,(Unary<V128Class>*)expression,OpTypes<V128Class>::op());
+		ENUM_AST_UNARY_OPS_V128()
+		#undef AST_OP
+
+		#define AST_OP(op) case V128Op::op: return visitor.visitBinary(type,(Binary<V128Class>*)expression,OpTypes<V128Class>::op());
+		ENUM_AST_BINARY_OPS_V128()
+		#undef AST_OP
+
+		#define AST_OP(op) case V128Op::op: return visitor.visitLaneUnary((LaneUnary*)expression,OpTypes<V128Class>::op());
+		ENUM_AST_LANE_UNARY_OPS_V128()
+		#undef AST_OP
+
+		#define AST_OP(op) case V128Op::op: return visitor.visitLaneBinary((LaneBinary*)expression,OpTypes<V128Class>::op());
+		ENUM_AST_LANE_BINARY_OPS_V128()
+		#undef AST_OP
+
+		case V128Op::lit: return dispatchLiteral(visitor,expression,type);
+		case V128Op::splat: return visitor.visitSplat((Splat*)expression);
+		case V128Op::replaceLane: return visitor.visitReplaceLane((ReplaceLane*)expression);
+		case V128Op::shuffle: return visitor.visitShuffle((Shuffle*)expression);
 		default: return dispatchAny(visitor,expression,type);
 		}
 	}
@@ -123,6 +160,7 @@ namespace AST
 		{
 		case VoidOp::nop: return visitor.visitNop((Nop*)expression);
 		case VoidOp::discardResult: return visitor.visitDiscardResult((DiscardResult*)expression);
+		case VoidOp::copyMemory: case VoidOp::moveMemory: case VoidOp::fillMemory: return visitor.visitBulkMemory((BulkMemory*)expression);
 		default: return dispatchAny(visitor,expression,type);
 		}
 	}
@@ -197,14 +235,14 @@ namespace AST
 		DispatchResult visitLoad(TypeId type,const Load<Class>* load,OpAsType)
 		{
 			auto address = as<IntClass>(visitChild(TypedExpression(load->address,load->isFarAddress ? TypeId::I64 : TypeId::I32)));
-			return TypedExpression(new(arena) Load<Class>(load->op(),load->isFarAddress,load->isAligned,address,load->memoryType),type);
+			return TypedExpression(new(arena) Load<Class>(load->op(),load->isFarAddress,load->alignmentLog2,address,load->memoryType),type);
 		}
 		template<typename Class>
 		DispatchResult visitStore(const Store<Class>* store)
 		{
 			auto address = as<IntClass>(visitChild(TypedExpression(store->address,store->isFarAddress ? TypeId::I64 : TypeId::I32)));
 			auto value = visitChild(store->value);
-			return TypedExpression(new(arena) Store<Class>(store->isFarAddress,store->isAligned,address,value,store->memoryType),value.type);
+			return TypedExpression(new(arena) Store<Class>(store->isFarAddress,store->alignmentLog2,address,value,store->memoryType),value.type);
 		}
 
 		template<typename Class,typename OpAsType>
@@ -234,8 +272,8 @@ namespace AST
 			const FunctionType* functionType;
 			switch(call->op())
 			{
-			case AnyOp::callDirect: functionType = &module->functions[call->functionIndex]->type; break;
-			case AnyOp::callImport: functionType = &module->functionImports[call->functionIndex].type; break;
+			case AnyOp::callDirect: functionType = module->functions[call->functionIndex]->type; break;
+			case AnyOp::callImport: functionType = module->functionImports[call->functionIndex].type; break;
 			default: throw;
 			}
 
@@ -250,12 +288,12 @@ namespace AST
 		}
 		DispatchResult visitCallIndirect(TypeId type,const CallIndirect* callIndirect)
 		{
-			const FunctionType& functionType = module->functionTables[callIndirect->tableIndex].type;
+			const FunctionType* functionType = module->functionTables[callIndirect->tableIndex].type;
 
-			auto parameters = new(arena) UntypedExpression*[functionType.parameters.size()];
-			for(uintptr_t parameterIndex = 0;parameterIndex < functionType.parameters.size();++parameterIndex)
+			auto parameters = new(arena) UntypedExpression*[functionType->parameters.size()];
+			for(uintptr_t parameterIndex = 0;parameterIndex < functionType->parameters.size();++parameterIndex)
 			{
-				auto parameterType = functionType.parameters[parameterIndex];
+				auto parameterType = functionType->parameters[parameterIndex];
 				parameters[parameterIndex] = visitChild(TypedExpression(callIndirect->parameters[parameterIndex],parameterType)).expression;
 			}
 
@@ -305,8 +343,8 @@ namespace AST
 		template<typename Class>
 		DispatchResult visitReturn(TypeId type,const Return<Class>* ret)
 		{
-			auto value = function->type.returnType == TypeId::Void ? nullptr
-				: visitChild(TypedExpression(ret->value,function->type.returnType)).expression;
+			auto value = function->type->returnType == TypeId::Void ? nullptr
+				: visitChild(TypedExpression(ret->value,function->type->returnType)).expression;
 			return TypedExpression(new(arena) Return<Class>(value),TypeId::None);
 		}
 		template<typename Class>
@@ -345,5 +383,56 @@ namespace AST
 			auto expression = visitChild(discardResult->expression);
 			return TypedExpression(new(arena) DiscardResult(expression),TypeId::Void);
 		}
+		DispatchResult visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			auto destAddress = as<IntClass>(visitChild(TypedExpression(bulkMemory->destAddress,TypeId::I32)));
+			auto source = as<IntClass>(visitChild(TypedExpression(bulkMemory->source,TypeId::I32)));
+			auto numBytes = as<IntClass>(visitChild(TypedExpression(bulkMemory->numBytes,TypeId::I32)));
+			return TypedExpression(new(arena) BulkMemory(bulkMemory->op(),destAddress,source,numBytes),TypeId::Void);
+		}
+		template<typename OpAsType>
+		DispatchResult visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			auto address = as<IntClass>(visitChild(TypedExpression(atomic->address,TypeId::I32)));
+			auto operand = atomic->operand ? as<IntClass>(visitChild(TypedExpression(atomic->operand,Atomic::getOperandType(atomic->op(),type)))) : nullptr;
+			auto replacement = atomic->replacement ? as<IntClass>(visitChild(TypedExpression(atomic->replacement,Atomic::getReplacementType(atomic->op(),type)))) : nullptr;
+			return TypedExpression(new(arena) Atomic(atomic->op(),address,operand,replacement),type);
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpAsType)
+		{
+			auto operand = as<V128Class>(visitChild(TypedExpression(laneUnary->operand,TypeId::V128)));
+			return TypedExpression(new(arena) LaneUnary(laneUnary->op(),laneUnary->laneType,operand),TypeId::V128);
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpAsType)
+		{
+			auto left = as<V128Class>(visitChild(TypedExpression(laneBinary->left,TypeId::V128)));
+			auto right = as<V128Class>(visitChild(TypedExpression(laneBinary->right,TypeId::V128)));
+			return TypedExpression(new(arena) LaneBinary(laneBinary->op(),laneBinary->laneType,left,right),TypeId::V128);
+		}
+		DispatchResult visitSplat(const Splat* splat)
+		{
+			auto scalar = visitChild(splat->scalar);
+			return TypedExpression(new(arena) Splat(scalar),TypeId::V128);
+		}
+		template<typename Class>
+		DispatchResult visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane)
+		{
+			auto vector = as<V128Class>(visitChild(TypedExpression(extractLane->vector,TypeId::V128)));
+			return TypedExpression(new(arena) ExtractLane<Class>(vector,extractLane->laneIndex),type);
+		}
+		DispatchResult visitReplaceLane(const ReplaceLane* replaceLane)
+		{
+			auto vector = as<V128Class>(visitChild(TypedExpression(replaceLane->vector,TypeId::V128)));
+			auto scalar = visitChild(replaceLane->scalar);
+			return TypedExpression(new(arena) ReplaceLane(vector,scalar,replaceLane->laneIndex),TypeId::V128);
+		}
+		DispatchResult visitShuffle(const Shuffle* shuffle)
+		{
+			auto left = as<V128Class>(visitChild(TypedExpression(shuffle->left,TypeId::V128)));
+			auto right = as<V128Class>(visitChild(TypedExpression(shuffle->right,TypeId::V128)));
+			return TypedExpression(new(arena) Shuffle(shuffle->laneType,left,right,shuffle->laneIndices),TypeId::V128);
+		}
 	};
 }
\ No newline at end of file
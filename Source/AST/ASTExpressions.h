@@ -34,16 +34,25 @@ namespace AST
 		: Expression(op,inTypeClass), value(inValue), variableIndex(inVariableIndex) {}
 	};
 
+	// Returns the log2 of the number of bytes of a memory type, which is the alignment a load or store of the type has by default.
+	inline uint8 getNaturalAlignmentLog2(TypeId memoryType)
+	{
+		uint8 alignmentLog2 = 0;
+		while((size_t(8) << alignmentLog2) < getTypeBitWidth(memoryType)) { ++alignmentLog2; }
+		return alignmentLog2;
+	}
+
+	// The address of a load or store is promised to be a multiple of 2^alignmentLog2 bytes.
 	template<typename Class>
 	struct Load : public Expression<Class>
 	{
 		bool isFarAddress;
-		bool isAligned;
+		uint8 alignmentLog2;
 		Expression<IntClass>* address;
 		TypeId memoryType;
 
-		Load(typename Class::Op op,bool inIsFarAddress,bool inIsAligned,Expression<IntClass>* inAddress,TypeId inMemoryType)
-		: Expression<Class>(op), isFarAddress(inIsFarAddress), isAligned(inIsAligned), address(inAddress), memoryType(inMemoryType) {}
+		Load(typename Class::Op op,bool inIsFarAddress,uint8 inAlignmentLog2,Expression<IntClass>* inAddress,TypeId inMemoryType)
+		: Expression<Class>(op), isFarAddress(inIsFarAddress), alignmentLog2(inAlignmentLog2), address(inAddress), memoryType(inMemoryType) {}
 	};
 	
 	template<typename Class>
@@ -57,13 +66,13 @@ namespace AST
 	struct Store : public Expression<Class>
 	{
 		bool isFarAddress;
-		bool isAligned;
+		uint8 alignmentLog2;
 		Expression<IntClass>* address;
 		TypedExpression value;
 		TypeId memoryType;
 
-		Store(bool inIsFarAddress,bool inIsAligned,Expression<IntClass>* inAddress,TypedExpression inValue,TypeId inMemoryType)
-		: Expression<Class>(Class::Op::store), isFarAddress(inIsFarAddress), isAligned(inIsAligned), address(inAddress), value(inValue), memoryType(inMemoryType) {}
+		Store(bool inIsFarAddress,uint8 inAlignmentLog2,Expression<IntClass>* inAddress,TypedExpression inValue,TypeId inMemoryType)
+		: Expression<Class>(Class::Op::store), isFarAddress(inIsFarAddress), alignmentLog2(inAlignmentLog2), address(inAddress), value(inValue), memoryType(inMemoryType) {}
 	};
 
 	template<typename Class>
@@ -115,6 +124,99 @@ namespace AST
 		: Expression(AnyOp::callIndirect,inTypeClass), tableIndex(inTableIndex), functionIndex(inFunctionIndex), parameters(inParameters) {}
 	};
 
+	// An atomic access to the instance memory. The accessed value has the same type as the expression, except for atomicWait and
+	// atomicNotify, which always access an I32.
+	// atomicLoad has no operand. atomicStore results in the stored value. The read-modify-write ops and atomicCompareExchange
+	// result in the value that was in memory before the operation; atomicCompareExchange stores replacement if that value equals operand.
+	// atomicWait blocks while the I32 at address equals operand, for up to replacement (an I64) nanoseconds if it's non-negative.
+	// It results in 0 if woken by atomicNotify, 1 if the value didn't match operand, or 2 if it timed out.
+	// atomicNotify wakes up to operand threads waiting on address, and results in the number of threads it woke.
+	struct Atomic : public Expression<IntClass>
+	{
+		Expression<IntClass>* address; // must be I32
+		Expression<IntClass>* operand;
+		Expression<IntClass>* replacement; // only used by atomicCompareExchange and atomicWait
+
+		Atomic(Op op,Expression<IntClass>* inAddress,Expression<IntClass>* inOperand,Expression<IntClass>* inReplacement)
+		: Expression(op), address(inAddress), operand(inOperand), replacement(inReplacement) {}
+
+		// Returns the types of the operand and replacement for an atomic op that results in the given type.
+		// The operand type is also the type of the value accessed in memory.
+		static TypeId getOperandType(Op op,TypeId type) { return op == Op::atomicWait || op == Op::atomicNotify ? TypeId::I32 : type; }
+		static TypeId getReplacementType(Op op,TypeId type) { return op == Op::atomicWait ? TypeId::I64 : type; }
+	};
+
+	// The number of lanes in a V128 divided into lanes of the given numeric type.
+	inline uintptr_t getNumV128Lanes(TypeId laneType) { return 128 / getTypeBitWidth(laneType); }
+
+	// Applies a unary op to each lane of a V128, divided into lanes of laneType.
+	struct LaneUnary : public Expression<V128Class>
+	{
+		TypeId laneType;
+		Expression<V128Class>* operand;
+
+		LaneUnary(Op op,TypeId inLaneType,Expression<V128Class>* inOperand)
+		: Expression(op), laneType(inLaneType), operand(inOperand) {}
+	};
+
+	// Applies a binary op to each pair of corresponding lanes of two V128s, divided into lanes of laneType.
+	struct LaneBinary : public Expression<V128Class>
+	{
+		TypeId laneType;
+		Expression<V128Class>* left;
+		Expression<V128Class>* right;
+
+		LaneBinary(Op op,TypeId inLaneType,Expression<V128Class>* inLeft,Expression<V128Class>* inRight)
+		: Expression(op), laneType(inLaneType), left(inLeft), right(inRight) {}
+	};
+
+	// Creates a V128 with every lane set to a scalar. The lane type is the type of the scalar.
+	struct Splat : public Expression<V128Class>
+	{
+		TypedExpression scalar;
+
+		Splat(TypedExpression inScalar): Expression(Op::splat), scalar(inScalar) {}
+	};
+
+	// Reads one lane of a V128. The lane type is the type of the expression.
+	template<typename Class>
+	struct ExtractLane : public Expression<Class>
+	{
+		Expression<V128Class>* vector;
+		uint8 laneIndex;
+
+		ExtractLane(Expression<V128Class>* inVector,uint8 inLaneIndex)
+		: Expression<Class>(Class::Op::extractLane), vector(inVector), laneIndex(inLaneIndex) {}
+	};
+
+	// Results in a copy of a V128 with one lane replaced by a scalar. The lane type is the type of the scalar.
+	struct ReplaceLane : public Expression<V128Class>
+	{
+		Expression<V128Class>* vector;
+		TypedExpression scalar;
+		uint8 laneIndex;
+
+		ReplaceLane(Expression<V128Class>* inVector,TypedExpression inScalar,uint8 inLaneIndex)
+		: Expression(Op::replaceLane), vector(inVector), scalar(inScalar), laneIndex(inLaneIndex) {}
+	};
+
+	// Creates a V128 from lanes selected from two V128s, divided into lanes of laneType.
+	// Each lane index selects a lane of left if it's less than the number of lanes, or a lane of right otherwise.
+	// Only the first getNumV128Lanes(laneType) indices are used.
+	struct Shuffle : public Expression<V128Class>
+	{
+		TypeId laneType;
+		Expression<V128Class>* left;
+		Expression<V128Class>* right;
+		uint8 laneIndices[16];
+
+		Shuffle(TypeId inLaneType,Expression<V128Class>* inLeft,Expression<V128Class>* inRight,const uint8* inLaneIndices)
+		: Expression(Op::shuffle), laneType(inLaneType), left(inLeft), right(inRight)
+		{
+			for(uintptr_t index = 0;index < 16;++index) { laneIndices[index] = inLaneIndices[index]; }
+		}
+	};
+
 	// Used to coerce an expression result to void.
 	struct DiscardResult : public Expression<VoidClass>
 	{
@@ -123,6 +225,19 @@ namespace AST
 		DiscardResult(TypedExpression inExpression): Expression(Op::discardResult), expression(inExpression) {}
 	};
 
+	// Copies, moves, or fills a range of bytes in the instance memory.
+	// For copyMemory and moveMemory, source is the address to read from. For fillMemory, source is the byte value to write.
+	// moveMemory allows the source and destination ranges to overlap; copyMemory does not.
+	struct BulkMemory : public Expression<VoidClass>
+	{
+		Expression<IntClass>* destAddress; // must be I32
+		Expression<IntClass>* source; // must be I32
+		Expression<IntClass>* numBytes; // must be I32
+
+		BulkMemory(Op op,Expression<IntClass>* inDestAddress,Expression<IntClass>* inSource,Expression<IntClass>* inNumBytes)
+		: Expression(op), destAddress(inDestAddress), source(inSource), numBytes(inNumBytes) {}
+	};
+
 	struct Nop : public Expression<VoidClass>
 	{
 		static Nop* get()
@@ -47,6 +47,19 @@ namespace AST
 		AST_OP(reinterpretFloat) \
 		AST_OP(reinterpretBool)
 
+	#define ENUM_AST_ATOMIC_OPS_Int() \
+		AST_OP(atomicLoad) \
+		AST_OP(atomicStore) \
+		AST_OP(atomicAdd) \
+		AST_OP(atomicSub) \
+		AST_OP(atomicAnd) \
+		AST_OP(atomicOr) \
+		AST_OP(atomicXor) \
+		AST_OP(atomicExchange) \
+		AST_OP(atomicCompareExchange) \
+		AST_OP(atomicWait) \
+		AST_OP(atomicNotify)
+
 	#define ENUM_AST_OPS_Int() \
 		ENUM_AST_OPS_Any() \
 		ENUM_AST_UNARY_OPS_Int() \
@@ -54,7 +67,9 @@ namespace AST
 		ENUM_AST_CAST_OPS_Int() \
 		AST_OP(lit) \
 		AST_OP(loadZExt) \
-		AST_OP(loadSExt)
+		AST_OP(loadSExt) \
+		ENUM_AST_ATOMIC_OPS_Int() \
+		AST_OP(extractLane)
 
 	#define ENUM_AST_UNARY_OPS_Float() \
 		AST_OP(neg) \
@@ -87,7 +102,42 @@ namespace AST
 		ENUM_AST_UNARY_OPS_Float() \
 		ENUM_AST_BINARY_OPS_Float() \
 		ENUM_AST_CAST_OPS_Float() \
-		AST_OP(lit)
+		AST_OP(lit) \
+		AST_OP(extractLane)
+
+	// The V128 unary and binary ops treat the vector as 128 bits, and don't depend on how it's divided into lanes.
+	#define ENUM_AST_UNARY_OPS_V128() \
+		AST_OP(bitwiseNot)
+
+	#define ENUM_AST_BINARY_OPS_V128() \
+		AST_OP(bitwiseAnd) \
+		AST_OP(bitwiseOr) \
+		AST_OP(bitwiseXor)
+
+	// The lane ops apply the scalar op to each lane of a vector divided into lanes of a numeric type.
+	#define ENUM_AST_LANE_UNARY_OPS_V128() \
+		AST_OP(neg) \
+		AST_OP(abs) \
+		AST_OP(sqrt)
+
+	#define ENUM_AST_LANE_BINARY_OPS_V128() \
+		AST_OP(add) \
+		AST_OP(sub) \
+		AST_OP(mul) \
+		AST_OP(div) \
+		AST_OP(min) \
+		AST_OP(max)
+
+	#define ENUM_AST_OPS_V128() \
+		ENUM_AST_OPS_Any() \
+		ENUM_AST_UNARY_OPS_V128() \
+		ENUM_AST_BINARY_OPS_V128() \
+		ENUM_AST_LANE_UNARY_OPS_V128() \
+		ENUM_AST_LANE_BINARY_OPS_V128() \
+		AST_OP(lit) \
+		AST_OP(splat) \
+		AST_OP(replaceLane) \
+		AST_OP(shuffle)
 
 	#define ENUM_AST_UNARY_OPS_Bool() \
 		AST_OP(bitwiseNot)
@@ -112,13 +162,15 @@ namespace AST
 
 	#define ENUM_AST_OPS_Void() \
 		ENUM_AST_OPS_Any() \
-		AST_OP(discardResult) AST_OP(nop)
+		AST_OP(discardResult) AST_OP(nop) \
+		AST_OP(copyMemory) AST_OP(moveMemory) AST_OP(fillMemory)
 
 	// Define the ClassOp enums: AnyOp, IntOp, etc.
 	#define AST_OP(op) op,
 	enum class AnyOp : uint8		{ ENUM_AST_OPS_Any() };
 	enum class IntOp : uint8		{ ENUM_AST_OPS_Int() };
 	enum class FloatOp : uint8	{ ENUM_AST_OPS_Float() };
+	enum class V128Op : uint8	{ ENUM_AST_OPS_V128() };
 	enum class BoolOp : uint8	{ ENUM_AST_OPS_Bool() };
 	enum class VoidOp : uint8	{ ENUM_AST_OPS_Void() };
 	#undef AST_OP
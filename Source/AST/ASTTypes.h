@@ -9,30 +9,33 @@ namespace AST
 	enum class AnyOp : uint8_t;
 	enum class IntOp : uint8_t;
 	enum class FloatOp : uint8_t;
+	enum class V128Op : uint8_t;
 	enum class BoolOp : uint8_t;
 	enum class VoidOp : uint8_t;
 
-	#define ENUM_AST_TYPECLASSES_WITHOUT_ANY() AST_TYPECLASS(Int) AST_TYPECLASS(Float) AST_TYPECLASS(Bool) AST_TYPECLASS(Void)
+	#define ENUM_AST_TYPECLASSES_WITHOUT_ANY() AST_TYPECLASS(Int) AST_TYPECLASS(Float) AST_TYPECLASS(V128) AST_TYPECLASS(Bool) AST_TYPECLASS(Void)
 	#define ENUM_AST_TYPECLASSES() AST_TYPECLASS(Any) ENUM_AST_TYPECLASSES_WITHOUT_ANY()
 	
 	#define ENUM_AST_TYPES_Int(callback,...) callback(I8,Int,__VA_ARGS__) callback(I16,Int,__VA_ARGS__) callback(I32,Int,__VA_ARGS__) callback(I64,Int,__VA_ARGS__)
 	#define ENUM_AST_TYPES_Float(callback,...) callback(F32,Float,__VA_ARGS__) callback(F64,Float,__VA_ARGS__)
+	#define ENUM_AST_TYPES_V128(callback,...) callback(V128,V128,__VA_ARGS__)
 	#define ENUM_AST_TYPES_Bool(callback,...) callback(Bool,Bool,__VA_ARGS__)
 	#define ENUM_AST_TYPES_Void(callback,...) callback(Void,Void,__VA_ARGS__)
 	#define ENUM_AST_TYPES_Numeric(callback,...) ENUM_AST_TYPES_Int(callback,__VA_ARGS__) ENUM_AST_TYPES_Float(callback,__VA_ARGS__)
-	#define ENUM_AST_TYPES_NonVoid(callback,...) ENUM_AST_TYPES_Numeric(callback,__VA_ARGS__) ENUM_AST_TYPES_Bool(callback,__VA_ARGS__)
+	#define ENUM_AST_TYPES_NonVoid(callback,...) ENUM_AST_TYPES_Numeric(callback,__VA_ARGS__) ENUM_AST_TYPES_V128(callback,__VA_ARGS__) ENUM_AST_TYPES_Bool(callback,__VA_ARGS__)
 	#define ENUM_AST_TYPES(callback,...) ENUM_AST_TYPES_NonVoid(callback,__VA_ARGS__) ENUM_AST_TYPES_Void(callback,__VA_ARGS__)
 
 	// Can't recursively expand macros, so we have to manually enumerate one side of the pair.
     #define ENUM_AST_TYPE_PAIRS(callback,...) \
-        callback(I8,I8,__VA_ARGS__)    callback(I16,I8,__VA_ARGS__)    callback(I32,I8,__VA_ARGS__)    callback(I64,I8,__VA_ARGS__)    callback(F32,I8,__VA_ARGS__)    callback(F64,I8,__VA_ARGS__)    callback(Bool,I8,__VA_ARGS__)    callback(Void,I8,__VA_ARGS__) \
-        callback(I8,I16,__VA_ARGS__)    callback(I16,I16,__VA_ARGS__)    callback(I32,I16,__VA_ARGS__)    callback(I64,I16,__VA_ARGS__)    callback(F32,I16,__VA_ARGS__)    callback(F64,I16,__VA_ARGS__)    callback(Bool,I16,__VA_ARGS__)    callback(Void,I16,__VA_ARGS__) \
-        callback(I8,I32,__VA_ARGS__)    callback(I16,I32,__VA_ARGS__)    callback(I32,I32,__VA_ARGS__)    callback(I64,I32,__VA_ARGS__)    callback(F32,I32,__VA_ARGS__)    callback(F64,I32,__VA_ARGS__)    callback(Bool,I32,__VA_ARGS__)    callback(Void,I32,__VA_ARGS__) \
-        callback(I8,I64,__VA_ARGS__)    callback(I16,I64,__VA_ARGS__)    callback(I32,I64,__VA_ARGS__)    callback(I64,I64,__VA_ARGS__)    callback(F32,I64,__VA_ARGS__)    callback(F64,I64,__VA_ARGS__)    callback(Bool,I64,__VA_ARGS__)    callback(Void,I64,__VA_ARGS__) \
-        callback(I8,F32,__VA_ARGS__)    callback(I16,F32,__VA_ARGS__)    callback(I32,F32,__VA_ARGS__)    callback(I64,F32,__VA_ARGS__)    callback(F32,F32,__VA_ARGS__)    callback(F64,F32,__VA_ARGS__)    callback(Bool,F32,__VA_ARGS__)    callback(Void,F32,__VA_ARGS__) \
-        callback(I8,F64,__VA_ARGS__)    callback(I16,F64,__VA_ARGS__)    callback(I32,F64,__VA_ARGS__)    callback(I64,F64,__VA_ARGS__)    callback(F32,F64,__VA_ARGS__)    callback(F64,F64,__VA_ARGS__)    callback(Bool,F64,__VA_ARGS__)    callback(Void,F64,__VA_ARGS__) \
-        callback(I8,Bool,__VA_ARGS__)    callback(I16,Bool,__VA_ARGS__)    callback(I32,Bool,__VA_ARGS__)    callback(I64,Bool,__VA_ARGS__)    callback(F32,Bool,__VA_ARGS__)    callback(F64,Bool,__VA_ARGS__)    callback(Bool,Bool,__VA_ARGS__)    callback(Void,Bool,__VA_ARGS__) \
-        callback(I8,Void,__VA_ARGS__)    callback(I16,Void,__VA_ARGS__)    callback(I32,Void,__VA_ARGS__)    callback(I64,Void,__VA_ARGS__)    callback(F32,Void,__VA_ARGS__)    callback(F64,Void,__VA_ARGS__)    callback(Bool,Void,__VA_ARGS__)    callback(Void,Void,__VA_ARGS__)
+        callback(I8,I8,__VA_ARGS__)    callback(I16,I8,__VA_ARGS__)    callback(I32,I8,__VA_ARGS__)    callback(I64,I8,__VA_ARGS__)    callback(F32,I8,__VA_ARGS__)    callback(F64,I8,__VA_ARGS__)    callback(V128,I8,__VA_ARGS__)    callback(Bool,I8,__VA_ARGS__)    callback(Void,I8,__VA_ARGS__) \
+        callback(I8,I16,__VA_ARGS__)    callback(I16,I16,__VA_ARGS__)    callback(I32,I16,__VA_ARGS__)    callback(I64,I16,__VA_ARGS__)    callback(F32,I16,__VA_ARGS__)    callback(F64,I16,__VA_ARGS__)    callback(V128,I16,__VA_ARGS__)    callback(Bool,I16,__VA_ARGS__)    callback(Void,I16,__VA_ARGS__) \
+        callback(I8,I32,__VA_ARGS__)    callback(I16,I32,__VA_ARGS__)    callback(I32,I32,__VA_ARGS__)    callback(I64,I32,__VA_ARGS__)    callback(F32,I32,__VA_ARGS__)    callback(F64,I32,__VA_ARGS__)    callback(V128,I32,__VA_ARGS__)    callback(Bool,I32,__VA_ARGS__)    callback(Void,I32,__VA_ARGS__) \
+        callback(I8,I64,__VA_ARGS__)    callback(I16,I64,__VA_ARGS__)    callback(I32,I64,__VA_ARGS__)    callback(I64,I64,__VA_ARGS__)    callback(F32,I64,__VA_ARGS__)    callback(F64,I64,__VA_ARGS__)    callback(V128,I64,__VA_ARGS__)    callback(Bool,I64,__VA_ARGS__)    callback(Void,I64,__VA_ARGS__) \
+        callback(I8,F32,__VA_ARGS__)    callback(I16,F32,__VA_ARGS__)    callback(I32,F32,__VA_ARGS__)    callback(I64,F32,__VA_ARGS__)    callback(F32,F32,__VA_ARGS__)    callback(F64,F32,__VA_ARGS__)    callback(V128,F32,__VA_ARGS__)    callback(Bool,F32,__VA_ARGS__)    callback(Void,F32,__VA_ARGS__) \
+        callback(I8,F64,__VA_ARGS__)    callback(I16,F64,__VA_ARGS__)    callback(I32,F64,__VA_ARGS__)    callback(I64,F64,__VA_ARGS__)    callback(F32,F64,__VA_ARGS__)    callback(F64,F64,__VA_ARGS__)    callback(V128,F64,__VA_ARGS__)    callback(Bool,F64,__VA_ARGS__)    callback(Void,F64,__VA_ARGS__) \
+        callback(I8,V128,__VA_ARGS__)    callback(I16,V128,__VA_ARGS__)    callback(I32,V128,__VA_ARGS__)    callback(I64,V128,__VA_ARGS__)    callback(F32,V128,__VA_ARGS__)    callback(F64,V128,__VA_ARGS__)    callback(V128,V128,__VA_ARGS__)    callback(Bool,V128,__VA_ARGS__)    callback(Void,V128,__VA_ARGS__) \
+        callback(I8,Bool,__VA_ARGS__)    callback(I16,Bool,__VA_ARGS__)    callback(I32,Bool,__VA_ARGS__)    callback(I64,Bool,__VA_ARGS__)    callback(F32,Bool,__VA_ARGS__)    callback(F64,Bool,__VA_ARGS__)    callback(V128,Bool,__VA_ARGS__)    callback(Bool,Bool,__VA_ARGS__)    callback(Void,Bool,__VA_ARGS__) \
+        callback(I8,Void,__VA_ARGS__)    callback(I16,Void,__VA_ARGS__)    callback(I32,Void,__VA_ARGS__)    callback(I64,Void,__VA_ARGS__)    callback(F32,Void,__VA_ARGS__)    callback(F64,Void,__VA_ARGS__)    callback(V128,Void,__VA_ARGS__)    callback(Bool,Void,__VA_ARGS__)    callback(Void,Void,__VA_ARGS__)
 
 	// Provides typedefs that match the AST type names.
 	namespace NativeTypes
@@ -43,6 +46,15 @@ namespace AST
 		typedef uint64_t I64;
 		typedef float32 F32;
 		typedef float64 F64;
+		union V128
+		{
+			uint8_t u8[16];
+			uint16_t u16[8];
+			uint32_t u32[4];
+			uint64_t u64[2];
+			float32 f32[4];
+			float64 f64[2];
+		};
 		typedef bool Bool;
 		typedef void Void;
 	};
@@ -113,7 +125,7 @@ namespace AST
 	// Returns whether a type is part of a type class.
 	bool isTypeClass(TypeId type,TypeClassId typeClass);
 
-	// Returns the primary class for a type: Int, Float, Bool, Void.
+	// Returns the primary class for a type: Int, Float, V128, Bool, Void.
 	TypeClassId getPrimaryTypeClass(TypeId type);
 	
 	// Returns a string with the name of a type.
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Core/Core.h"
+
+namespace FloatParsing
+{
+	// Parses a decimal or hexadecimal floating-point number, and rounds it to the nearest float64.
+	// Decimal numbers have the form [+-]digits[.digits][(e|E)[+-]digits], and hexadecimal numbers have the form
+	// [+-]0xhexdigits[.hexdigits][(p|P)[+-]digits], where the p exponent is a power of 2.
+	// Returns a pointer to the character following the number, or nullptr if the string doesn't start with a number.
+	// Numbers that are too large to represent as a float64 result in an infinity.
+	const char* parseFloat64(const char* string,float64& outValue);
+
+	// Parses a number in the same forms as parseFloat64, but rounds it directly to the nearest float32.
+	// Rounding the result of parseFloat64 to a float32 can round twice, and produce a different float32 for numbers close to halfway between two float32s.
+	const char* parseFloat32(const char* string,float32& outValue);
+
+	// Converts significand*10^exponent to the nearest float64, using the Eisel-Lemire algorithm.
+	// Returns false in the rare cases that a 128-bit approximation of the power of 10 isn't precise enough to determine the rounding,
+	// in which case the caller must fall back to an exact conversion.
+	bool decimalToFloat64(uint64 significand,int64 exponent,bool isNegative,float64& outValue);
+}
\ No newline at end of file
@@ -88,6 +88,33 @@ namespace Memory
 		}
 	}
 
+	void Arena::absorb(Arena& otherArena)
+	{
+		if(!otherArena.currentSegment) { return; }
+
+		if(!currentSegment)
+		{
+			currentSegment = otherArena.currentSegment;
+			currentSegmentAllocatedBytes = otherArena.currentSegmentAllocatedBytes;
+		}
+		else
+		{
+			// Link the other arena's segments in below the current segment, so this arena can keep allocating from the current segment.
+			auto otherFirstSegment = otherArena.currentSegment;
+			while(otherFirstSegment->previousSegment) { otherFirstSegment = otherFirstSegment->previousSegment; }
+			otherFirstSegment->previousSegment = currentSegment->previousSegment;
+			currentSegment->previousSegment = otherArena.currentSegment;
+			totalWastedBytes += otherArena.currentSegment->totalBytes - otherArena.currentSegmentAllocatedBytes;
+		}
+		totalAllocatedBytes += otherArena.totalAllocatedBytes;
+		totalWastedBytes += otherArena.totalWastedBytes;
+
+		otherArena.currentSegment = nullptr;
+		otherArena.currentSegmentAllocatedBytes = 0;
+		otherArena.totalAllocatedBytes = 0;
+		otherArena.totalWastedBytes = 0;
+	}
+
 	void Arena::revert(Segment* newSegment,size_t newSegmentAllocatedBytes,size_t newTotalAllocatedBytes,size_t newTotalWastedBytes)
 	{
 		currentSegmentAllocatedBytes = newSegmentAllocatedBytes;
@@ -122,11 +149,8 @@ namespace Memory
 	ScopedArena::~ScopedArena() { restore(); }
 	Arena& ScopedArena::getArena() const
 	{
-		static THREAD_LOCAL Arena* scopedArena = nullptr;
-		if(!scopedArena)
-		{
-			scopedArena = new Arena();
-		}
-		return *scopedArena;
+		// This uses thread_local instead of THREAD_LOCAL, so the arena is destroyed and its memory freed when the thread exits.
+		static thread_local Arena scopedArena;
+		return scopedArena;
 	}
 }
\ No newline at end of file
@@ -41,6 +41,10 @@ namespace Memory
 
 		template<typename T> T* copyToArena(const T* source,size_t count) { auto dest = allocate<T>(count); std::copy(source,source+count,dest); return dest; }
 
+		// Transfers the memory allocated from another arena to this arena, leaving the other arena empty.
+		// The other arena's allocations remain valid until this arena is destroyed.
+		void absorb(Arena& otherArena);
+
 		size_t getTotalAllocatedBytes() const { return totalAllocatedBytes; }
 		size_t getTotalWastedBytes() const { return totalWastedBytes; }
 
@@ -104,6 +108,18 @@ namespace Memory
 				numReservedElements = numElements;
 			}
 		}
+		void push_back(Arena& arena,const Element& element)
+		{
+			resize(arena,numElements + 1);
+			elements[numElements - 1] = element;
+		}
+		// Replaces the array's elements with a copy of an array, without reserving any extra space.
+		void assign(Arena& arena,const Element* source,size_t numSourceElements)
+		{
+			elements = arena.reallocate(elements,numReservedElements,numSourceElements);
+			numElements = numReservedElements = numSourceElements;
+			std::copy(source,source + numSourceElements,elements);
+		}
 
 		friend bool operator==(const ArenaArray<Element>& left,const ArenaArray<Element>& right)
 		{
@@ -118,6 +134,8 @@ namespace Memory
 		const Element& operator[](uintptr_t index) const { assert(index < numElements); return elements[index]; }
 		Element& operator[](uintptr_t index) { assert(index < numElements); return elements[index]; }
 		size_t size() const { return numElements; }
+		const Element* begin() const { return elements; }
+		const Element* end() const { return elements + numElements; }
 	private:
 		Element* elements;
 		size_t numElements;
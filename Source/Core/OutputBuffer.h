@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Core/Core.h"
+#include <cstdio>
+
+namespace Core
+{
+	// A buffered sink for printing large amounts of text. The text is accumulated in a fixed size buffer,
+	// and passed to the derived class in large blocks.
+	struct OutputBuffer
+	{
+		OutputBuffer(): numBufferedChars(0) {}
+		OutputBuffer(const OutputBuffer&) = delete;
+		virtual ~OutputBuffer() {}
+
+		void write(char c)
+		{
+			if(numBufferedChars == bufferSize) { flush(); }
+			buffer[numBufferedChars++] = c;
+		}
+		void write(const char* chars,size_t numChars)
+		{
+			if(numBufferedChars + numChars > bufferSize)
+			{
+				flush();
+				if(numChars > bufferSize) { writeUnbuffered(chars,numChars); return; }
+			}
+			memcpy(buffer + numBufferedChars,chars,numChars);
+			numBufferedChars += numChars;
+		}
+		void write(const char* string) { write(string,strlen(string)); }
+		void write(const std::string& string) { write(string.c_str(),string.length()); }
+
+		// Passes any buffered text to the derived class.
+		void flush()
+		{
+			if(numBufferedChars)
+			{
+				writeUnbuffered(buffer,numBufferedChars);
+				numBufferedChars = 0;
+			}
+		}
+
+	protected:
+		virtual void writeUnbuffered(const char* chars,size_t numChars) = 0;
+
+	private:
+		enum { bufferSize = 65536 };
+		char buffer[bufferSize];
+		size_t numBufferedChars;
+	};
+
+	// An OutputBuffer that appends the text to a string.
+	struct StringOutputBuffer : OutputBuffer
+	{
+		StringOutputBuffer(size_t numReservedChars = 0) { string.reserve(numReservedChars); }
+		~StringOutputBuffer() { flush(); }
+
+		std::string& getString() { flush(); return string; }
+
+	protected:
+		void writeUnbuffered(const char* chars,size_t numChars) { string.append(chars,numChars); }
+
+	private:
+		std::string string;
+	};
+
+	// An OutputBuffer that writes the text to a stdio file. hasError returns true if any of the writes failed.
+	struct FileOutputBuffer : OutputBuffer
+	{
+		FileOutputBuffer(FILE* inFile): file(inFile), hasWriteError(false) {}
+		~FileOutputBuffer() { flush(); }
+
+		bool hasError() { flush(); return hasWriteError; }
+
+	protected:
+		void writeUnbuffered(const char* chars,size_t numChars)
+		{
+			if(fwrite(chars,1,numChars,file) != numChars) { hasWriteError = true; }
+		}
+
+	private:
+		FILE* file;
+		bool hasWriteError;
+	};
+}
\ No newline at end of file
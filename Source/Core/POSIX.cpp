@@ -6,12 +6,19 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 
 #include <iostream>
 #include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdlib.h>
 
 #ifdef __APPLE__
     #define MAP_ANONYMOUS MAP_ANON
+    #include <xlocale.h>
 #endif
 
 namespace Platform
@@ -87,6 +94,89 @@ namespace Platform
 		assert(isPageAligned(baseVirtualAddress));
 		if(munmap(baseVirtualAddress,numPages << getPreferredVirtualPageSizeLog2())) { throw; }
 	}
+
+	uint8* mapFile(const char* filename,size_t& outNumBytes)
+	{
+		int file = open(filename,O_RDONLY);
+		if(file == -1) { return nullptr; }
+
+		struct stat fileStatus;
+		if(fstat(file,&fileStatus) || !fileStatus.st_size)
+		{
+			close(file);
+			return nullptr;
+		}
+
+		auto result = mmap(nullptr,fileStatus.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,file,0);
+		close(file);
+		if(result == MAP_FAILED) { return nullptr; }
+
+		outNumBytes = fileStatus.st_size;
+		return (uint8*)result;
+	}
+
+	void unmapFile(uint8* baseAddress,size_t numBytes)
+	{
+		if(munmap(baseAddress,numBytes)) { throw; }
+	}
+
+	int createFile(const char* filename)
+	{
+		return open(filename,O_WRONLY | O_CREAT | O_TRUNC,0666);
+	}
+
+	bool writeFileBuffers(int fileDescriptor,const WriteBuffer* buffers,size_t numBuffers)
+	{
+		iovec ioVectors[IOV_MAX];
+		while(numBuffers)
+		{
+			// Gather as many of the remaining non-empty buffers as writev accepts.
+			int numIOVectors = 0;
+			size_t numBuffersGathered = 0;
+			for(;numBuffersGathered < numBuffers && numIOVectors < IOV_MAX;++numBuffersGathered)
+			{
+				if(!buffers[numBuffersGathered].numBytes) { continue; }
+				ioVectors[numIOVectors].iov_base = (void*)buffers[numBuffersGathered].data;
+				ioVectors[numIOVectors].iov_len = buffers[numBuffersGathered].numBytes;
+				++numIOVectors;
+			}
+			buffers += numBuffersGathered;
+			numBuffers -= numBuffersGathered;
+
+			// writev may write fewer bytes than requested, so retry until all the gathered buffers have been written.
+			int firstIOVectorIndex = 0;
+			while(firstIOVectorIndex < numIOVectors)
+			{
+				auto numBytesWritten = writev(fileDescriptor,ioVectors + firstIOVectorIndex,numIOVectors - firstIOVectorIndex);
+				if(numBytesWritten < 0)
+				{
+					if(errno == EINTR) { continue; }
+					return false;
+				}
+				while(firstIOVectorIndex < numIOVectors && (size_t)numBytesWritten >= ioVectors[firstIOVectorIndex].iov_len)
+				{
+					numBytesWritten -= ioVectors[firstIOVectorIndex].iov_len;
+					++firstIOVectorIndex;
+				}
+				if(firstIOVectorIndex < numIOVectors)
+				{
+					ioVectors[firstIOVectorIndex].iov_base = (uint8*)ioVectors[firstIOVectorIndex].iov_base + numBytesWritten;
+					ioVectors[firstIOVectorIndex].iov_len -= numBytesWritten;
+				}
+			}
+		}
+		return true;
+	}
+
+	static locale_t getCLocale()
+	{
+		static locale_t cLocale = newlocale(LC_ALL_MASK,"C",(locale_t)0);
+		if(!cLocale) { throw; }
+		return cLocale;
+	}
+
+	float64 parseFloat64InCLocale(const char* string) { return strtod_l(string,nullptr,getCLocale()); }
+	float32 parseFloat32InCLocale(const char* string) { return strtof_l(string,nullptr,getCLocale()); }
 }
 
 #endif
\ No newline at end of file
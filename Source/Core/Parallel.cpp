@@ -0,0 +1,137 @@
+#include "Core/Core.h"
+#include "Core/Parallel.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Parallel
+{
+	uintptr_t getNumHardwareThreads()
+	{
+		const uintptr_t numHardwareThreads = std::thread::hardware_concurrency();
+		return numHardwareThreads ? numHardwareThreads : 1;
+	}
+
+	// A call to forEach that worker threads can help with.
+	struct Job
+	{
+		const std::function<void(uintptr_t,uintptr_t)>* function;
+		uintptr_t numItems;
+		std::atomic<uintptr_t> nextItemIndex;
+
+		// These are protected by the worker pool's mutex.
+		uintptr_t nextThreadIndex;
+		uintptr_t numFreeThreads;
+		uintptr_t numActiveWorkers;
+		std::condition_variable workersFinished;
+	};
+
+	// Claims and processes items of a job until they have all been claimed.
+	static void processItems(Job& job,uintptr_t threadIndex)
+	{
+		while(true)
+		{
+			const uintptr_t itemIndex = job.nextItemIndex++;
+			if(itemIndex >= job.numItems) { break; }
+			(*job.function)(threadIndex,itemIndex);
+		}
+	}
+
+	// Threads that persist between calls to forEach, so each call doesn't have to create and join its own threads.
+	// The threads wait for a job that can use another thread, and process its items alongside the thread that called forEach.
+	struct WorkerPool
+	{
+		std::mutex mutex;
+		std::condition_variable jobAdded;
+		std::vector<Job*> pendingJobs;
+		std::vector<std::thread> threads;
+		bool isShuttingDown;
+
+		WorkerPool(): isShuttingDown(false) {}
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isShuttingDown = true;
+			}
+			jobAdded.notify_all();
+			for(auto& thread : threads) { thread.join(); }
+		}
+
+		// Adds a job to the pending jobs, and starts more threads if there are fewer than the job can use. Must be called with the mutex locked.
+		void addJob(Job* job)
+		{
+			pendingJobs.push_back(job);
+			while(threads.size() < job->numFreeThreads) { threads.push_back(std::thread(&WorkerPool::workerThreadEntry,this)); }
+		}
+
+		// Removes a job from the pending jobs if it's still there. Must be called with the mutex locked.
+		void removeJob(Job* job)
+		{
+			auto jobIt = std::find(pendingJobs.begin(),pendingJobs.end(),job);
+			if(jobIt != pendingJobs.end()) { pendingJobs.erase(jobIt); }
+		}
+
+		void workerThreadEntry()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(true)
+			{
+				jobAdded.wait(lock,[this]{ return pendingJobs.size() || isShuttingDown; });
+				if(isShuttingDown) { break; }
+
+				// Join the oldest pending job, and remove it from the pending jobs once it can't use any more threads.
+				Job* job = pendingJobs.front();
+				const uintptr_t threadIndex = job->nextThreadIndex++;
+				++job->numActiveWorkers;
+				if(!--job->numFreeThreads) { removeJob(job); }
+
+				lock.unlock();
+				processItems(*job,threadIndex);
+				lock.lock();
+
+				if(!--job->numActiveWorkers) { job->workersFinished.notify_one(); }
+			}
+		}
+	};
+
+	static WorkerPool& getWorkerPool()
+	{
+		static WorkerPool workerPool;
+		return workerPool;
+	}
+
+	void forEach(uintptr_t numItems,uintptr_t numThreads,const std::function<void(uintptr_t,uintptr_t)>& function)
+	{
+		if(numThreads > numItems) { numThreads = numItems; }
+		if(numThreads <= 1)
+		{
+			for(uintptr_t itemIndex = 0;itemIndex < numItems;++itemIndex) { function(0,itemIndex); }
+			return;
+		}
+
+		Job job;
+		job.function = &function;
+		job.numItems = numItems;
+		job.nextItemIndex = 0;
+		job.nextThreadIndex = 1;
+		job.numFreeThreads = numThreads - 1;
+		job.numActiveWorkers = 0;
+
+		// Offer the job to the worker threads, and process items on the calling thread until they are all claimed.
+		// The calling thread doesn't depend on the workers to make progress, so nested calls from a worker can't deadlock even if all the workers are busy.
+		WorkerPool& workerPool = getWorkerPool();
+		{
+			std::lock_guard<std::mutex> lock(workerPool.mutex);
+			workerPool.addJob(&job);
+		}
+		workerPool.jobAdded.notify_all();
+		processItems(job,0);
+
+		// Stop any more workers from joining the job, and wait for the workers that joined it to finish their last items.
+		std::unique_lock<std::mutex> lock(workerPool.mutex);
+		workerPool.removeJob(&job);
+		job.workersFinished.wait(lock,[&job]{ return !job.numActiveWorkers; });
+	}
+}
\ No newline at end of file
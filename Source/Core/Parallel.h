@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Core/Core.h"
+#include <functional>
+
+namespace Parallel
+{
+	// Returns the number of threads the machine can run concurrently, or 1 if it can't be determined.
+	uintptr_t getNumHardwareThreads();
+
+	// Calls function(threadIndex,itemIndex) for each itemIndex in [0,numItems), using up to numThreads threads including the calling thread.
+	// threadIndex is in [0,numThreads), and identifies the thread the item is processed on, so the function may use per-thread state.
+	// The threads claim the items one at a time in increasing order, so items that take uneven amounts of time are balanced across the threads.
+	// Returns after the function has returned for all items. With numThreads <= 1, the items are processed in order on the calling thread.
+	// The other threads are taken from a pool of worker threads that persist between calls. forEach may be called from within the function.
+	void forEach(uintptr_t numItems,uintptr_t numThreads,const std::function<void(uintptr_t,uintptr_t)>& function);
+}
\ No newline at end of file
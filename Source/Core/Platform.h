@@ -61,4 +61,31 @@ namespace Platform
 	// Frees virtual addresses. Any physical memory committed to the addresses must have already been decommitted.
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	void freeVirtualPages(uint8* baseVirtualAddress,size_t numPages);
+
+	// Maps a file into memory with copy-on-write semantics: the pages may be written to, but the writes are private to the process.
+	// Returns the base address of the mapped file, or nullptr if the file couldn't be opened or mapped.
+	uint8* mapFile(const char* filename,size_t& outNumBytes);
+
+	// Unmaps a file that was mapped by mapFile.
+	void unmapFile(uint8* baseAddress,size_t numBytes);
+
+	// A range of bytes to write to a file.
+	struct WriteBuffer
+	{
+		const uint8* data;
+		size_t numBytes;
+	};
+
+	// Creates a file, or truncates it if it already exists, and opens it for writing.
+	// Returns the file descriptor, or -1 if the file couldn't be created.
+	int createFile(const char* filename);
+
+	// Writes a sequence of buffers to a file descriptor, using as few system calls as possible.
+	// Returns false if the write failed.
+	bool writeFileBuffers(int fileDescriptor,const WriteBuffer* buffers,size_t numBuffers);
+
+	// Converts the number at the start of a string like strtod and strtof, but in the C locale instead of the current locale,
+	// so the decimal point is always '.'.
+	float64 parseFloat64InCLocale(const char* string);
+	float32 parseFloat32InCLocale(const char* string);
 }
\ No newline at end of file
@@ -1,41 +1,154 @@
 #include "Core/Core.h"
 #include "Core/SExpressions.h"
+#include "Core/FloatParsing.h"
+#include "Core/StringHashMap.h"
 #include <initializer_list>
 #include <limits>
 #include <cmath>
 
+// Whitespace, comments, and symbols are scanned a block of characters at a time with SSE2 or AVX2 if they're available.
+#if defined(__AVX2__)
+	#define WITH_SIMD_SCANNING 1
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define WITH_SIMD_SCANNING 1
+	#include <emmintrin.h>
+#else
+	#define WITH_SIMD_SCANNING 0
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
 namespace SExp
 {
+	#if WITH_SIMD_SCANNING
+		#ifdef __AVX2__
+			typedef __m256i CharBlock;
+			enum { charBlockSize = 32 };
+			static CharBlock loadCharBlock(const char* address) { return _mm256_load_si256((const __m256i*)address); }
+			static uint32 getCharMask(CharBlock block,char c) { return (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block,_mm256_set1_epi8(c))); }
+			static const uint32 fullCharBlockMask = 0xffffffff;
+		#else
+			typedef __m128i CharBlock;
+			enum { charBlockSize = 16 };
+			static CharBlock loadCharBlock(const char* address) { return _mm_load_si128((const __m128i*)address); }
+			static uint32 getCharMask(CharBlock block,char c) { return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(block,_mm_set1_epi8(c))); }
+			static const uint32 fullCharBlockMask = 0xffff;
+		#endif
+
+		#ifdef _MSC_VER
+			static uint32 getLowestSetBitIndex(uint32 mask) { unsigned long index; _BitScanForward(&index,mask); return index; }
+		#else
+			static uint32 getLowestSetBitIndex(uint32 mask) { return __builtin_ctz(mask); }
+		#endif
+
+		// Returns the block-aligned address containing a character. Loading aligned blocks never reads from a virtual page that
+		// doesn't contain part of the string, so it's safe to read past the null terminator up to the end of its block.
+		static const char* getCharBlockAddress(const char* c) { return (const char*)(reinterpret_cast<uintptr_t>(c) & ~(uintptr_t)(charBlockSize - 1)); }
+
+		// Returns a mask of the characters in a block that are whitespace.
+		static uint32 getWhitespaceMask(CharBlock block)
+		{
+			return getCharMask(block,' ') | getCharMask(block,'\t') | getCharMask(block,'\r') | getCharMask(block,'\n');
+		}
+	#endif
+
+	// Finds the first character at or following a position that isn't whitespace.
+	static const char* findEndOfWhitespace(const char* next)
+	{
+		#if WITH_SIMD_SCANNING
+			auto blockAddress = getCharBlockAddress(next);
+			uint32 includeMask = (fullCharBlockMask << (next - blockAddress)) & fullCharBlockMask;
+			while(true)
+			{
+				uint32 stopMask = ~getWhitespaceMask(loadCharBlock(blockAddress)) & includeMask;
+				if(stopMask) { return blockAddress + getLowestSetBitIndex(stopMask); }
+				blockAddress += charBlockSize;
+				includeMask = fullCharBlockMask;
+			}
+		#else
+			while(*next == ' ' || *next == '\t' || *next == '\r' || *next == '\n') { ++next; }
+			return next;
+		#endif
+	}
+
+	// Finds the first newline or null terminator at or following a position.
+	static const char* findEndOfLine(const char* next)
+	{
+		#if WITH_SIMD_SCANNING
+			auto blockAddress = getCharBlockAddress(next);
+			uint32 includeMask = (fullCharBlockMask << (next - blockAddress)) & fullCharBlockMask;
+			while(true)
+			{
+				auto block = loadCharBlock(blockAddress);
+				uint32 stopMask = (getCharMask(block,'\n') | getCharMask(block,0)) & includeMask;
+				if(stopMask) { return blockAddress + getLowestSetBitIndex(stopMask); }
+				blockAddress += charBlockSize;
+				includeMask = fullCharBlockMask;
+			}
+		#else
+			while(*next != '\n' && *next != 0) { ++next; }
+			return next;
+		#endif
+	}
+
+	// Finds the first character at or following a position that can't be part of a symbol, or the null terminator.
+	static const char* findEndOfSymbol(const char* next)
+	{
+		#if WITH_SIMD_SCANNING
+			auto blockAddress = getCharBlockAddress(next);
+			uint32 includeMask = (fullCharBlockMask << (next - blockAddress)) & fullCharBlockMask;
+			while(true)
+			{
+				auto block = loadCharBlock(blockAddress);
+				uint32 stopMask = getWhitespaceMask(block)
+					| getCharMask(block,'(') | getCharMask(block,')') | getCharMask(block,';') | getCharMask(block,'\"') | getCharMask(block,0);
+				stopMask &= includeMask;
+				if(stopMask) { return blockAddress + getLowestSetBitIndex(stopMask); }
+				blockAddress += charBlockSize;
+				includeMask = fullCharBlockMask;
+			}
+		#else
+			while(*next && *next != ' ' && *next != '\t' && *next != '\r' && *next != '\n'
+			&& *next != '(' && *next != ')' && *next != ';' && *next != '\"') { ++next; }
+			return next;
+		#endif
+	}
+
 	struct FatalParseException
 	{
-		Core::TextFileLocus locus;
+		uint32 offset;
 		std::string message;
-		FatalParseException(const Core::TextFileLocus& inLocus,std::string&& inMessage)
-		: locus(inLocus), message(std::move(inMessage)) {}
+		FatalParseException(uint32 inOffset,std::string&& inMessage)
+		: offset(inOffset), message(std::move(inMessage)) {}
 	};
 
 	struct StreamState
 	{
 		StreamState(const char* inString)
-		:	next(inString)
+		:	string(inString)
+		,	next(inString)
 		{}
 
 		void advance()
 		{
-			switch(*next)
-			{
-			case 0: throw new FatalParseException(locus,"unexpected end of file");
-			case '\n': locus.newlines++; locus.tabs = 0; locus.characters = 0; break;
-			case '\t': locus.tabs++; break;
-			default: locus.characters++; break;
-			};
+			if(!*next) { throw new FatalParseException(getOffset(),"unexpected end of file"); }
 			next++;
 		}
+		// Advances to a position following the current position, without passing the null terminator.
+		void advanceTo(const char* newNext)
+		{
+			assert(newNext >= next);
+			next = newNext;
+		}
 		char get() const
 		{
 			return *next;
 		}
-		Core::TextFileLocus getLocus() const { return locus; }
+		const char* getNext() const { return next; }
+		uint32 getOffset() const { return (uint32)(next - string); }
 
 		// Tries to skip to the next instance of a character, excluding instances between nested parentheses.
 		// If successful, returns true. Will stop skipping and return false if it hits the end of the string or
@@ -71,8 +184,8 @@ namespace SExp
 		}
 
 	private:
+		const char* string;
 		const char* next;
-		Core::TextFileLocus locus;
 	};
 
 	bool isWhitespace(char c)
@@ -142,19 +255,45 @@ namespace SExp
 		return true;
 	}
 
+	// Finds the offset parseQuotedString ends a quoted string node at, including the nodes it turns into errors.
+	uint32 findEndOfQuotedString(const char* string,uint32 startOffset)
+	{
+		StreamState state(string);
+		state.advanceTo(string + startOffset + 1);
+		while(true)
+		{
+			const char nextChar = state.get();
+			if(nextChar == '\n' || nextChar == 0) { return state.getOffset(); }
+			else if(nextChar == '\\')
+			{
+				state.advance();
+				char escapedChar;
+				if(!parseCharEscapeCode(state,escapedChar)) { return state.getOffset(); }
+				state.advance();
+			}
+			else
+			{
+				state.advance();
+				if(nextChar == '\"') { return state.getOffset(); }
+			}
+		}
+	}
+
 	Node* parseQuotedString(StreamState& state,Memory::Arena& arena)
 	{
-		auto node = new(arena)Node(state.getLocus(),NodeType::String);
+		auto node = new(arena)Node(state.getOffset(),NodeType::String);
 		state.advance();
 
+		// Reserve space for the length of the string before its characters: see copyNodeString.
 		Memory::ArenaString string;
+		for(uintptr_t lengthByteIndex = 0;lengthByteIndex < sizeof(uint32);++lengthByteIndex) { string.append(arena,0); }
+
 		while(true)
 		{
 			const char nextChar = state.get();
 			if(nextChar == '\n' || nextChar == 0)
 			{
 				string.reset(arena);
-				node->endLocus = state.getLocus();
 				node->type = NodeType::Error;
 				node->error = "unexpected newline or end of file in quoted string";
 				state.skipToNext('\"');
@@ -167,7 +306,6 @@ namespace SExp
 				if(!parseCharEscapeCode(state,escapedChar))
 				{
 					string.reset(arena);
-					node->endLocus = state.getLocus();
 					node->type = NodeType::Error;
 					node->error = "invalid escape code in quoted string";
 					state.skipToNext('\"');
@@ -185,41 +323,104 @@ namespace SExp
 		}
 
 		string.shrink(arena);
-		node->string = string.c_str();
-		node->stringLength = string.length();
-		node->endLocus = state.getLocus();
+		*(uint32*)string.c_str() = (uint32)(string.length() - sizeof(uint32));
+		node->string = string.c_str() + sizeof(uint32);
 
 		return node;
 	}
 
-	Node* parseSymbol(StreamState& state,Memory::Arena& arena,const SymbolIndexMap& symbolIndexMap)
+	// Maps the upper 32 bits of a symbol hash to a slot using the displacement chosen for its bucket.
+	static uint32 getSymbolSlotIndex(uint64 hash,uint32 displacement,size_t numSlots)
 	{
-		auto node = new(arena)Node(state.getLocus(),NodeType::Symbol);
+		uint64 mixedHash = ((hash >> 32) ^ (displacement * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+		return (uint32)((mixedHash ^ (mixedHash >> 33)) & (numSlots - 1));
+	}
 
-		Memory::ArenaString string;
-		do
+	SymbolIndexMap::SymbolIndexMap(const char* const* symbols,size_t numSymbols)
+	{
+		// This uses the hash and displace algorithm: each symbol is hashed to a bucket, and each bucket gets a displacement
+		// that maps all its symbols to unused slots. The buckets with the most symbols are placed first, while there are
+		// still lots of unused slots.
+		size_t numBuckets = 1;
+		while(numBuckets * 2 < numSymbols) { numBuckets *= 2; }
+		size_t numSlots = 1;
+		while(numSlots < numSymbols * 2) { numSlots *= 2; }
+		bucketDisplacements.resize(numBuckets,0);
+		slots.resize(numSlots,Slot({nullptr,0,UINT32_MAX}));
+
+		// Group the symbols by bucket. If a symbol is duplicated, the last index wins.
+		std::vector<std::vector<uintptr_t>> bucketSymbols(numBuckets);
+		std::vector<uint64> symbolHashes(numSymbols);
+		for(uintptr_t symbolIndex = 0;symbolIndex < numSymbols;++symbolIndex)
 		{
-			string.append(arena,state.get());
-			state.advance();
+			symbolHashes[symbolIndex] = Core::hashString(symbols[symbolIndex],strlen(symbols[symbolIndex]));
+			auto& bucket = bucketSymbols[symbolHashes[symbolIndex] & (numBuckets - 1)];
+			auto duplicateIt = std::find_if(bucket.begin(),bucket.end(),[&](uintptr_t otherIndex) { return !strcmp(symbols[otherIndex],symbols[symbolIndex]); });
+			if(duplicateIt != bucket.end()) { *duplicateIt = symbolIndex; }
+			else { bucket.push_back(symbolIndex); }
 		}
-		while(isSymbolCharacter(state.get()));
 
-		node->endLocus = state.getLocus();
+		std::vector<uintptr_t> bucketOrder(numBuckets);
+		for(uintptr_t bucketIndex = 0;bucketIndex < numBuckets;++bucketIndex) { bucketOrder[bucketIndex] = bucketIndex; }
+		std::stable_sort(bucketOrder.begin(),bucketOrder.end(),[&](uintptr_t left,uintptr_t right) { return bucketSymbols[left].size() > bucketSymbols[right].size(); });
 
-		// Look up the symbol string in the index map.
-		auto symbolIndexIt = symbolIndexMap.find(string.c_str());
-		if(symbolIndexIt == symbolIndexMap.end())
+		std::vector<uint32> bucketSlotIndices;
+		for(auto bucketIndex : bucketOrder)
 		{
-			string.shrink(arena);
-			node->type = NodeType::UnindexedSymbol;
-			node->string = string.c_str();
-			node->stringLength = string.length();
+			const std::vector<uintptr_t>& bucket = bucketSymbols[bucketIndex];
+			if(!bucket.size()) { break; }
+
+			// Find a displacement that maps each symbol in the bucket to a distinct unused slot.
+			for(uint32 displacement = 0;;++displacement)
+			{
+				if(displacement == UINT32_MAX) { throw; }
+				bucketSlotIndices.clear();
+				for(auto symbolIndex : bucket)
+				{
+					auto slotIndex = getSymbolSlotIndex(symbolHashes[symbolIndex],displacement,numSlots);
+					if(slots[slotIndex].string || std::find(bucketSlotIndices.begin(),bucketSlotIndices.end(),slotIndex) != bucketSlotIndices.end()) { break; }
+					bucketSlotIndices.push_back(slotIndex);
+				}
+				if(bucketSlotIndices.size() == bucket.size())
+				{
+					bucketDisplacements[bucketIndex] = displacement;
+					for(uintptr_t bucketSymbolIndex = 0;bucketSymbolIndex < bucket.size();++bucketSymbolIndex)
+					{
+						auto symbolIndex = bucket[bucketSymbolIndex];
+						slots[bucketSlotIndices[bucketSymbolIndex]] = {symbols[symbolIndex],(uint32)strlen(symbols[symbolIndex]),(uint32)symbolIndex};
+					}
+					break;
+				}
+			}
 		}
-		else
+	}
+
+	bool SymbolIndexMap::find(const char* string,size_t numChars,uintptr_t& outIndex) const
+	{
+		auto hash = Core::hashString(string,numChars);
+		auto displacement = bucketDisplacements[hash & (bucketDisplacements.size() - 1)];
+		const Slot& slot = slots[getSymbolSlotIndex(hash,displacement,slots.size())];
+		if(slot.numChars != numChars || !slot.string || memcmp(slot.string,string,numChars)) { return false; }
+		outIndex = slot.index;
+		return true;
+	}
+
+	Node* parseSymbol(StreamState& state,Memory::Arena& arena,const SymbolIndexMap& symbolIndexMap)
+	{
+		auto node = new(arena)Node(state.getOffset(),NodeType::Symbol);
+
+		// Find the end of the symbol.
+		auto symbolStart = state.getNext();
+		auto symbolEnd = findEndOfSymbol(symbolStart);
+		state.advanceTo(symbolEnd);
+		if(!*symbolEnd) { throw new FatalParseException(state.getOffset(),"unexpected end of file"); }
+		size_t symbolLength = symbolEnd - symbolStart;
+
+		// Look up the symbol string in the index map. If it's not in the map, copy it to a null terminated string in the arena.
+		if(!symbolIndexMap.find(symbolStart,symbolLength,node->symbol))
 		{
-			// If the symbol was in the index map, discard the memory for the string and just store it as an index.
-			string.reset(arena);
-			node->symbol = symbolIndexIt->second;
+			node->type = NodeType::UnindexedSymbol;
+			node->string = copyNodeString(arena,symbolStart,symbolLength);
 		}
 
 		return node;
@@ -227,7 +428,8 @@ namespace SExp
 
 	Node* parseNumber(StreamState& state,Memory::Arena& arena)
 	{
-		auto startLocus = state.getLocus();
+		auto startOffset = state.getOffset();
+		const char* numberStart = state.getNext();
 
 		bool isNegative = false;
 		uint8 base = 10;
@@ -236,7 +438,7 @@ namespace SExp
 			isNegative = state.get() == '-';
 			state.advance();
 		}
-		else if(state.get() == '0')
+		if(state.get() == '0')
 		{
 			state.advance();
 			if(state.get() == 'x')
@@ -246,106 +448,94 @@ namespace SExp
 			}
 		}
 
-		// First parse the digits and decimal point.
-		Memory::ArenaString digits;
-		uintptr_t numIntegerDigits = 0;
-		bool hasDecimalPoint = false;
+		// Parse the integer digits.
+		uint64 accumulator = 0;
+		bool notEnoughBits = false;
 		while(true)
 		{
-			auto nextChar = state.get();
-			char hexDigit;
-			if(base == 10 && isDigit(nextChar)) { digits.append(arena,nextChar - '0'); }
-			else if(base == 16 && parseHexDigit(nextChar,hexDigit)) { digits.append(arena,hexDigit); }
-			else if(nextChar == '.')
-			{
-				if(hasDecimalPoint)
-				{
-					auto node = new(arena) Node(state.getLocus(),NodeType::Error);
-					node->error = "number must have no more than one decimal point";
-					return node;
-				}
-				else
-				{
-					numIntegerDigits = digits.length();
-					hasDecimalPoint = true;
-				}
-			}
-			else
-			{
-				break;
-			}
+			char digit;
+			if(base == 10 && isDigit(state.get())) { digit = state.get() - '0'; }
+			else if(base != 16 || !parseHexDigit(state.get(),digit)) { break; }
+
+			// Detect if the uint64 is about to overflow.
+			if(accumulator > (std::numeric_limits<uint64>::max() - digit) / base) { notEnoughBits = true; }
+			accumulator = accumulator * base + digit;
 			state.advance();
 		}
 		
-		if(hasDecimalPoint)
+		const char nextChar = state.get();
+		if(nextChar == '.' || (base == 10 && (nextChar == 'e' || nextChar == 'E')) || (base == 16 && (nextChar == 'p' || nextChar == 'P')))
 		{
-			// If the number has a decimal point, decode its digits into a float64.
-			float64 accumulator = 0.0;
-			float64 digitFactor = isNegative ? -1.0 : 1.0;
-			for(uintptr_t digitIndex = 0;digitIndex < digits.length();++digitIndex)
+			// If the number has a decimal point or an exponent, parse it again as a float64.
+			float64 value;
+			const char* numberEnd = FloatParsing::parseFloat64(numberStart,value);
+			if(!numberEnd)
 			{
-				if(digitIndex < numIntegerDigits)
-				{
-					// Detect if the float64 is about to overflow its maximum value.
-					if(std::abs(accumulator) > std::numeric_limits<float64>::max() / base)
-					{
-						auto node = new(arena) Node(state.getLocus(),NodeType::Error);
-						node->error = "number is too large to represent as a 64-bit float";
-						return node;
-					}
-					accumulator *= base;
-				}
-				else { digitFactor /= base; }
-				accumulator += digitFactor * digits[digitIndex];
+				auto node = new(arena) Node(state.getOffset(),NodeType::Error);
+				node->error = "number must have at least one digit";
+				state.advance();
+				return node;
+			}
+			state.advanceTo(numberEnd);
+			if(state.get() == '.')
+			{
+				auto node = new(arena) Node(state.getOffset(),NodeType::Error);
+				node->error = "number must have no more than one decimal point";
+				return node;
+			}
+			else if(std::isinf(value))
+			{
+				auto node = new(arena) Node(state.getOffset(),NodeType::Error);
+				node->error = "number is too large to represent as a 64-bit float";
+				return node;
+			}
+			else
+			{
+				auto node = new(arena)Node(startOffset,NodeType::Decimal);
+				node->decimal = value;
+				return node;
 			}
-			digits.reset(arena);
-
-			auto node = new(arena)Node(startLocus,NodeType::Decimal);
-			node->decimal = accumulator;
-			return node;
 		}
 		else
 		{
-			// If the number doesn't have a decimal point, decode its digits into an int64.
-			uint64 accumulator = 0;
-			bool notEnoughBits = false;
-			for(uintptr_t digitIndex = 0;digitIndex < digits.length();++digitIndex)
-			{
-				// Detect if the uint64 is about to overflow.
-				if(accumulator > std::numeric_limits<uint64>::max() / base) { notEnoughBits = true; }
-				accumulator *= base;
-				accumulator += digits[digitIndex];
-			}
-			digits.reset(arena);
+			// If the number doesn't have a decimal point, it's an int64.
 			if(isNegative && -(-(int64)accumulator) != (int64)accumulator) { notEnoughBits = true; }			
 			if(notEnoughBits)
 			{
-				auto node = new(arena) Node(state.getLocus(),NodeType::Error);
+				auto node = new(arena) Node(state.getOffset(),NodeType::Error);
 				node->error = "number is too large to represent as a 64-bit integer";
 				return node;
 			}
 			else
 			{
-				auto node = new(arena)Node(startLocus,NodeType::Int);
+				auto node = new(arena)Node(startOffset,NodeType::Int);
 				node->integer = isNegative ? -(int64)accumulator : +accumulator;
 				return node;
 			}
 		}
 	}
 
-	void parseRecursive(StreamState& state,Memory::Arena& arena,const SymbolIndexMap& symbolIndexMap,Node** nextNodePtr)
+	// Parses a sequence of nodes, using an explicit stack of the open tree nodes instead of recursing for each nesting level.
+	// This allows parsing arbitrarily deep S-expressions without the risk of overflowing the thread's stack.
+	void parseNodes(StreamState& state,Memory::Arena& arena,const SymbolIndexMap& symbolIndexMap,Node** nextNodePtr)
 	{
+		std::vector<Node*> openNodeStack;
 		while(true)
 		{
 			const char nextChar = state.get();
 			if(nextChar == 0)
 			{
+				if(openNodeStack.size())
+				{
+					throw new FatalParseException(state.getOffset(),"expected ')' following S-expression child nodes but found '('");
+				}
 				break;
 			}
 			else if(isWhitespace(nextChar))
 			{
-				// Skip whitespace.
-				state.advance();
+				// Skip whitespace. Most whitespace is a single space between tokens, so only scan for the end of longer runs.
+				if(isWhitespace(state.getNext()[1])) { state.advanceTo(findEndOfWhitespace(state.getNext())); }
+				else { state.advance(); }
 			}
 			else if(nextChar == ';')
 			{
@@ -353,10 +543,10 @@ namespace SExp
 				state.advance();
 				if(state.get() != ';')
 				{
-					throw new(arena) FatalParseException(state.getLocus(),std::string("expected ';' following ';' but found '") + nextChar + "'");
+					throw new FatalParseException(state.getOffset(),std::string("expected ';' following ';' but found '") + nextChar + "'");
 				}
 
-				while(state.get() != '\n' && state.get() != 0) state.advance();
+				state.advanceTo(findEndOfLine(state.getNext()));
 			}
 			else if(nextChar == '(')
 			{
@@ -371,7 +561,7 @@ namespace SExp
 						state.advance();
 						if(state.get() == 0)
 						{
-							throw new(arena) FatalParseException(state.getLocus(),"reached end of file while parsing block comment");
+							throw new FatalParseException(state.getOffset(),"reached end of file while parsing block comment");
 						}
 					}
 					while(state.get() != ')');
@@ -379,22 +569,23 @@ namespace SExp
 				}
 				else
 				{
-					// Recursively parse child nodes.
-					auto newNode = new(arena)Node(state.getLocus());
-					parseRecursive(state,arena,symbolIndexMap,&newNode->children);
-					if(state.get() != ')')
-					{
-						throw new(arena) FatalParseException(state.getLocus(),std::string("expected ')' following S-expression child nodes but found '") + nextChar + "'");
-					}
-					state.advance();
+					// Start a tree node, and parse the following nodes as its children until the matching ')'.
+					auto newNode = new(arena)Node(state.getOffset());
 					*nextNodePtr = newNode;
-					nextNodePtr = &newNode->nextSibling;
+					nextNodePtr = &newNode->children;
+					openNodeStack.push_back(newNode);
 				}
 			}
 			else if(nextChar == ')')
 			{
-				// Finish parsing this node.
-				break;
+				// A ')' outside of any tree node ends the sequence.
+				if(!openNodeStack.size()) { break; }
+
+				// Finish parsing the innermost open tree node, and continue parsing its siblings.
+				state.advance();
+				Node* finishedNode = openNodeStack.back();
+				openNodeStack.pop_back();
+				nextNodePtr = &finishedNode->nextSibling;
 			}
 			else if(nextChar == '\"')
 			{
@@ -422,90 +613,293 @@ namespace SExp
 	{
 		try
 		{
+			// Node offsets are 32-bit, so reject strings that have offsets that don't fit.
+			if(strnlen(string,UINT32_MAX) == UINT32_MAX) { throw new FatalParseException(0,"source string is 4GB or larger"); }
+
 			StreamState state(string);
 			Node* firstRootNode = nullptr;
-			parseRecursive(state,arena,symbolIndexMap,&firstRootNode);
+			parseNodes(state,arena,symbolIndexMap,&firstRootNode);
 			return firstRootNode;
 		}
 		catch(FatalParseException* exception)
 		{
-			auto errorNode = new(arena) Node(exception->locus,NodeType::Error);
+			auto errorNode = new(arena) Node(exception->offset,NodeType::Error);
 			errorNode->error = arena.copyToArena(exception->message.c_str(),exception->message.length() + 1);
 			delete exception;
 			return errorNode;
 		}
 	}
 
+	Core::TextFileLocus SourceLocator::getLocus(uint32 offset) const
+	{
+		{
+			Platform::Lock lineIndexLock(lineIndexMutex);
+			if(!lineStartOffsets.size())
+			{
+				// Build the index of line start offsets.
+				lineStartOffsets.push_back(0);
+				#if WITH_SIMD_SCANNING
+					auto blockAddress = getCharBlockAddress(string);
+					uint32 includeMask = (fullCharBlockMask << (string - blockAddress)) & fullCharBlockMask;
+					while(true)
+					{
+						auto block = loadCharBlock(blockAddress);
+						uint32 newlineMask = getCharMask(block,'\n') & includeMask;
+						uint32 endMask = getCharMask(block,0) & includeMask;
+						if(endMask) { newlineMask &= (1u << getLowestSetBitIndex(endMask)) - 1; }
+						while(newlineMask)
+						{
+							lineStartOffsets.push_back((uint32)(blockAddress + getLowestSetBitIndex(newlineMask) + 1 - string));
+							newlineMask &= newlineMask - 1;
+						}
+						if(endMask) { break; }
+						blockAddress += charBlockSize;
+						includeMask = fullCharBlockMask;
+					}
+				#else
+					for(auto c = string;*c;++c)
+					{
+						if(*c == '\n') { lineStartOffsets.push_back((uint32)(c + 1 - string)); }
+					}
+				#endif
+			}
+		}
+
+		// Find the line containing the offset, and count the tabs and other characters preceding the offset on that line.
+		auto lineIt = std::upper_bound(lineStartOffsets.begin(),lineStartOffsets.end(),offset) - 1;
+		uint32 numTabs = 0;
+		for(auto c = string + *lineIt;c < string + offset;++c)
+		{
+			if(*c == '\t') { ++numTabs; }
+		}
+
+		Core::TextFileLocus locus;
+		locus.newlines = (uint32)(lineIt - lineStartOffsets.begin());
+		locus.tabs = (uint16)numTabs;
+		locus.characters = (uint16)(offset - *lineIt - numTabs);
+		return locus;
+	}
+
+	uint32 SourceLocator::getEndOffset(const Node* node) const
+	{
+		switch(node->type)
+		{
+		case NodeType::Symbol: case NodeType::UnindexedSymbol: return (uint32)(findEndOfSymbol(string + node->startOffset) - string);
+		case NodeType::String: return findEndOfQuotedString(string,node->startOffset);
+		case NodeType::Error: return string[node->startOffset] == '\"' ? findEndOfQuotedString(string,node->startOffset) : node->startOffset;
+		// Trees and numbers are located by where they start.
+		default: return node->startOffset;
+		};
+	}
+
 	char nibbleToHexChar(uint8 value) { return value < 10 ? ('0' + value) : 'a' + value - 10; }
 
-	std::string escapeString(const char* string,size_t numChars)
+	// Returns the number of characters a string takes with the escape codes written by printEscapedString.
+	size_t getEscapedStringLength(const char* string,size_t numChars)
+	{
+		size_t result = 0;
+		for(uintptr_t charIndex = 0;charIndex < numChars;++charIndex)
+		{
+			auto c = string[charIndex];
+			if(c == '\\' || c == '\"' || c == '\n') { result += 2; }
+			else if(c < 0x20 || c > 0x7e) { result += 3; }
+			else { ++result; }
+		}
+		return result;
+	}
+
+	void printEscapedString(const char* string,size_t numChars,Core::OutputBuffer& outputBuffer)
 	{
-		std::string result;
 		for(uintptr_t charIndex = 0;charIndex < numChars;++charIndex)
 		{
 			auto c = string[charIndex];
-			if(c == '\\') { result += "\\\\"; }
-			else if(c == '\"') { result += "\\\""; }
-			else if(c == '\n') { result += "\\n"; }
+			if(c == '\\') { outputBuffer.write("\\\\",2); }
+			else if(c == '\"') { outputBuffer.write("\\\"",2); }
+			else if(c == '\n') { outputBuffer.write("\\n",2); }
 			else if(c < 0x20 || c > 0x7e)
 			{
-				result += '\\';
-				result += nibbleToHexChar((c & 0xf0) >> 4);
-				result += nibbleToHexChar((c & 0x0f) >> 0);
+				outputBuffer.write('\\');
+				outputBuffer.write(nibbleToHexChar((c & 0xf0) >> 4));
+				outputBuffer.write(nibbleToHexChar((c & 0x0f) >> 0));
 			}
-			else { result += c; }
+			else { outputBuffer.write(c); }
 		}
-		return result;
 	}
 
-	bool printRecursive(SExp::Node* initialNode,const char* symbolStrings[],std::string& outString,const std::string& newline)
+	// Formats a numeric node the same way std::to_string does, returning the number of characters written to buffer.
+	size_t formatNumber(SExp::Node* node,char (&buffer)[512])
+	{
+		int numChars = node->type == NodeType::Int
+			? snprintf(buffer,sizeof(buffer),"%lld",(long long)node->integer)
+			: snprintf(buffer,sizeof(buffer),"%f",node->decimal);
+		return numChars < 0 ? 0 : std::min((size_t)numChars,sizeof(buffer) - 1);
+	}
+
+	// The printer makes two passes over the tree: the first measures the width each subtree takes printed on a single line, and
+	// decides which sibling lists must be split across multiple lines. The second pass writes the text straight to the output.
+	// Both passes keep an explicit stack of the sibling lists they're in instead of recursing, since the tree may be arbitrarily deep.
+	struct PrintContext
 	{
-		SExp::Node* node = initialNode;
-		std::vector<std::string> childStrings;
-		bool hasMultiLineSubtree = false;
-		do
+		const char** symbolStrings;
+
+		// Whether each sibling list is split across multiple lines, in the pre-order the sibling lists are visited.
+		std::vector<uint8> isMultiLineLists;
+		uintptr_t nextListIndex;
+
+		char numberBuffer[512];
+
+		PrintContext(const char* inSymbolStrings[]): symbolStrings(inSymbolStrings), nextListIndex(0) {}
+
+		// A sibling list that is being measured.
+		struct MeasureFrame
+		{
+			SExp::Node* nextNode;
+			uintptr_t listIndex;
+			uintptr_t numNodes;
+			size_t totalChildLength;
+			bool hasMultiLineSubtree;
+		};
+
+		// A sibling list that is being printed.
+		struct PrintFrame
+		{
+			SExp::Node* nextNode;
+			uintptr_t depth;
+			bool isMultiLine;
+		};
+
+		// Returns the single-line width of a node that isn't a tree.
+		size_t measureLeaf(SExp::Node* node)
 		{
 			switch(node->type)
 			{
-			case NodeType::Tree:
-			{
-				std::string subtreeString;
-				subtreeString += "(";
-				bool isSubtreeMultiLine = printRecursive(node->children,symbolStrings,subtreeString,newline + '\t');
-				if(isSubtreeMultiLine) { subtreeString += newline; hasMultiLineSubtree = true; }
-				subtreeString += ")";
-				childStrings.push_back(std::move(subtreeString));
-				break;
-			}
-			case NodeType::Symbol: childStrings.emplace_back(symbolStrings[node->symbol]); break;
-			case NodeType::UnindexedSymbol: childStrings.emplace_back(node->string); break;
-			case NodeType::String: childStrings.emplace_back(std::move(std::string() + '\"' + escapeString(node->string,node->stringLength) + '\"')); break;
-			case NodeType::Error: childStrings.emplace_back(node->error); break;
-			case NodeType::Int: childStrings.emplace_back(std::move(std::to_string(node->integer))); break;
-			case NodeType::Decimal: childStrings.emplace_back(std::move(std::to_string(node->decimal))); break;
+			case NodeType::Symbol: return strlen(symbolStrings[node->symbol]);
+			case NodeType::UnindexedSymbol: return strlen(node->string);
+			case NodeType::String: return 2 + getEscapedStringLength(node->string,node->getStringLength());
+			case NodeType::Error: return strlen(node->error);
+			case NodeType::Int: case NodeType::Decimal: return formatNumber(node,numberBuffer);
 			default: throw;
 			};
-			node = node->nextSibling;
 		}
-		while(node);
-		
-		size_t totalChildLength = 0;
-		for(auto string : childStrings) { totalChildLength += string.length(); }
-		auto isMultiLine = hasMultiLineSubtree || totalChildLength > 120;
 
-		for(uintptr_t childIndex = 0;childIndex < childStrings.size();++childIndex)
+		// Measures a sibling list, returning the total single-line width of the nodes in it, not counting the separators.
+		size_t measureList(SExp::Node* firstNode)
+		{
+			std::vector<MeasureFrame> stack;
+			stack.push_back({firstNode,isMultiLineLists.size(),0,0,false});
+			isMultiLineLists.push_back(0);
+			while(true)
+			{
+				MeasureFrame& frame = stack.back();
+				if(frame.nextNode && frame.nextNode->type == NodeType::Tree)
+				{
+					// Measure the tree's children before continuing with its siblings.
+					SExp::Node* children = frame.nextNode->children;
+					stack.push_back({children,isMultiLineLists.size(),0,0,false});
+					isMultiLineLists.push_back(0);
+				}
+				else if(frame.nextNode)
+				{
+					frame.totalChildLength += measureLeaf(frame.nextNode);
+					++frame.numNodes;
+					frame.nextNode = frame.nextNode->nextSibling;
+				}
+				else
+				{
+					// The list is finished, so decide whether to split it, and add the width of the tree containing it to the parent list.
+					const bool isMultiLine = frame.hasMultiLineSubtree || frame.totalChildLength > 120;
+					const size_t listLength = frame.totalChildLength;
+					const uintptr_t numSeparators = frame.numNodes ? frame.numNodes - 1 : 0;
+					isMultiLineLists[frame.listIndex] = isMultiLine;
+					stack.pop_back();
+					if(!stack.size()) { return listLength; }
+
+					MeasureFrame& parentFrame = stack.back();
+					parentFrame.totalChildLength += 2 + listLength + numSeparators;
+					parentFrame.hasMultiLineSubtree |= isMultiLine;
+					++parentFrame.numNodes;
+					parentFrame.nextNode = parentFrame.nextNode->nextSibling;
+				}
+			}
+		}
+
+		void printNewline(uintptr_t depth,Core::OutputBuffer& outputBuffer)
+		{
+			outputBuffer.write('\n');
+			for(uintptr_t tabIndex = 0;tabIndex < depth;++tabIndex) { outputBuffer.write('\t'); }
+		}
+
+		// Prints the separator following the next node of a sibling list, and advances to the node after it.
+		void printSeparator(PrintFrame& frame,Core::OutputBuffer& outputBuffer)
+		{
+			frame.nextNode = frame.nextNode->nextSibling;
+			if(frame.nextNode)
+			{
+				if(frame.isMultiLine) { printNewline(frame.depth,outputBuffer); }
+				else { outputBuffer.write(' '); }
+			}
+		}
+
+		// Prints a sibling list measured by measureList.
+		void printList(SExp::Node* firstNode,Core::OutputBuffer& outputBuffer)
 		{
-			outString += childStrings[childIndex];
-			if(childIndex + 1 < childStrings.size()) { outString += isMultiLine ? newline : " "; }
+			std::vector<PrintFrame> stack;
+			stack.push_back({firstNode,0,isMultiLineLists[nextListIndex++] != 0});
+			while(true)
+			{
+				PrintFrame& frame = stack.back();
+				SExp::Node* node = frame.nextNode;
+				if(!node)
+				{
+					// The list is finished, so close the tree containing it in the parent list.
+					const bool isMultiLine = frame.isMultiLine;
+					stack.pop_back();
+					if(!stack.size()) { return; }
+
+					PrintFrame& parentFrame = stack.back();
+					if(isMultiLine) { printNewline(parentFrame.depth,outputBuffer); }
+					outputBuffer.write(')');
+					printSeparator(parentFrame,outputBuffer);
+					continue;
+				}
+
+				switch(node->type)
+				{
+				case NodeType::Tree:
+				{
+					// Print the tree's children before continuing with its siblings.
+					outputBuffer.write('(');
+					const uintptr_t childDepth = frame.depth + 1;
+					stack.push_back({node->children,childDepth,isMultiLineLists[nextListIndex++] != 0});
+					continue;
+				}
+				case NodeType::Symbol: outputBuffer.write(symbolStrings[node->symbol]); break;
+				case NodeType::UnindexedSymbol: outputBuffer.write(node->string); break;
+				case NodeType::String:
+					outputBuffer.write('\"');
+					printEscapedString(node->string,node->getStringLength(),outputBuffer);
+					outputBuffer.write('\"');
+					break;
+				case NodeType::Error: outputBuffer.write(node->error); break;
+				case NodeType::Int: case NodeType::Decimal: outputBuffer.write(numberBuffer,formatNumber(node,numberBuffer)); break;
+				default: throw;
+				};
+				printSeparator(frame,outputBuffer);
+			}
 		}
+	};
 
-		return isMultiLine;
+	void print(SExp::Node* rootNode,const char* symbolStrings[],Core::OutputBuffer& outputBuffer)
+	{
+		PrintContext printContext(symbolStrings);
+		printContext.measureList(rootNode);
+		printContext.printList(rootNode,outputBuffer);
 	}
 
 	std::string print(SExp::Node* rootNode,const char* symbolStrings[])
 	{
-		std::string result;
-		printRecursive(rootNode,symbolStrings,result,"\n");
-		return result;
+		Core::StringOutputBuffer outputBuffer;
+		print(rootNode,symbolStrings,outputBuffer);
+		return std::move(outputBuffer.getString());
 	}
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "Core/Core.h"
 #include "Core/MemoryArena.h"
+#include "Core/Platform.h"
+#include "Core/OutputBuffer.h"
 
 #ifdef _WIN32
 	#pragma warning (disable:4512)	// assignment operator could not be generated
@@ -21,11 +23,11 @@ namespace SExp
 		Tree
 	};
 
-	// A node in a tree of S-expressions
+	// A node in a tree of S-expressions.
+	// There is a node for every token in the source, so the node only stores what is needed to walk the tree: the end offset of a node
+	// is recomputed from the source string by SourceLocator when it's needed for an error, and the length of a string is stored with the string.
 	struct Node
 	{
-		// The type of the node. Determines how to interpret the union.
-		NodeType type;
 		union
 		{
 			const char* error;
@@ -35,41 +37,78 @@ namespace SExp
 			float64 decimal;
 			Node* children;
 		};
-		// If type==NodeType::String, contains the length of the string.
-		// string[stringLength] will be zero, but stringLength may not be the first zero in the string.
-		size_t stringLength;
 		// The next node with the same parent.
 		Node* nextSibling;
-		// The start of this node in the source file.
-		Core::TextFileLocus startLocus;
-		// The end of this node in the source file.
-		Core::TextFileLocus endLocus;
-
-		Node(const Core::TextFileLocus& inStartLocus = Core::TextFileLocus(),NodeType inType = NodeType::Tree)
-		:	type(inType)
-		,	children(nullptr)
-		,	stringLength(0)
+		// The offset of the start of this node in the source string.
+		uint32 startOffset;
+		// The type of the node. Determines how to interpret the union.
+		NodeType type;
+
+		Node(uint32 inStartOffset = 0,NodeType inType = NodeType::Tree)
+		:	children(nullptr)
 		,	nextSibling(nullptr)
-		,	startLocus(inStartLocus)
-		,	endLocus(inStartLocus)
+		,	startOffset(inStartOffset)
+		,	type(inType)
 		{}
+
+		// If type==NodeType::String or NodeType::UnindexedSymbol, returns the length of the string.
+		// string[length] will be zero, but a quoted string may contain other zeroes.
+		size_t getStringLength() const
+		{
+			assert(type == NodeType::String || type == NodeType::UnindexedSymbol);
+			return ((const uint32*)string)[-1];
+		}
+	};
+
+	// Allocates a zero terminated copy of a string for a String or UnindexedSymbol node, preceded by the length of the string.
+	inline const char* copyNodeString(Memory::Arena& arena,const char* string,size_t numChars)
+	{
+		uint32* stringLength = (uint32*)arena.allocate(sizeof(uint32) + numChars + 1);
+		*stringLength = (uint32)numChars;
+		char* result = (char*)(stringLength + 1);
+		memcpy(result,string,numChars);
+		result[numChars] = 0;
+		return result;
+	}
+
+	// Maps offsets in the source string of a S-expression tree to line and column loci.
+	// The index of line start offsets is only built the first time a locus is requested, which is usually to report an error.
+	struct SourceLocator
+	{
+		SourceLocator(const char* inString): string(inString) {}
+		SourceLocator(const SourceLocator&) = delete;
+
+		Core::TextFileLocus getLocus(uint32 offset) const;
+
+		// Returns the offset of the end of a node parsed from the source string.
+		uint32 getEndOffset(const Node* node) const;
+
+		// Returns the string that node offsets are relative to.
+		const char* getString() const { return string; }
+
+	private:
+		const char* string;
+		mutable Platform::Mutex lineIndexMutex;
+		mutable std::vector<uint32> lineStartOffsets;
 	};
 
 	// Iterates over sibling nodes in a S-expression tree.
 	struct NodeIt
 	{
 		Node* node;
-		Core::TextFileLocus previousLocus;
+		const Node* previousNode;
+		uint32 parentOffset;
+		const SourceLocator* locator;
 
-		NodeIt(): node(nullptr) {}
-		explicit NodeIt(Node* inNode,Core::TextFileLocus inPreviousLocus = Core::TextFileLocus())
-		: node(inNode), previousLocus(inPreviousLocus) {}
+		NodeIt(): node(nullptr), previousNode(nullptr), parentOffset(0), locator(nullptr) {}
+		explicit NodeIt(Node* inNode,const SourceLocator* inLocator = nullptr,uint32 inParentOffset = 0)
+		: node(inNode), previousNode(nullptr), parentOffset(inParentOffset), locator(inLocator) {}
 
 		NodeIt& operator++()
 		{
 			if(node)
 			{
-				previousLocus = node->endLocus;
+				previousNode = node;
 				node = node->nextSibling;
 			}
 			return *this;
@@ -84,7 +123,17 @@ namespace SExp
 		NodeIt getChildIt() const
 		{
 			assert(node->type == NodeType::Tree);
-			return NodeIt(node->children,node->startLocus);
+			return NodeIt(node->children,locator,node->startOffset);
+		}
+
+		// Returns the locus of the node, or of the end of the previous node if the iterator is past the last sibling.
+		// If there's no previous sibling, returns the locus of the start of the parent node.
+		Core::TextFileLocus getLocus() const
+		{
+			if(!locator) { return Core::TextFileLocus(); }
+			else if(node) { return locator->getLocus(node->startOffset); }
+			else if(previousNode) { return locator->getLocus(locator->getEndOffset(previousNode)); }
+			else { return locator->getLocus(parentOffset); }
 		}
 
 		Node* operator->() const { return node; }
@@ -129,11 +178,9 @@ namespace SExp
 		// Append an unindexed symbol.
 		NodeOutputStream& operator<<(const char* string)
 		{
-			auto stringLength = strlen(string);
 			auto symbolNode = new(arena) Node();
 			symbolNode->type = SExp::NodeType::UnindexedSymbol;
-			symbolNode->string = arena.copyToArena(string,stringLength + 1);;
-			symbolNode->stringLength = stringLength;
+			symbolNode->string = copyNodeString(arena,string,strlen(string));
 			append(symbolNode);
 			return *this;
 		}
@@ -157,8 +204,7 @@ namespace SExp
 		{
 			auto intNode = new(arena) Node();
 			intNode->type = SExp::NodeType::String;
-			intNode->string = string.string;
-			intNode->stringLength = string.length;
+			intNode->string = copyNodeString(arena,string.string,string.length);
 			append(intNode);
 			return *this;
 		}
@@ -187,11 +233,36 @@ namespace SExp
 		}
 	};
 
+	// Maps a static set of symbol strings to their indices with a perfect hash table.
+	// The table is built once when the map is constructed, so that looking up a symbol only hashes it and compares it to one string.
+	struct SymbolIndexMap
+	{
+		// The index of each symbol is its index in the symbols array. The symbol strings must outlive the map.
+		SymbolIndexMap(const char* const* symbols,size_t numSymbols);
+		SymbolIndexMap(const SymbolIndexMap&) = delete;
+
+		// Looks up a symbol that isn't necessarily null terminated. Returns false if it isn't one of the map's symbols.
+		bool find(const char* string,size_t numChars,uintptr_t& outIndex) const;
+
+	private:
+		struct Slot
+		{
+			const char* string;
+			uint32 numChars;
+			uint32 index;
+		};
+		std::vector<uint32> bucketDisplacements;
+		std::vector<Slot> slots;
+	};
+
 	// Parses a S-expression tree from a string, allocating nodes from arena, and using symbolIndexMap to map symbols to indices.
-	struct StringCompareFunctor { bool operator()(const char* left,const char* right) const { return strcmp(left,right) < 0; } };
-	typedef std::map<const char*,uintptr_t,StringCompareFunctor> SymbolIndexMap;
+	// The nodes only store offsets into the string: use a SourceLocator for the string to turn them into loci.
+	// The offsets are 32-bit, so a string of 4GB or more is rejected with an error node.
 	Node* parse(const char* string,Memory::Arena& arena,const SymbolIndexMap& symbolIndexMap);
 
 	// Prints a S-expression tree to a string.
 	std::string print(SExp::Node* rootNode,const char* symbolStrings[]);
+
+	// Prints a S-expression tree straight to an output buffer, without building the text of each subtree in memory first.
+	void print(SExp::Node* rootNode,const char* symbolStrings[],Core::OutputBuffer& outputBuffer);
 }
\ No newline at end of file
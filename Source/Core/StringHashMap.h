@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Core/Core.h"
+
+namespace Core
+{
+	// Hashes a string that isn't necessarily null terminated, a word at a time.
+	inline uint64 hashString(const char* string,size_t numChars)
+	{
+		uint64 hash = numChars * 0x9e3779b97f4a7c15ull;
+		for(;numChars >= sizeof(uint64);string += sizeof(uint64), numChars -= sizeof(uint64))
+		{
+			uint64 word;
+			memcpy(&word,string,sizeof(uint64));
+			hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+			hash ^= hash >> 32;
+		}
+		uint64 word = 0;
+		memcpy(&word,string,numChars);
+		hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ull;
+		return hash ^ (hash >> 29);
+	}
+
+	// Maps strings to values with an open addressing hash table. The map doesn't copy the key strings: they must outlive the map,
+	// which is usually done by keeping them in the same memory arena as the objects they name.
+	// Each slot stores the hash of its key, so probing only compares the strings of keys whose hashes are equal.
+	template<typename Value>
+	struct StringHashMap
+	{
+		StringHashMap(): numEntries(0) {}
+
+		// Adds a key to the map. Returns false if the key is already in the map, in which case the map isn't changed.
+		bool add(const char* key,const Value& value) { return add(key,strlen(key),value); }
+		bool add(const char* key,size_t numKeyChars,const Value& value)
+		{
+			if((numEntries + 1) * 2 > slots.size()) { grow(); }
+			const uint64 hash = hashString(key,numKeyChars);
+			uintptr_t slotIndex;
+			if(findSlot(key,numKeyChars,hash,slotIndex)) { return false; }
+			slots[slotIndex] = {key,(uint32)numKeyChars,(uint32)hash,value};
+			++numEntries;
+			return true;
+		}
+
+		// Looks up a key. Returns a pointer to its value, or nullptr if the key isn't in the map.
+		const Value* get(const char* key) const { return get(key,strlen(key)); }
+		const Value* get(const char* key,size_t numKeyChars) const
+		{
+			uintptr_t slotIndex;
+			if(!slots.size() || !findSlot(key,numKeyChars,hashString(key,numKeyChars),slotIndex)) { return nullptr; }
+			return &slots[slotIndex].value;
+		}
+		bool contains(const char* key) const { return get(key) != nullptr; }
+
+		// Removes a key from the map. Returns false if the key wasn't in the map.
+		bool remove(const char* key)
+		{
+			const size_t numKeyChars = strlen(key);
+			uintptr_t slotIndex;
+			if(!slots.size() || !findSlot(key,numKeyChars,hashString(key,numKeyChars),slotIndex)) { return false; }
+
+			// Shift the following entries in the probe sequence back to fill the hole, so lookups don't need tombstones.
+			const uintptr_t slotMask = slots.size() - 1;
+			uintptr_t holeIndex = slotIndex;
+			for(uintptr_t nextIndex = (holeIndex + 1) & slotMask;slots[nextIndex].key;nextIndex = (nextIndex + 1) & slotMask)
+			{
+				const uintptr_t idealIndex = slots[nextIndex].hash & slotMask;
+				if(((nextIndex - idealIndex) & slotMask) >= ((nextIndex - holeIndex) & slotMask))
+				{
+					slots[holeIndex] = slots[nextIndex];
+					holeIndex = nextIndex;
+				}
+			}
+			slots[holeIndex] = Slot();
+			--numEntries;
+			return true;
+		}
+
+		size_t size() const { return numEntries; }
+
+	private:
+		struct Slot
+		{
+			const char* key;
+			uint32 numKeyChars;
+			uint32 hash;
+			Value value;
+
+			Slot(): key(nullptr), numKeyChars(0), hash(0), value() {}
+			Slot(const char* inKey,uint32 inNumKeyChars,uint32 inHash,const Value& inValue)
+			: key(inKey), numKeyChars(inNumKeyChars), hash(inHash), value(inValue) {}
+		};
+		std::vector<Slot> slots;
+		size_t numEntries;
+
+		// Finds the slot containing a key, or the empty slot the key would be added to. Returns whether the key was found.
+		bool findSlot(const char* key,size_t numKeyChars,uint64 hash,uintptr_t& outSlotIndex) const
+		{
+			const uintptr_t slotMask = slots.size() - 1;
+			for(uintptr_t slotIndex = (uint32)hash & slotMask;;slotIndex = (slotIndex + 1) & slotMask)
+			{
+				const Slot& slot = slots[slotIndex];
+				if(!slot.key) { outSlotIndex = slotIndex; return false; }
+				else if(slot.hash == (uint32)hash && slot.numKeyChars == numKeyChars && !memcmp(slot.key,key,numKeyChars))
+				{
+					outSlotIndex = slotIndex;
+					return true;
+				}
+			}
+		}
+
+		// Doubles the number of slots, and reinserts the entries.
+		void grow()
+		{
+			std::vector<Slot> oldSlots(slots.size() ? slots.size() * 2 : 16);
+			oldSlots.swap(slots);
+			for(const Slot& oldSlot : oldSlots)
+			{
+				if(oldSlot.key)
+				{
+					uintptr_t slotIndex;
+					findSlot(oldSlot.key,oldSlot.numKeyChars,oldSlot.hash,slotIndex);
+					slots[slotIndex] = oldSlot;
+				}
+			}
+		}
+	};
+}
@@ -4,6 +4,11 @@
 #include "Platform.h"
 #include <Windows.h>
 #include <intrin.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <locale.h>
+#include <stdlib.h>
 
 namespace Platform
 {
@@ -75,6 +80,68 @@ namespace Platform
 		auto result = VirtualFree(baseVirtualAddress,0/*numPages << getPreferredVirtualPageSizeLog2()*/,MEM_RELEASE);
 		if(!result) { throw; }
 	}
+
+	uint8* mapFile(const char* filename,size_t& outNumBytes)
+	{
+		HANDLE file = CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+		if(file == INVALID_HANDLE_VALUE) { return nullptr; }
+
+		LARGE_INTEGER fileSize;
+		if(!GetFileSizeEx(file,&fileSize) || !fileSize.QuadPart)
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file,nullptr,PAGE_WRITECOPY,0,0,nullptr);
+		CloseHandle(file);
+		if(!mapping) { return nullptr; }
+
+		auto result = MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0);
+		CloseHandle(mapping);
+		if(!result) { return nullptr; }
+
+		outNumBytes = (size_t)fileSize.QuadPart;
+		return (uint8*)result;
+	}
+
+	void unmapFile(uint8* baseAddress,size_t numBytes)
+	{
+		if(!UnmapViewOfFile(baseAddress)) { throw; }
+	}
+
+	int createFile(const char* filename)
+	{
+		return _open(filename,_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,_S_IREAD | _S_IWRITE);
+	}
+
+	bool writeFileBuffers(int fileDescriptor,const WriteBuffer* buffers,size_t numBuffers)
+	{
+		// Windows doesn't have writev for CRT file descriptors, so write each buffer separately.
+		for(uintptr_t bufferIndex = 0;bufferIndex < numBuffers;++bufferIndex)
+		{
+			auto data = buffers[bufferIndex].data;
+			auto numBytes = buffers[bufferIndex].numBytes;
+			while(numBytes)
+			{
+				auto numBytesWritten = _write(fileDescriptor,data,numBytes > INT_MAX ? INT_MAX : (unsigned int)numBytes);
+				if(numBytesWritten < 0) { return false; }
+				data += numBytesWritten;
+				numBytes -= numBytesWritten;
+			}
+		}
+		return true;
+	}
+
+	static _locale_t getCLocale()
+	{
+		static _locale_t cLocale = _create_locale(LC_ALL,"C");
+		if(!cLocale) { throw; }
+		return cLocale;
+	}
+
+	float64 parseFloat64InCLocale(const char* string) { return _strtod_l(string,nullptr,getCLocale()); }
+	float32 parseFloat32InCLocale(const char* string) { return _strtof_l(string,nullptr,getCLocale()); }
 }
 
 #endif
\ No newline at end of file
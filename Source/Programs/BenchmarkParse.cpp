@@ -0,0 +1,181 @@
+#include "Core/Core.h"
+#include "Core/MemoryArena.h"
+#include "Core/SExpressions.h"
+#include "Core/FloatParsing.h"
+#include "Core/Parallel.h"
+#include "CLI.h"
+#include "WebAssembly/WebAssembly.h"
+#include "WebAssembly/WebAssemblyTextSymbols.h"
+
+#include <cstdio>
+#include <random>
+
+// Counts the nodes in a S-expression tree. Uses an explicit stack instead of recursion, since the tree may be arbitrarily deep.
+uintptr_t countNodes(SExp::Node* rootNode)
+{
+	uintptr_t numNodes = 0;
+	std::vector<SExp::Node*> pendingNodes;
+	if(rootNode) { pendingNodes.push_back(rootNode); }
+	while(pendingNodes.size())
+	{
+		SExp::Node* node = pendingNodes.back();
+		pendingNodes.pop_back();
+		++numNodes;
+		if(node->nextSibling) { pendingNodes.push_back(node->nextSibling); }
+		if(node->type == SExp::NodeType::Tree && node->children) { pendingNodes.push_back(node->children); }
+	}
+	return numNodes;
+}
+
+// Measures the throughput of parsing a WebAssembly text file: first just the S-expressions, then the full WAST parse on one and on all hardware threads.
+// Each phase is run several times, and the fastest run is reported to reduce the noise from other processes.
+int benchmarkWASTParse(const char* filename,uintptr_t numIterations)
+{
+	auto wastBytes = loadFile(filename);
+	if(!wastBytes.size()) { return -1; }
+	auto wastString = std::string((const char*)wastBytes.data(),wastBytes.size());
+	const float64 numMegabytes = wastString.size() / 1024.0 / 1024.0;
+
+	float64 minSExpSeconds = std::numeric_limits<float64>::max();
+	for(uintptr_t iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+	{
+		Memory::Arena arena;
+		Core::Timer timer;
+		SExp::parse(wastString.c_str(),arena,WebAssemblyText::getWASTSymbolIndexMap());
+		minSExpSeconds = std::min(minSExpSeconds,timer.getSeconds());
+	}
+	std::cout << "S-expressions: " << (minSExpSeconds * 1000.0) << "ms (" << (numMegabytes / minSExpSeconds) << " MB/s)" << std::endl;
+
+	// Report the memory used by the S-expression tree: the size of a node, and the arena bytes per token including the strings.
+	{
+		Memory::Arena arena;
+		const uintptr_t numNodes = countNodes(SExp::parse(wastString.c_str(),arena,WebAssemblyText::getWASTSymbolIndexMap()));
+		std::cout << "S-expression nodes: " << numNodes << " (" << sizeof(SExp::Node) << " bytes/node, "
+			<< ((float64)arena.getTotalAllocatedBytes() / std::max(numNodes,(uintptr_t)1)) << " bytes/token including strings)" << std::endl;
+	}
+
+	// Parse the WAST with a single thread, and then with a thread for each hardware thread.
+	std::vector<uintptr_t> threadCounts = {1};
+	if(Parallel::getNumHardwareThreads() > 1) { threadCounts.push_back(Parallel::getNumHardwareThreads()); }
+	for(auto numThreads : threadCounts)
+	{
+		float64 minWASTSeconds = std::numeric_limits<float64>::max();
+		for(uintptr_t iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+		{
+			WebAssemblyText::File file;
+			Core::Timer timer;
+			if(!WebAssemblyText::parse(wastString.c_str(),file,numThreads))
+			{
+				std::cerr << "Error parsing WebAssembly text file:" << std::endl;
+				for(auto error : file.errors) { std::cerr << error->message.c_str() << std::endl; }
+				return -1;
+			}
+			minWASTSeconds = std::min(minWASTSeconds,timer.getSeconds());
+		}
+		std::cout << "WAST (" << numThreads << " threads): " << (minWASTSeconds * 1000.0) << "ms (" << (numMegabytes / minWASTSeconds) << " MB/s)" << std::endl;
+	}
+
+	return 0;
+}
+
+// Compares FloatParsing::parseFloat64 to strtod on a set of random numbers written in the forms that occur in WAST files:
+// short decimals, round-trippable 17 digit decimals, exponents, and hexadecimal floats.
+// Also checks that both produce the same float64 for every number.
+int benchmarkFloatParse(uintptr_t numIterations)
+{
+	std::mt19937_64 random(0);
+	std::string numbers;
+	uintptr_t numNumbers = 0;
+	char buffer[64];
+	for(uintptr_t index = 0;index < 1000000;++index)
+	{
+		uint64 bits = random();
+		float64 value;
+		memcpy(&value,&bits,sizeof(value));
+		if(std::isnan(value) || std::isinf(value)) { continue; }
+		switch(index % 4)
+		{
+		case 0: snprintf(buffer,sizeof(buffer),"%.6f",std::fmod(value,1000000.0)); break;
+		case 1: snprintf(buffer,sizeof(buffer),"%.17g",value); break;
+		case 2:
+		{
+			int exponent;
+			snprintf(buffer,sizeof(buffer),"%.9e",std::ldexp(std::frexp(value,&exponent),(int)(random() % 200) - 100));
+			break;
+		}
+		case 3: snprintf(buffer,sizeof(buffer),"%a",value); break;
+		}
+		numbers += buffer;
+		numbers += ' ';
+		++numNumbers;
+	}
+	const float64 numMegabytes = numbers.size() / 1024.0 / 1024.0;
+
+	float64 minStrtodSeconds = std::numeric_limits<float64>::max();
+	float64 strtodSum = 0.0;
+	for(uintptr_t iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+	{
+		Core::Timer timer;
+		strtodSum = 0.0;
+		for(const char* next = numbers.c_str();*next;++next)
+		{
+			char* numberEnd;
+			strtodSum += strtod(next,&numberEnd);
+			next = numberEnd;
+		}
+		minStrtodSeconds = std::min(minStrtodSeconds,timer.getSeconds());
+	}
+	std::cout << "strtod: " << (minStrtodSeconds * 1000000000.0 / numNumbers) << "ns/number (" << (numMegabytes / minStrtodSeconds) << " MB/s)" << std::endl;
+
+	float64 minParseSeconds = std::numeric_limits<float64>::max();
+	float64 parseSum = 0.0;
+	for(uintptr_t iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+	{
+		Core::Timer timer;
+		parseSum = 0.0;
+		for(const char* next = numbers.c_str();*next;++next)
+		{
+			float64 value;
+			next = FloatParsing::parseFloat64(next,value);
+			parseSum += value;
+		}
+		minParseSeconds = std::min(minParseSeconds,timer.getSeconds());
+	}
+	std::cout << "FloatParsing::parseFloat64: " << (minParseSeconds * 1000000000.0 / numNumbers) << "ns/number (" << (numMegabytes / minParseSeconds) << " MB/s)" << std::endl;
+
+	// Check that every number was parsed to the same float64 as strtod.
+	uintptr_t numMismatches = 0;
+	for(const char* next = numbers.c_str();*next;++next)
+	{
+		const char* numberStart = next;
+		char* strtodEnd;
+		const float64 strtodValue = strtod(numberStart,&strtodEnd);
+		float64 value;
+		next = FloatParsing::parseFloat64(numberStart,value);
+		if(next != strtodEnd || memcmp(&value,&strtodValue,sizeof(value)))
+		{
+			if(!numMismatches) { std::cerr << "first mismatch: " << std::string(numberStart,strtodEnd - numberStart) << std::endl; }
+			++numMismatches;
+		}
+	}
+	if(numMismatches)
+	{
+		std::cerr << numMismatches << " numbers weren't parsed to the same value as strtod" << std::endl;
+		return -1;
+	}
+	return strtodSum == parseSum ? 0 : -1;
+}
+
+int main(int argc,char** argv)
+{
+	if(argc != 2 && argc != 3)
+	{
+		std::cerr << "Usage: BenchmarkParse in.wast [iterations]" << std::endl;
+		std::cerr << "       BenchmarkParse -floats [iterations]" << std::endl;
+		return -1;
+	}
+	const uintptr_t numIterations = argc == 3 ? atoi(argv[2]) : 10;
+	
+	if(!strcmp(argv[1],"-floats")) { return benchmarkFloatParse(numIterations); }
+	else { return benchmarkWASTParse(argv[1],numIterations); }
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Core/Core.h"
+#include "Core/Parallel.h"
 #include "AST/AST.h"
+#include "AST/ASTCache.h"
 #include "WebAssembly/WebAssembly.h"
 
 #include <iostream>
@@ -23,16 +25,17 @@ inline std::vector<uint8> loadFile(const char* filename)
 	return data;
 }
 
-inline bool loadTextModule(const char* filename,WebAssemblyText::File& outFile)
+// Parses a WebAssembly text file. The text is returned in outWASTString, which outFile.sourceLocator references.
+inline bool loadTextModule(const char* filename,WebAssemblyText::File& outFile,std::string& outWASTString)
 {
 	// Read the file into a string.
 	auto wastBytes = loadFile(filename);
-	if(!wastBytes.size()) { return nullptr; }
-	auto wastString = std::string((const char*)wastBytes.data(),wastBytes.size());
+	if(!wastBytes.size()) { return false; }
+	outWASTString = std::string((const char*)wastBytes.data(),wastBytes.size());
 	wastBytes.clear();
 
 	Core::Timer loadTimer;
-	if(!WebAssemblyText::parse(wastString.c_str(),outFile))
+	if(!WebAssemblyText::parse(outWASTString.c_str(),outFile,Parallel::getNumHardwareThreads()))
 	{
 		// Print any parse errors;
 		std::cerr << "Error parsing WebAssembly text file:" << std::endl;
@@ -44,10 +47,38 @@ inline bool loadTextModule(const char* filename,WebAssemblyText::File& outFile)
 		std::cerr << "WebAssembly text file didn't contain any modules!" << std::endl;
 		return false;
 	}
-	//std::cout << "Loaded in " << loadTimer.getMilliseconds() << "ms" << " (" << (wastString.size()/1024.0/1024.0 / loadTimer.getSeconds()) << " MB/s)" << std::endl;
+	//std::cout << "Loaded in " << loadTimer.getMilliseconds() << "ms" << " (" << (outWASTString.size()/1024.0/1024.0 / loadTimer.getSeconds()) << " MB/s)" << std::endl;
 	return true;
 }
 
+inline bool loadTextModule(const char* filename,WebAssemblyText::File& outFile)
+{
+	// The text is freed on return, so drop the source locator that references it.
+	std::string wastString;
+	bool result = loadTextModule(filename,outFile,wastString);
+	outFile.sourceLocator = nullptr;
+	return result;
+}
+
+// Loads the first module in a WebAssembly text file, using a module cache file if one was written for the same text.
+// If there isn't a valid cache file, the text is parsed and the cache file is written for the next load.
+inline AST::Module* loadCachedTextModule(const char* filename,const char* cacheFilename)
+{
+	auto wastBytes = loadFile(filename);
+	if(!wastBytes.size()) { return nullptr; }
+	auto sourceChecksum = AST::computeCacheChecksum(wastBytes.data(),wastBytes.size());
+	wastBytes.clear();
+
+	auto module = AST::loadModuleCache(cacheFilename,sourceChecksum);
+	if(module) { return module; }
+
+	WebAssemblyText::File file;
+	if(!loadTextModule(filename,file) || !file.modules.size()) { return nullptr; }
+	module = file.modules[0];
+	if(!AST::saveModuleCache(module,sourceChecksum,cacheFilename)) { std::cerr << "Failed to write module cache " << cacheFilename << std::endl; }
+	return module;
+}
+
 inline AST::Module* loadBinaryModule(const char* wasmFilename,const char* memFilename)
 {
 	// Read in packed .wasm file bytes.
@@ -5,6 +5,15 @@
 
 int main(int argc,char** argv)
 {
+	// Parse the optional thread count for printing the module's functions.
+	uintptr_t numThreads = Parallel::getNumHardwareThreads();
+	if(argc >= 3 && !strcmp(argv[1],"-threads"))
+	{
+		numThreads = std::max(1,atoi(argv[2]));
+		argc -= 2;
+		argv += 2;
+	}
+
 	AST::Module* module;
 	const char* outputFilename;
 	if(argc == 4 && !strcmp(argv[1],"-text"))
@@ -21,8 +30,8 @@ int main(int argc,char** argv)
 	}
 	else
 	{
-		std::cerr <<  "Usage: Print -binary in.wasm in.js.mem out.js" << std::endl;
-		std::cerr <<  "       Print -text in.wast out.js" << std::endl;
+		std::cerr <<  "Usage: Print [-threads n] -binary in.wasm in.js.mem out.js" << std::endl;
+		std::cerr <<  "       Print [-threads n] -text in.wast out.js" << std::endl;
 		return -1;
 	}
 	
@@ -35,7 +44,7 @@ int main(int argc,char** argv)
 		std::cerr << "Failed to open " << outputFilename << std::endl;
 		return -1;
 	}
-	ASMJS::print(outputStream,module);
+	ASMJS::print(outputStream,module,numThreads);
 	outputStream.close();
 	std::cout << "Printed ASM.JS code in " << printTimer.getMilliseconds() << "ms" << std::endl;
 
@@ -29,14 +29,23 @@ int main(int argc,char** argv)
 	if(!module) { return -1; }
 	
 	Core::Timer printTimer;
-	std::ofstream outputStream(outputFilename);
-	if(!outputStream.is_open())
+	FILE* outputFile = fopen(outputFilename,"wb");
+	if(!outputFile)
 	{
 		std::cerr << "Failed to open " << outputFilename << std::endl;
 		return -1;
 	}
-	outputStream << WebAssemblyText::print(module);
-	outputStream.close();
+	bool hasWriteError;
+	{
+		Core::FileOutputBuffer outputBuffer(outputFile);
+		WebAssemblyText::print(module,outputBuffer);
+		hasWriteError = outputBuffer.hasError();
+	}
+	if(fclose(outputFile) || hasWriteError)
+	{
+		std::cerr << "Failed to write " << outputFilename << std::endl;
+		return -1;
+	}
 	std::cout << "Printed WAST code in " << printTimer.getMilliseconds() << "ms" << std::endl;
 
 	return 0;
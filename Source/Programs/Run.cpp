@@ -22,37 +22,37 @@ template<> struct NativeToASTType<bool> { typedef AST::BoolType ASTType; };
 template<> struct NativeToASTType<Void> { typedef AST::VoidType ASTType; };
 
 template<typename... Args>
-bool validateArgTypes(const AST::FunctionType& functionType,uintptr_t argIndex,Args...)
+bool validateArgTypes(const AST::FunctionType* functionType,uintptr_t argIndex,Args...)
 {
-	return argIndex == functionType.parameters.size();
+	return argIndex == functionType->parameters.size();
 }
 
 template<typename Arg0,typename... Args>
-bool validateArgTypes(const AST::FunctionType& functionType,uintptr_t argIndex,Arg0,Args...)
+bool validateArgTypes(const AST::FunctionType* functionType,uintptr_t argIndex,Arg0,Args...)
 {
 	return validateArgTypes<Args...>(functionType,argIndex + 1)
-		&& functionType.parameters[argIndex] == NativeToASTType<Arg0>::ASTType::id;
+		&& functionType->parameters[argIndex] == NativeToASTType<Arg0>::ASTType::id;
 }
 
 template<typename Return,typename... Args>
 bool callModuleFunction(const AST::Module* module,const char* functionName,Return& outReturn,Args... args)
 {
 	// Look up the function specified on the command line in the module.
-	auto exportIt = module->exportNameToFunctionIndexMap.find(functionName);
-	if(exportIt == module->exportNameToFunctionIndexMap.end())
+	auto export_ = module->exports.get(functionName);
+	if(!export_)
 	{
 		std::cerr << "module doesn't contain named export " << functionName << std::endl;
 		return false;
 	}
 	
-	auto function = module->functions[exportIt->second];
-	if(!validateArgTypes(function->type,0,args...) || function->type.returnType != NativeToASTType<Return>::ASTType::id)
+	auto function = module->functions[export_->functionIndex];
+	if(!validateArgTypes(function->type,0,args...) || function->type->returnType != NativeToASTType<Return>::ASTType::id)
 	{
 		std::cerr << "exported function " << functionName << " isn't expected type" << std::endl;
 		return false;
 	}
 
-	void* functionPtr = Runtime::getFunctionPointer(module,exportIt->second);
+	void* functionPtr = Runtime::getFunctionPointer(module,export_->functionIndex);
 	assert(functionPtr);
 
 	// Call the generated machine code for the function.
@@ -64,6 +64,8 @@ bool callModuleFunction(const AST::Module* module,const char* functionName,Retur
 	}
 	catch(...)
 	{
+		// Write any output the module buffered before the trap.
+		Runtime::flushEmscriptenOutput();
 		std::cout << functionName << " threw exception." << std::endl;
 		return false;
 	}
@@ -107,7 +109,11 @@ bool initModuleRuntime(const AST::Module* module)
 	}
 
 	// Initialize the Emscripten intrinsics.
-	Runtime::initEmscriptenIntrinsics();
+	if(!Runtime::initEmscriptenIntrinsics(module))
+	{
+		std::cerr << "Module's maximum memory size is too small for the Emscripten stack (" << module->maxNumBytesMemory/1024 << "KB)" << std::endl;
+		return false;
+	}
 	
 	Void result;
 	callModuleFunction(module,"__GLOBAL__sub_I_iostream_cpp",result);
@@ -116,6 +122,33 @@ bool initModuleRuntime(const AST::Module* module)
 
 int main(int argc,char** argv)
 {
+	// Parse the options for the instance's output, which precede the module arguments.
+	int stdoutFileDescriptor = 1;
+	int stderrFileDescriptor = 2;
+	int argIndex = 1;
+	for(;argIndex + 1 < argc;argIndex += 2)
+	{
+		int* fileDescriptor;
+		if(!strcmp(argv[argIndex],"-stdout")) { fileDescriptor = &stdoutFileDescriptor; }
+		else if(!strcmp(argv[argIndex],"-stderr")) { fileDescriptor = &stderrFileDescriptor; }
+		else if(!strcmp(argv[argIndex],"-outputbuffer"))
+		{
+			Runtime::setEmscriptenOutputBufferSize((uint32)strtoul(argv[argIndex + 1],nullptr,10));
+			continue;
+		}
+		else { break; }
+
+		*fileDescriptor = Platform::createFile(argv[argIndex + 1]);
+		if(*fileDescriptor < 0)
+		{
+			std::cerr << "Failed to create " << argv[argIndex + 1] << std::endl;
+			return -1;
+		}
+	}
+	Runtime::setEmscriptenOutputFiles(stdoutFileDescriptor,stderrFileDescriptor);
+	argc -= argIndex - 1;
+	argv += argIndex - 1;
+
 	AST::Module* module = nullptr;
 	const char* functionName;
 	if(argc == 4 && !strcmp(argv[1],"-text"))
@@ -125,6 +158,12 @@ int main(int argc,char** argv)
 		else { return -1; }
 		functionName = argv[3];
 	}
+	else if(argc == 4 && !strcmp(argv[1],"-cachedtext"))
+	{
+		auto cacheFilename = std::string(argv[2]) + ".cache";
+		module = loadCachedTextModule(argv[2],cacheFilename.c_str());
+		functionName = argv[3];
+	}
 	else if(argc == 5 && !strcmp(argv[1],"-binary"))
 	{
 		module = loadBinaryModule(argv[2],argv[3]);
@@ -132,8 +171,13 @@ int main(int argc,char** argv)
 	}
 	else
 	{
-		std::cerr <<  "Usage: Run -binary in.wasm in.js.mem functionname" << std::endl;
-		std::cerr <<  "       Run -text in.wast functionname" << std::endl;
+		std::cerr <<  "Usage: Run [options] -binary in.wasm in.js.mem functionname" << std::endl;
+		std::cerr <<  "       Run [options] -text in.wast functionname" << std::endl;
+		std::cerr <<  "       Run [options] -cachedtext in.wast functionname" << std::endl;
+		std::cerr <<  "Options:" << std::endl;
+		std::cerr <<  "  -stdout out.txt     Writes the program's stdout to a file" << std::endl;
+		std::cerr <<  "  -stderr out.txt     Writes the program's stderr to a file" << std::endl;
+		std::cerr <<  "  -outputbuffer n     Buffers n bytes of the program's stdout (64KB by default, 0 disables buffering)" << std::endl;
 		return -1;
 	}
 	
@@ -143,9 +187,13 @@ int main(int argc,char** argv)
 
 	uint32 returnCode;
 	Core::Timer executionTime;
-	if(!callModuleFunction(module,functionName,returnCode)) { return -1; }
+	bool succeeded = callModuleFunction(module,functionName,returnCode);
 	executionTime.stop();
 
+	// Write any output the module buffered before printing anything else.
+	Runtime::flushEmscriptenOutput();
+	if(!succeeded) { return -1; }
+
 	std::cout << "Program returned: " << returnCode << std::endl;
 	std::cout << "Execution time: " << executionTime.getMilliseconds() << "ms" << std::endl;
 
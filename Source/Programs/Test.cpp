@@ -23,37 +23,37 @@ template<> struct NativeToASTType<bool> { typedef AST::BoolType ASTType; };
 template<> struct NativeToASTType<Void> { typedef AST::VoidType ASTType; };
 
 template<typename... Args>
-bool validateArgTypes(const AST::FunctionType& functionType,uintptr_t argIndex,Args...)
+bool validateArgTypes(const AST::FunctionType* functionType,uintptr_t argIndex,Args...)
 {
-	return argIndex == functionType.parameters.size();
+	return argIndex == functionType->parameters.size();
 }
 
 template<typename Arg0,typename... Args>
-bool validateArgTypes(const AST::FunctionType& functionType,uintptr_t argIndex,Arg0,Args...)
+bool validateArgTypes(const AST::FunctionType* functionType,uintptr_t argIndex,Arg0,Args...)
 {
 	return validateArgTypes<Args...>(functionType,argIndex + 1)
-		&& functionType.parameters[argIndex] == NativeToASTType<Arg0>::ASTType::id;
+		&& functionType->parameters[argIndex] == NativeToASTType<Arg0>::ASTType::id;
 }
 
 template<typename Return,typename... Args>
 bool callModuleFunction(const AST::Module* module,const char* functionName,Return& outReturn,Args... args)
 {
 	// Look up the function specified on the command line in the module.
-	auto exportIt = module->exportNameToFunctionIndexMap.find(functionName);
-	if(exportIt == module->exportNameToFunctionIndexMap.end())
+	auto export_ = module->exports.get(functionName);
+	if(!export_)
 	{
 		std::cerr << "module doesn't contain named export " << functionName << std::endl;
 		return false;
 	}
 
-	auto function = module->functions[exportIt->second];
-	if(!validateArgTypes(function->type,0,args...) || function->type.returnType != NativeToASTType<Return>::ASTType::id)
+	auto function = module->functions[export_->functionIndex];
+	if(!validateArgTypes(function->type,0,args...) || function->type->returnType != NativeToASTType<Return>::ASTType::id)
 	{
 		std::cerr << "exported function " << functionName << " isn't expected type" << std::endl;
 		return false;
 	}
 
-	void* functionPtr = Runtime::getFunctionPointer(module,exportIt->second);
+	void* functionPtr = Runtime::getFunctionPointer(module,export_->functionIndex);
 	assert(functionPtr);
 
 	// Call the generated machine code for the function.
@@ -105,24 +105,44 @@ bool initModuleRuntime(const AST::Module* module)
 		return false;
 	}
 
+	// Initialize the Emscripten intrinsics for modules that import them, e.g. to create threads.
+	if(module->functionImports.size() && !Runtime::initEmscriptenIntrinsics(module))
+	{
+		std::cerr << "Module's maximum memory size is too small for the Emscripten stack (" << module->maxNumBytesMemory/1024 << "KB)" << std::endl;
+		return false;
+	}
+
 	return true;
 }
 
-uintptr_t createTestFunction(AST::Module* module,const char* name,AST::TypedExpression expression)
+// Adds an exported function to a module that evaluates an expression. Returns false if the module already exports a function with the name.
+bool createTestFunction(AST::Module* module,const char* name,AST::TypedExpression expression)
 {
 	auto function = new AST::Function();
 	function->name = name;
-	function->type.returnType = expression.type;
+	function->type = AST::FunctionType::get(expression.type);
 	function->expression = expression.expression;
 
 	auto functionIndex = module->functions.size();
 	module->functions.push_back(function);
-	module->exportNameToFunctionIndexMap[name] = functionIndex;
-	return functionIndex;
+	return module->exports.add(name,functionIndex);
+}
+
+// Identifies an assertion in failure messages. The line and column are only computed when a message is printed.
+struct AssertLocus
+{
+	const char* filename;
+	const SExp::SourceLocator* sourceLocator;
+	uint32 sourceOffset;
+};
+
+std::ostream& operator<<(std::ostream& stream,const AssertLocus& locus)
+{
+	return stream << locus.filename << locus.sourceLocator->getLocus(locus.sourceOffset).describe();
 }
 
 template<typename Type>
-bool callTestFunction(AST::Module* module,const char* name,const char* locus,AST::TypedExpression typedExpectedValue)
+bool callTestFunction(AST::Module* module,const char* name,const AssertLocus& locus,AST::TypedExpression typedExpectedValue)
 {
 	typename Type::NativeType returnValue;
 	if(!callModuleFunction(module,name,returnValue)) { return false; }
@@ -144,7 +164,7 @@ bool callTestFunction(AST::Module* module,const char* name,const char* locus,AST
 	return true;
 }
 
-bool callTestFunction(AST::Module* module,const char* name,const char* locus,AST::TypedExpression expectedValue)
+bool callTestFunction(AST::Module* module,const char* name,const AssertLocus& locus,AST::TypedExpression expectedValue)
 {
 	switch(expectedValue.type)
 	{
@@ -155,45 +175,122 @@ bool callTestFunction(AST::Module* module,const char* name,const char* locus,AST
 	case AST::TypeId::F32: return callTestFunction<AST::F32Type>(module,name,locus,expectedValue);
 	case AST::TypeId::F64: return callTestFunction<AST::F64Type>(module,name,locus,expectedValue);
 	case AST::TypeId::Bool: return callTestFunction<AST::BoolType>(module,name,locus,expectedValue);
+	case AST::TypeId::V128: std::cerr << locus << ": assert_eq can't compare v128 values; compare their lanes with extract_lane instead" << std::endl; return false;
 	case AST::TypeId::Void: std::cerr << locus << ": Why are you trying to assert the equality of two void values?" << std::endl; return true;
 	default: throw;
 	}
 }
 
+// Writes a copy of a module cache file with one byte changed, and checks that loading it rejects the cache, reparses the text, and
+// replaces the corrupt file with a valid cache.
+bool testCorruptModuleCache(const char* filename,uint64 sourceChecksum,const char* corruptCacheFilename,std::vector<uint8> cacheBytes,uintptr_t corruptByteOffset)
+{
+	cacheBytes[corruptByteOffset] ^= 0xff;
+	{
+		std::ofstream stream(corruptCacheFilename,std::ios::binary | std::ios::trunc);
+		stream.write((const char*)cacheBytes.data(),cacheBytes.size());
+		if(stream.fail()) { std::cerr << "Failed to write " << corruptCacheFilename << std::endl; return false; }
+	}
+
+	if(AST::loadModuleCache(corruptCacheFilename,sourceChecksum))
+	{
+		std::cerr << corruptCacheFilename << ": module cache with byte " << corruptByteOffset << " corrupted wasn't rejected" << std::endl;
+		return false;
+	}
+	if(!loadCachedTextModule(filename,corruptCacheFilename)) { return false; }
+	if(!AST::loadModuleCache(corruptCacheFilename,sourceChecksum))
+	{
+		std::cerr << corruptCacheFilename << ": corrupt module cache wasn't replaced with a valid cache" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Writes a module cache for the first module in a text file with the same loader as Run -cachedtext, and reloads it.
+// Returns the reloaded module, or nullptr if the cache couldn't be written or reloaded, or if a corrupt cache isn't rejected.
+AST::Module* loadTestModuleCache(const char* filename,const char* cacheFilename)
+{
+	// Write the cache.
+	remove(cacheFilename);
+	if(!loadCachedTextModule(filename,cacheFilename)) { return nullptr; }
+	auto cacheBytes = loadFile(cacheFilename);
+	if(!cacheBytes.size()) { return nullptr; }
+	auto wastBytes = loadFile(filename);
+	auto sourceChecksum = AST::computeCacheChecksum(wastBytes.data(),wastBytes.size());
+
+	// Check that caches with a corrupted version header, or a corrupted byte that only the image checksum covers, are rejected.
+	// The version follows the 8 byte magic, and the image follows the 80 byte header.
+	auto corruptCacheFilename = std::string(cacheFilename) + ".corrupt";
+	const uintptr_t versionOffset = 8;
+	const uintptr_t firstImageByteOffset = 80;
+	if(!testCorruptModuleCache(filename,sourceChecksum,corruptCacheFilename.c_str(),cacheBytes,versionOffset)
+	|| !testCorruptModuleCache(filename,sourceChecksum,corruptCacheFilename.c_str(),cacheBytes,firstImageByteOffset))
+	{
+		return nullptr;
+	}
+
+	// Reload the cache written by the first load.
+	auto module = AST::loadModuleCache(cacheFilename,sourceChecksum);
+	if(!module) { std::cerr << cacheFilename << ": valid module cache was rejected" << std::endl; }
+	return module;
+}
+
 int main(int argc,char** argv)
 {
-	if(argc != 2)
+	const char* filename;
+	const char* cacheFilename = nullptr;
+	if(argc == 2) { filename = argv[1]; }
+	else if(argc == 4 && !strcmp(argv[1],"-cachedtext"))
+	{
+		filename = argv[2];
+		cacheFilename = argv[3];
+	}
+	else
 	{
 		std::cerr <<  "Usage: Test in.wast" << std::endl;
+		std::cerr <<  "       Test -cachedtext in.wast in.wast.cache" << std::endl;
 		return -1;
 	}
 	
-	const char* filename = argv[1];
 	WebAssemblyText::File wastFile;
-	if(!loadTextModule(filename,wastFile)) { return -1; }
+	std::string wastString;
+	if(!loadTextModule(filename,wastFile,wastString)) { return -1; }
+
+	// If testing the module cache, run the first module's assertions against the module loaded from its cache.
+	AST::Module* cachedModule = nullptr;
+	if(cacheFilename)
+	{
+		cachedModule = loadTestModuleCache(filename,cacheFilename);
+		if(!cachedModule) { return -1; }
+	}
 	
 	uintptr_t numTestsFailed = 0;
 	for(auto assertEq : wastFile.assertEqs)
 	{
 		// Make a copy of the module that the assertion invokes from.
-		auto testModule = new AST::Module(*assertEq.invokeFunctionModule);
+		auto invokeFunctionModule = cachedModule && assertEq.invokeFunctionModule == wastFile.modules[0] ? cachedModule : assertEq.invokeFunctionModule;
+		auto testModule = new AST::Module(*invokeFunctionModule);
 
 		// Add an exported function to that module that just calls the invoke function with the provided parameters and returns the result.
 		auto invokedFunction = testModule->functions[assertEq.invokeFunctionIndex];
-		auto invokeType = invokedFunction->type.returnType;
-		auto invokeParameters = new(testModule->arena) AST::UntypedExpression*[invokedFunction->type.parameters.size()];
-		for(uintptr_t parameterIndex = 0;parameterIndex < invokedFunction->type.parameters.size();++parameterIndex)
+		auto invokeType = invokedFunction->type->returnType;
+		auto invokeParameters = new(testModule->arena) AST::UntypedExpression*[invokedFunction->type->parameters.size()];
+		for(uintptr_t parameterIndex = 0;parameterIndex < invokedFunction->type->parameters.size();++parameterIndex)
 		{
-			assert(assertEq.parameters[parameterIndex].type == invokedFunction->type.parameters[parameterIndex]);
+			assert(assertEq.parameters[parameterIndex].type == invokedFunction->type->parameters[parameterIndex]);
 			invokeParameters[parameterIndex] = assertEq.parameters[parameterIndex].expression;
 		}
 		auto invokeExpression = new(testModule->arena) AST::Call(AST::AnyOp::callDirect,getPrimaryTypeClass(invokeType),assertEq.invokeFunctionIndex,invokeParameters);
-		createTestFunction(testModule,"test",AST::TypedExpression(invokeExpression,invokeType));
+		if(!createTestFunction(testModule,"test",AST::TypedExpression(invokeExpression,invokeType)))
+		{
+			std::cerr << "module already exports a function named test" << std::endl;
+			return -1;
+		}
 		
 		// Initialize the module runtime environment and call the test function.
 		if(!initModuleRuntime(testModule)) { return -1; }
-		auto assertLocus = filename + assertEq.locus.describe();
-		if(!callTestFunction(testModule,"test",assertLocus.c_str(),assertEq.value)) { ++numTestsFailed; }
+		AssertLocus assertLocus = {filename,wastFile.sourceLocator.get(),assertEq.sourceOffset};
+		if(!callTestFunction(testModule,"test",assertLocus,assertEq.value)) { ++numTestsFailed; }
 	}
 
 	// Print the results.
@@ -4,7 +4,15 @@
 #include "Core/Platform.h"
 #include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <iostream>
+#include <string>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
 
 namespace Runtime
 {
@@ -48,14 +56,305 @@ namespace Runtime
 		}
 	}
 
-	DEFINE_INTRINSIC_FUNCTION2(_pthread_cond_wait,I32,I32,a,I32,b) { return 0; }
-	DEFINE_INTRINSIC_FUNCTION1(_pthread_cond_broadcast,I32,I32,a) { return 0; }
-	DEFINE_INTRINSIC_FUNCTION2(_pthread_key_create,I32,I32,a,I32,b) { throw "_pthread_key_create"; }
-	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_lock,I32,I32,a) { return 0; }
-	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_unlock,I32,I32,a) { return 0; }
-	DEFINE_INTRINSIC_FUNCTION2(_pthread_setspecific,I32,I32,a,I32,b) { throw "_pthread_setspecific"; }
-	DEFINE_INTRINSIC_FUNCTION1(_pthread_getspecific,I32,I32,a) { throw "_pthread_getspecific"; }
-	DEFINE_INTRINSIC_FUNCTION2(_pthread_once,I32,I32,a,I32,b) { throw "_pthread_once"; }
+	// The pthread intrinsics run each instance thread on a host thread, with its own stack allocated from the instance's memory.
+	// Mutexes, condition variables, and once flags are kept in the instance's memory, and block using atomicWait/atomicNotify.
+	enum { pthreadEPERM = 1, pthreadESRCH = 3, pthreadEAGAIN = 11, pthreadEBUSY = 16, pthreadEINVAL = 22 };
+	enum { defaultThreadStackBytes = 1024*1024 };
+
+	// The module the instance was created from, set by initEmscriptenIntrinsics.
+	static const AST::Module* instanceModule = nullptr;
+
+	// Returns a reference to an aligned 32-bit word of the instance's memory that can be accessed atomically.
+	static std::atomic<uint32>& instanceAtomicRef(uint32 address)
+	{
+		if(address & 3) { throw "misaligned pthread object"; }
+		return *(std::atomic<uint32>*)&instanceMemoryRef<uint32>(address);
+	}
+
+	// Calls a function from the instance's function table for its type, passing it the new thread's globals. The module imports
+	// pthread_create, so it always has thread globals.
+	static uint32 callThreadStartRoutine(uint8* threadGlobals,uint32 startRoutine,uint32 argument)
+	{
+		auto function = getFunctionTableElement(instanceModule,AST::FunctionType::get(AST::TypeId::I32,{AST::TypeId::I32}),startRoutine);
+		if(!function) { throw "invalid thread start routine"; }
+		return ((uint32(*)(uint8*,uint32))function)(threadGlobals,argument);
+	}
+
+	// Thrown by pthread_exit to unwind the thread's stack to runThread.
+	struct ThreadExit { uint32 result; };
+
+	struct Thread
+	{
+		std::thread hostThread;
+		uint32 stackAddress;
+		uint32 numStackBytes;
+		uint32 result;
+		bool isDetached;
+		bool isJoining;
+		bool hasExited;
+	};
+
+	// The instance's threads that haven't been joined or exited while detached, and the stacks of threads that have.
+	// The main thread has ID 1, and isn't in the map.
+	static Platform::Mutex threadsMutex;
+	static std::map<uint32,Thread*> idToThreadMap;
+	static uint32 nextThreadId = 2;
+	static std::vector<std::pair<uint32,uint32>> freeThreadStacks;
+	static THREAD_LOCAL uint32 currentThreadId = 1;
+
+	// Releases a thread's stack for reuse, and deletes the thread. The caller must hold threadsMutex.
+	static void releaseThread(uint32 threadId,Thread* thread)
+	{
+		freeThreadStacks.push_back(std::make_pair(thread->stackAddress,thread->numStackBytes));
+		idToThreadMap.erase(threadId);
+		delete thread;
+	}
+
+	static void runThread(uint32 threadId,Thread* thread,uint32 startRoutine,uint32 argument)
+	{
+		// Give the thread its own copy of the module's globals, with the stack globals pointing to the thread's stack.
+		currentThreadId = threadId;
+		auto threadGlobals = createThreadGlobals({{&STACKTOPValue,thread->stackAddress},{&STACK_MAXValue,thread->stackAddress + thread->numStackBytes}});
+
+		uint32 result = 0;
+		try { result = callThreadStartRoutine(threadGlobals,startRoutine,argument); }
+		catch(const ThreadExit& threadExit) { result = threadExit.result; }
+		catch(...) { std::cerr << "thread " << threadId << " threw exception." << std::endl; }
+
+		// If the thread isn't detached yet, pthread_detach or pthread_join releases it.
+		Platform::Lock threadsLock(threadsMutex);
+		thread->result = result;
+		thread->hasExited = true;
+		if(thread->isDetached) { releaseThread(threadId,thread); }
+	}
+
+	DEFINE_INTRINSIC_FUNCTION4(_pthread_create,I32,I32,threadAddress,I32,attrAddress,I32,startRoutine,I32,argument)
+	{
+		// The first field of a pthread_attr_t is the stack size, or 0 for the default.
+		uint32 numStackBytes = attrAddress ? instanceMemoryRef<uint32>(attrAddress) : 0;
+		if(!numStackBytes) { numStackBytes = defaultThreadStackBytes; }
+		numStackBytes = (numStackBytes + 15) & ~15;
+
+		Platform::Lock threadsLock(threadsMutex);
+
+		// Reuse the stack of a thread that has finished if there's one big enough, or allocate a new one.
+		uint32 stackAddress = (uint32)-1;
+		for(auto stackIt = freeThreadStacks.begin();stackIt != freeThreadStacks.end();++stackIt)
+		{
+			if(stackIt->second >= numStackBytes)
+			{
+				stackAddress = stackIt->first;
+				numStackBytes = stackIt->second;
+				freeThreadStacks.erase(stackIt);
+				break;
+			}
+		}
+		if(stackAddress == (uint32)-1)
+		{
+			stackAddress = vmSbrk(numStackBytes + 15);
+			if(stackAddress == (uint32)-1) { return pthreadEAGAIN; }
+			stackAddress = (stackAddress + 15) & ~15;
+		}
+
+		auto thread = new Thread();
+		thread->stackAddress = stackAddress;
+		thread->numStackBytes = numStackBytes;
+		thread->result = 0;
+		thread->isDetached = false;
+		thread->isJoining = false;
+		thread->hasExited = false;
+		const uint32 threadId = nextThreadId++;
+		idToThreadMap[threadId] = thread;
+		thread->hostThread = std::thread(runThread,threadId,thread,startRoutine,argument);
+
+		instanceMemoryRef<uint32>(threadAddress) = threadId;
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_join,I32,I32,threadId,I32,resultAddress)
+	{
+		Platform::Lock threadsLock(threadsMutex);
+		auto threadIt = idToThreadMap.find(threadId);
+		if(threadIt == idToThreadMap.end()) { return pthreadESRCH; }
+		auto thread = threadIt->second;
+		if(thread->isDetached || thread->isJoining) { return pthreadEINVAL; }
+
+		// Mark the thread as being joined before releasing the lock, so another thread can't detach or join it while this thread waits.
+		thread->isJoining = true;
+		threadsLock.Release();
+
+		thread->hostThread.join();
+		if(resultAddress) { instanceMemoryRef<uint32>(resultAddress) = thread->result; }
+
+		Platform::Lock releaseLock(threadsMutex);
+		releaseThread(threadId,thread);
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_detach,I32,I32,threadId)
+	{
+		Platform::Lock threadsLock(threadsMutex);
+		auto threadIt = idToThreadMap.find(threadId);
+		if(threadIt == idToThreadMap.end()) { return pthreadESRCH; }
+		auto thread = threadIt->second;
+		if(thread->isDetached || thread->isJoining) { return pthreadEINVAL; }
+		thread->isDetached = true;
+		thread->hostThread.detach();
+
+		// If the thread has already exited, nothing else will release it.
+		if(thread->hasExited) { releaseThread(threadId,thread); }
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION0(_pthread_self,I32)
+	{
+		return currentThreadId;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_exit,Void,I32,result)
+	{
+		throw ThreadExit{result};
+	}
+
+	// A pthread_mutex_t starts with its type, followed by a lock word that is 0 if unlocked, 1 if locked, or 2 if locked and
+	// another thread may be waiting for it. Recursive mutexes also store the owning thread and the number of times it has locked it.
+	enum { mutexTypeOffset = 0, mutexLockOffset = 4, mutexOwnerOffset = 8, mutexCountOffset = 20 };
+	enum { pthreadMutexRecursive = 1 };
+
+	static void lockMutexWord(uint32 lockAddress)
+	{
+		auto& lock = instanceAtomicRef(lockAddress);
+		uint32 state = 0;
+		if(lock.compare_exchange_strong(state,1)) { return; }
+		if(state != 2) { state = lock.exchange(2); }
+		while(state != 0)
+		{
+			atomicWait(lockAddress,2,-1);
+			state = lock.exchange(2);
+		}
+	}
+	static void unlockMutexWord(uint32 lockAddress)
+	{
+		if(instanceAtomicRef(lockAddress).exchange(0) == 2) { atomicNotify(lockAddress,1); }
+	}
+
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_mutex_init,I32,I32,mutexAddress,I32,attrAddress)
+	{
+		memset(&instanceMemoryRef<uint8>(mutexAddress),0,24);
+		instanceMemoryRef<uint32>(mutexAddress + mutexTypeOffset) = attrAddress ? (instanceMemoryRef<uint32>(attrAddress) & 3) : 0;
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_destroy,I32,I32,mutexAddress) { return 0; }
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_lock,I32,I32,mutexAddress)
+	{
+		const bool isRecursive = instanceMemoryRef<uint32>(mutexAddress + mutexTypeOffset) == pthreadMutexRecursive;
+		if(isRecursive && instanceAtomicRef(mutexAddress + mutexOwnerOffset).load() == currentThreadId)
+		{
+			++instanceMemoryRef<uint32>(mutexAddress + mutexCountOffset);
+			return 0;
+		}
+		lockMutexWord(mutexAddress + mutexLockOffset);
+		if(isRecursive)
+		{
+			instanceAtomicRef(mutexAddress + mutexOwnerOffset).store(currentThreadId);
+			instanceMemoryRef<uint32>(mutexAddress + mutexCountOffset) = 1;
+		}
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_trylock,I32,I32,mutexAddress)
+	{
+		const bool isRecursive = instanceMemoryRef<uint32>(mutexAddress + mutexTypeOffset) == pthreadMutexRecursive;
+		if(isRecursive && instanceAtomicRef(mutexAddress + mutexOwnerOffset).load() == currentThreadId)
+		{
+			++instanceMemoryRef<uint32>(mutexAddress + mutexCountOffset);
+			return 0;
+		}
+		uint32 state = 0;
+		if(!instanceAtomicRef(mutexAddress + mutexLockOffset).compare_exchange_strong(state,1)) { return pthreadEBUSY; }
+		if(isRecursive)
+		{
+			instanceAtomicRef(mutexAddress + mutexOwnerOffset).store(currentThreadId);
+			instanceMemoryRef<uint32>(mutexAddress + mutexCountOffset) = 1;
+		}
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_mutex_unlock,I32,I32,mutexAddress)
+	{
+		if(instanceMemoryRef<uint32>(mutexAddress + mutexTypeOffset) == pthreadMutexRecursive)
+		{
+			if(instanceAtomicRef(mutexAddress + mutexOwnerOffset).load() != currentThreadId) { return pthreadEPERM; }
+			if(--instanceMemoryRef<uint32>(mutexAddress + mutexCountOffset)) { return 0; }
+			instanceAtomicRef(mutexAddress + mutexOwnerOffset).store(0);
+		}
+		unlockMutexWord(mutexAddress + mutexLockOffset);
+		return 0;
+	}
+
+	// A pthread_cond_t starts with a sequence number that is incremented each time the condition is signaled.
+	// Waiters unlock the mutex, and wait until the sequence number changes from the value it had while they held the mutex.
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_cond_init,I32,I32,condAddress,I32,attrAddress)
+	{
+		memset(&instanceMemoryRef<uint8>(condAddress),0,48);
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_cond_destroy,I32,I32,condAddress) { return 0; }
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_cond_wait,I32,I32,condAddress,I32,mutexAddress)
+	{
+		const uint32 sequence = instanceAtomicRef(condAddress).load();
+		_pthread_mutex_unlockIntrinsicFunc(mutexAddress);
+		atomicWait(condAddress,sequence,-1);
+		return _pthread_mutex_lockIntrinsicFunc(mutexAddress);
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_cond_signal,I32,I32,condAddress)
+	{
+		instanceAtomicRef(condAddress).fetch_add(1);
+		atomicNotify(condAddress,1);
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_cond_broadcast,I32,I32,condAddress)
+	{
+		instanceAtomicRef(condAddress).fetch_add(1);
+		atomicNotify(condAddress,UINT32_MAX);
+		return 0;
+	}
+
+	// A pthread_once_t is 0 before the init routine runs, 1 while it's running, and 2 after it has run.
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_once,I32,I32,onceAddress,I32,initRoutine)
+	{
+		auto& once = instanceAtomicRef(onceAddress);
+		while(true)
+		{
+			uint32 state = 0;
+			if(once.compare_exchange_strong(state,1))
+			{
+				auto function = getFunctionTableElement(instanceModule,AST::FunctionType::get(AST::TypeId::Void),initRoutine);
+				if(!function) { throw "invalid pthread_once routine"; }
+				if(hasThreadGlobals(instanceModule)) { ((void(*)(uint8*))function)(getThreadGlobals()); }
+				else { ((void(*)())function)(); }
+				once.store(2);
+				atomicNotify(onceAddress,UINT32_MAX);
+				return 0;
+			}
+			else if(state == 2) { return 0; }
+			atomicWait(onceAddress,1,-1);
+		}
+	}
+
+	// Thread-specific data. Key destructors aren't called when a thread exits, but the values are freed.
+	static std::atomic<uint32> nextThreadSpecificKey(1);
+	static thread_local std::vector<uint32> threadSpecificValues;
+
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_key_create,I32,I32,keyAddress,I32,destructor)
+	{
+		instanceMemoryRef<uint32>(keyAddress) = nextThreadSpecificKey++;
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION2(_pthread_setspecific,I32,I32,key,I32,value)
+	{
+		if(key >= threadSpecificValues.size()) { threadSpecificValues.resize(key + 1,0); }
+		threadSpecificValues[key] = value;
+		return 0;
+	}
+	DEFINE_INTRINSIC_FUNCTION1(_pthread_getspecific,I32,I32,key)
+	{
+		return key < threadSpecificValues.size() ? threadSpecificValues[key] : 0;
+	}
 
 	DEFINE_INTRINSIC_FUNCTION0(___ctype_b_loc,I32)
 	{
@@ -100,20 +399,32 @@ namespace Runtime
 	{
 		return 0;
 	}
+	// The first byte of a static variable's guard is set once the variable is initialized. The compiled code checks it before calling
+	// ___cxa_guard_acquire, which uses the guard's first 32-bit word to make sure only one thread runs the initializer: the word
+	// is 0 before initialization, guardInitializing while a thread is initializing the variable, and guardInitialized after.
+	// Other threads block with atomicWait until the initializing thread calls ___cxa_guard_release or ___cxa_guard_abort.
+	enum { guardInitialized = 1, guardInitializing = 0x100 };
 	DEFINE_INTRINSIC_FUNCTION1(___cxa_guard_acquire,I32,I32,address)
 	{
-		if(!instanceMemoryRef<uint8>(address))
+		auto& guard = instanceAtomicRef(address);
+		while(true)
 		{
-			instanceMemoryRef<uint8>(address) = 1;
-			return 1;
-		}
-		else
-		{
-			return 0;
+			uint32 state = 0;
+			if(guard.compare_exchange_strong(state,guardInitializing)) { return 1; }
+			else if(state == guardInitialized) { return 0; }
+			atomicWait(address,state,-1);
 		}
 	}
-	DEFINE_INTRINSIC_FUNCTION1(___cxa_guard_release,Void,I32,a)
-	{}
+	DEFINE_INTRINSIC_FUNCTION1(___cxa_guard_release,Void,I32,address)
+	{
+		instanceAtomicRef(address).store(guardInitialized);
+		atomicNotify(address,UINT32_MAX);
+	}
+	DEFINE_INTRINSIC_FUNCTION1(___cxa_guard_abort,Void,I32,address)
+	{
+		instanceAtomicRef(address).store(0);
+		atomicNotify(address,UINT32_MAX);
+	}
 	DEFINE_INTRINSIC_FUNCTION3(___cxa_throw,Void,I32,a,I32,b,I32,c)
 	{
 		throw "___cxa_throw";
@@ -132,13 +443,21 @@ namespace Runtime
 	}
 	DEFINE_INTRINSIC_FUNCTION0(_abort,Void)
 	{
+		flushEmscriptenOutput();
 		throw "_abort";
 	}
 	DEFINE_INTRINSIC_FUNCTION1(abort,Void,I32,code)
 	{
+		// Write the instance's buffered output before the abort message, so they appear in the order they were written.
+		flushEmscriptenOutput();
 		std::cerr << "abort(" << code << ")" << std::endl;
 		throw "abort";
 	}
+	DEFINE_INTRINSIC_FUNCTION1(_exit,Void,I32,code)
+	{
+		flushEmscriptenOutput();
+		exit(code);
+	}
 
 	static uint32 currentLocale = 0;
 	DEFINE_INTRINSIC_FUNCTION1(_uselocale,I32,I32,locale)
@@ -165,7 +484,33 @@ namespace Runtime
 	DEFINE_INTRINSIC_FUNCTION4(_catgets,I32,I32,catd,I32,set_id,I32,msg_id,I32,s) { return s; }
 	DEFINE_INTRINSIC_FUNCTION1(_catclose,I32,I32,a) { return 0; }
 
-	DEFINE_INTRINSIC_FUNCTION3(_emscripten_memcpy_big,I32,I32,a,I32,b,I32,c) { throw "_emscripten_memcpy_big"; }
+	// Checks that a range of bytes passed to a bulk memory intrinsic is within the instance's address space.
+	// The check is done once per call, after which the host's memcpy/memmove/memset can operate on the whole range.
+	static void checkBulkMemoryRange(uint32 address,uint32 numBytes)
+	{
+		if(uint64(address) + numBytes > instanceAddressSpaceMaxBytes) { throw "bulk memory access out of bounds"; }
+	}
+
+	DEFINE_INTRINSIC_FUNCTION3(_emscripten_memcpy_big,I32,I32,dest,I32,source,I32,numBytes)
+	{
+		checkBulkMemoryRange(dest,numBytes);
+		checkBulkMemoryRange(source,numBytes);
+		memcpy(&instanceMemoryRef<uint8>(dest),&instanceMemoryRef<uint8>(source),numBytes);
+		return dest;
+	}
+	DEFINE_INTRINSIC_FUNCTION3(_memmove,I32,I32,dest,I32,source,I32,numBytes)
+	{
+		checkBulkMemoryRange(dest,numBytes);
+		checkBulkMemoryRange(source,numBytes);
+		memmove(&instanceMemoryRef<uint8>(dest),&instanceMemoryRef<uint8>(source),numBytes);
+		return dest;
+	}
+	DEFINE_INTRINSIC_FUNCTION3(_memset,I32,I32,dest,I32,value,I32,numBytes)
+	{
+		checkBulkMemoryRange(dest,numBytes);
+		memset(&instanceMemoryRef<uint8>(dest),(uint8)value,numBytes);
+		return dest;
+	}
 
 	enum class ioStreamVMHandle
 	{
@@ -184,12 +529,290 @@ namespace Runtime
 		}
 	}
 
-	DEFINE_INTRINSIC_FUNCTION3(_vfprintf,I32,I32,file,I32,formatPointer,I32,argList)
+	// The instance's stdout is buffered in the instance's memory, and the buffered bytes are written to the stream's file with a
+	// single writev when the buffer fills, the instance flushes the stream, or the runtime calls flushEmscriptenOutput.
+	// stderr isn't buffered, but writing to it flushes stdout first so the output of the two streams stays in order.
+	struct OutputStream
 	{
-		throw;
+		int fileDescriptor;
+		uint32 bufferAddress;
+		uint32 numBufferBytes;
+		uint32 numBufferedBytes;
+	};
+	static OutputStream stdoutStream = {1,0,0,0};
+	static OutputStream stderrStream = {2,0,0,0};
+	static uint32 outputBufferSize = 64*1024;
+
+	// Serializes output from the instance's threads. The stream functions below expect the caller to hold it.
+	static Platform::Mutex outputStreamMutex;
+
+	static OutputStream* vmOutputStream(uint32 vmHandle)
+	{
+		switch((ioStreamVMHandle)vmHandle)
+		{
+		case ioStreamVMHandle::StdErr: return &stderrStream;
+		case ioStreamVMHandle::StdIn: return nullptr;
+		default: return &stdoutStream;
+		}
+	}
+
+	// Writes the stream's buffered bytes followed by numBytes of data, and empties the buffer.
+	static bool flushOutputStream(OutputStream& stream,const uint8* data = nullptr,size_t numBytes = 0)
+	{
+		const Platform::WriteBuffer buffers[2] =
+		{
+			{&instanceMemoryRef<uint8>(stream.bufferAddress),stream.numBufferedBytes},
+			{data,numBytes}
+		};
+		stream.numBufferedBytes = 0;
+		return Platform::writeFileBuffers(stream.fileDescriptor,buffers,2);
 	}
+
+	// Appends data to the stream's buffer if it fits, or otherwise writes it along with the buffered bytes.
+	static bool writeOutputStream(OutputStream& stream,const uint8* data,size_t numBytes)
+	{
+		if(&stream == &stderrStream && stdoutStream.numBufferedBytes) { flushOutputStream(stdoutStream); }
+		if(stream.numBufferedBytes + numBytes <= stream.numBufferBytes)
+		{
+			memcpy(&instanceMemoryRef<uint8>(stream.bufferAddress + stream.numBufferedBytes),data,numBytes);
+			stream.numBufferedBytes += (uint32)numBytes;
+			return true;
+		}
+		else { return flushOutputStream(stream,data,numBytes); }
+	}
+
+	static void flushOutputStreams()
+	{
+		flushOutputStream(stdoutStream);
+		flushOutputStream(stderrStream);
+	}
+
+	void setEmscriptenOutputFiles(int stdoutFileDescriptor,int stderrFileDescriptor)
+	{
+		Platform::Lock outputLock(outputStreamMutex);
+		flushOutputStreams();
+		stdoutStream.fileDescriptor = stdoutFileDescriptor;
+		stderrStream.fileDescriptor = stderrFileDescriptor;
+	}
+
+	void setEmscriptenOutputBufferSize(uint32 numBytes)
+	{
+		outputBufferSize = numBytes;
+	}
+
+	void flushEmscriptenOutput()
+	{
+		Platform::Lock outputLock(outputStreamMutex);
+		flushOutputStreams();
+	}
+
+	// Reads the arguments of an Emscripten va_list: a pointer to the arguments stored consecutively in the instance's memory,
+	// each aligned to its own size.
+	struct VarArgReader
+	{
+		uint32 address;
+
+		VarArgReader(uint32 inAddress): address(inAddress) {}
+
+		template<typename Type> Type read()
+		{
+			address = (address + sizeof(Type) - 1) & ~uint32(sizeof(Type) - 1);
+			if(uint64(address) + sizeof(Type) > instanceAddressSpaceMaxBytes) { throw "vfprintf: argument out of bounds"; }
+			Type result;
+			memcpy(&result,&instanceMemoryRef<uint8>(address),sizeof(Type));
+			address += sizeof(Type);
+			return result;
+		}
+	};
+
+	// Returns the length of a null-terminated string in the instance's memory, reading at most maxLength bytes.
+	static uint32 getInstanceStringLength(uint32 address,uint64 maxLength)
+	{
+		const uint64 maxAddress = std::min(uint64(address) + maxLength,(uint64)instanceAddressSpaceMaxBytes);
+		uint64 endAddress = address;
+		while(endAddress < maxAddress && instanceMemoryRef<char>((uint32)endAddress)) { ++endAddress; }
+		if(endAddress == instanceAddressSpaceMaxBytes) { throw "vfprintf: string out of bounds"; }
+		return (uint32)(endAddress - address);
+	}
+
+	// Appends the result of formatting the arguments with snprintf to a string.
+	template<typename... Args>
+	static void appendFormatted(std::string& outString,const char* spec,Args... args)
+	{
+		enum { initialNumChars = 64 };
+		auto offset = outString.size();
+		outString.resize(offset + initialNumChars);
+		auto numChars = snprintf(&outString[offset],initialNumChars,spec,args...);
+		if(numChars < 0) { throw "vfprintf: formatting failed"; }
+		if(numChars >= initialNumChars)
+		{
+			outString.resize(offset + numChars + 1);
+			snprintf(&outString[offset],numChars + 1,spec,args...);
+		}
+		outString.resize(offset + numChars);
+	}
+
+	// Formats a printf-style format string and argument list from the instance's memory with the host's snprintf.
+	// Each conversion is parsed here so its argument can be read from the va_list with the type implied by its length
+	// modifier, and so strings and %n pointers can be bounds checked.
+	static void formatInstanceString(uint32 formatAddress,uint32 argListAddress,std::string& outString)
+	{
+		VarArgReader args(argListAddress);
+		auto formatLength = getInstanceStringLength(formatAddress,UINT32_MAX);
+		const char* format = &instanceMemoryRef<char>(formatAddress);
+		const char* formatEnd = format + formatLength;
+		while(format < formatEnd)
+		{
+			// Copy everything up to the next conversion directly to the output.
+			auto conversionStart = (const char*)memchr(format,'%',formatEnd - format);
+			if(!conversionStart) { conversionStart = formatEnd; }
+			outString.append(format,conversionStart);
+			if(conversionStart == formatEnd) { break; }
+			format = conversionStart + 1;
+
+			// Parse the flags and width. A negative width argument is a left-justify flag followed by a positive width. snprintf
+			// interprets it the same way, so the argument is passed to it unchanged.
+			std::string spec = "%";
+			bool isLeftJustified = false;
+			while(format < formatEnd && strchr("-+ #0",*format)) { isLeftJustified |= *format == '-'; spec += *format++; }
+			int32 widthArgument = 0;
+			uint32 width = 0;
+			bool hasWidthArgument = false;
+			if(format < formatEnd && *format == '*')
+			{
+				hasWidthArgument = true;
+				widthArgument = args.read<int32>();
+				isLeftJustified |= widthArgument < 0;
+				width = widthArgument < 0 ? 0 - (uint32)widthArgument : (uint32)widthArgument;
+				spec += '*';
+				++format;
+			}
+			else { while(format < formatEnd && *format >= '0' && *format <= '9') { width = width * 10 + (*format - '0'); spec += *format++; } }
+
+			// Parse the precision. A negative precision argument is treated as if the precision were omitted.
+			int32 precision = -1;
+			bool hasPrecisionArgument = false;
+			if(format < formatEnd && *format == '.')
+			{
+				spec += *format++;
+				if(format < formatEnd && *format == '*') { hasPrecisionArgument = true; precision = args.read<int32>(); spec += '*'; ++format; }
+				else
+				{
+					precision = 0;
+					while(format < formatEnd && *format >= '0' && *format <= '9') { precision = precision * 10 + (*format - '0'); spec += *format++; }
+				}
+			}
+
+			// Parse the length modifier. The instance's long, size_t, ptrdiff_t, and pointers are all 32-bit.
+			// L only applies to floating-point conversions, and is checked separately.
+			uint32 numArgBits = 32;
+			bool isLong = false;
+			bool isLongDouble = false;
+			if(format + 1 < formatEnd && ((format[0] == 'h' && format[1] == 'h') || (format[0] == 'l' && format[1] == 'l'))) { numArgBits = format[0] == 'l' ? 64 : 8; format += 2; }
+			else if(format < formatEnd && *format == 'L') { isLongDouble = true; ++format; }
+			else if(format < formatEnd && strchr("hljzt",*format)) { numArgBits = *format == 'j' ? 64 : *format == 'h' ? 16 : 32; isLong = *format == 'l'; ++format; }
+			if(format == formatEnd) { throw "vfprintf: incomplete conversion"; }
+			const char conversion = *format++;
+			if(isLong && (conversion == 'c' || conversion == 's')) { throw "vfprintf: wide character conversions aren't supported"; }
+			if(isLongDouble && !strchr("fFeEgGaA",conversion)) { throw "vfprintf: L length modifier on a conversion that isn't floating-point"; }
+
+			#define APPEND_FORMATTED(value) \
+				(hasWidthArgument && hasPrecisionArgument ? appendFormatted(outString,spec.c_str(),widthArgument,precision,value) \
+				: hasWidthArgument ? appendFormatted(outString,spec.c_str(),widthArgument,value) \
+				: hasPrecisionArgument ? appendFormatted(outString,spec.c_str(),precision,value) \
+				: appendFormatted(outString,spec.c_str(),value))
+			switch(conversion)
+			{
+			case '%': outString += '%'; break;
+			case 'd': case 'i':
+			{
+				// hh and h convert the promoted argument to signed char or short before printing it.
+				auto value = numArgBits == 64 ? (int64)args.read<uint64>() : (int64)(int32)args.read<uint32>();
+				if(numArgBits == 8) { value = (int8)value; }
+				else if(numArgBits == 16) { value = (int16)value; }
+				spec += "lld";
+				APPEND_FORMATTED((long long)value);
+				break;
+			}
+			case 'u': case 'o': case 'x': case 'X':
+			{
+				auto value = numArgBits == 64 ? args.read<uint64>() : (uint64)args.read<uint32>();
+				if(numArgBits == 8) { value = (uint8)value; }
+				else if(numArgBits == 16) { value = (uint16)value; }
+				spec += "ll";
+				spec += conversion;
+				APPEND_FORMATTED((unsigned long long)value);
+				break;
+			}
+			case 'c':
+				spec += 'c';
+				APPEND_FORMATTED((int)args.read<uint32>());
+				break;
+			case 'p':
+				spec += "#x";
+				APPEND_FORMATTED((unsigned int)args.read<uint32>());
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				// The instance's long double is the same 64-bit type as its double, so %Lf reads the same argument as %f.
+				spec += conversion;
+				APPEND_FORMATTED(args.read<float64>());
+				break;
+			case 's':
+			{
+				// Copy the string directly from the instance's memory, bounded by the precision and padded to the width.
+				auto stringAddress = args.read<uint32>();
+				auto stringLength = getInstanceStringLength(stringAddress,precision >= 0 ? (uint64)precision : UINT32_MAX);
+				auto numPaddingChars = (uint32)width > stringLength ? (uint32)width - stringLength : 0;
+				if(!isLeftJustified) { outString.append(numPaddingChars,' '); }
+				outString.append(&instanceMemoryRef<char>(stringAddress),stringLength);
+				if(isLeftJustified) { outString.append(numPaddingChars,' '); }
+				break;
+			}
+			case 'n':
+			{
+				// Write the number of characters output so far to the pointer argument, as the type given by the length modifier.
+				auto countAddress = args.read<uint32>();
+				if(uint64(countAddress) + numArgBits / 8 > instanceAddressSpaceMaxBytes) { throw "vfprintf: argument out of bounds"; }
+				switch(numArgBits)
+				{
+				case 8: instanceMemoryRef<int8>(countAddress) = (int8)outString.size(); break;
+				case 16: instanceMemoryRef<int16>(countAddress) = (int16)outString.size(); break;
+				case 32: instanceMemoryRef<int32>(countAddress) = (int32)outString.size(); break;
+				case 64: instanceMemoryRef<int64>(countAddress) = (int64)outString.size(); break;
+				default: throw;
+				}
+				break;
+			}
+			default: throw "vfprintf: unsupported conversion";
+			};
+			#undef APPEND_FORMATTED
+		}
+	}
+
+	DEFINE_INTRINSIC_FUNCTION3(_vfprintf,I32,I32,file,I32,formatAddress,I32,argListAddress)
+	{
+		auto stream = vmOutputStream(file);
+		if(!stream) { return (uint32)-1; }
+
+		// Format the string before taking the output lock, so threads only hold the lock to write. Each thread reuses its string's
+		// storage across calls to avoid allocating for every call.
+		static thread_local std::string formattedString;
+		formattedString.clear();
+		formatInstanceString(formatAddress,argListAddress,formattedString);
+
+		Platform::Lock outputLock(outputStreamMutex);
+		if(!writeOutputStream(*stream,(const uint8*)formattedString.data(),formattedString.size())) { return (uint32)-1; }
+		return (uint32)formattedString.size();
+	}
+
 	DEFINE_INTRINSIC_FUNCTION1(_getc,I32,I32,file)
 	{
+		// Make sure any prompt the instance wrote is visible before blocking on input.
+		if((ioStreamVMHandle)file == ioStreamVMHandle::StdIn)
+		{
+			Platform::Lock outputLock(outputStreamMutex);
+			flushOutputStream(stdoutStream);
+		}
 		return getc(vmFile(file));
 	}
 	DEFINE_INTRINSIC_FUNCTION2(_ungetc,I32,I32,character,I32,file)
@@ -198,36 +821,63 @@ namespace Runtime
 	}
 	DEFINE_INTRINSIC_FUNCTION4(_fwrite,I32,I32,pointer,I32,size,I32,count,I32,file)
 	{
-		if(pointer + uint64(size) * count > (1ull << 32))
-		{
-			throw;
-		}
-		else
-		{
-			return (int32)fwrite(&instanceMemoryRef<uint8>(pointer),size,count,vmFile(file));
-		}
+		const uint64 numBytes = uint64(size) * count;
+		if(uint64(pointer) + numBytes > instanceAddressSpaceMaxBytes) { throw "fwrite: buffer out of bounds"; }
+		auto stream = vmOutputStream(file);
+		if(!stream) { return 0; }
+		Platform::Lock outputLock(outputStreamMutex);
+		return writeOutputStream(*stream,&instanceMemoryRef<uint8>(pointer),(size_t)numBytes) ? count : 0;
 	}
 	DEFINE_INTRINSIC_FUNCTION2(_fputc,I32,I32,character,I32,file)
 	{
-		return fputc(character,vmFile(file));
+		auto stream = vmOutputStream(file);
+		const uint8 byte = (uint8)character;
+		Platform::Lock outputLock(outputStreamMutex);
+		if(!stream || !writeOutputStream(*stream,&byte,1)) { return (uint32)EOF; }
+		return byte;
 	}
 	DEFINE_INTRINSIC_FUNCTION1(_fflush,I32,I32,file)
 	{
-		return fflush(vmFile(file));
+		// fflush(NULL) flushes all output streams.
+		Platform::Lock outputLock(outputStreamMutex);
+		if(!file)
+		{
+			flushOutputStreams();
+			return 0;
+		}
+		auto stream = vmOutputStream(file);
+		if(!stream) { return 0; }
+		return flushOutputStream(*stream) ? 0 : (uint32)EOF;
 	}
 
-	void initEmscriptenIntrinsics()
+	bool initEmscriptenIntrinsics(const AST::Module* module)
 	{
+		instanceModule = module;
+
+		// Forget the thread stacks freed in any previous instance's memory.
+		{
+			Platform::Lock threadsLock(threadsMutex);
+			freeThreadStacks.clear();
+		}
+
 		// Allocate a 5MB stack.
 		STACKTOPValue = vmSbrk(5*1024*1024);
 		STACK_MAXValue = vmSbrk(0);
+		if(STACKTOPValue == (uint32)-1) { return false; }
 
 		// Setup IO stream handles.
 		_stderrValue = vmSbrk(sizeof(uint32));
 		_stdinValue = vmSbrk(sizeof(uint32));
 		_stdoutValue = vmSbrk(sizeof(uint32));
+		if(_stderrValue == (uint32)-1 || _stdinValue == (uint32)-1 || _stdoutValue == (uint32)-1) { return false; }
 		instanceMemoryRef<uint32>(_stderrValue) = (uint32)ioStreamVMHandle::StdErr;
 		instanceMemoryRef<uint32>(_stdinValue) = (uint32)ioStreamVMHandle::StdIn;
 		instanceMemoryRef<uint32>(_stdoutValue) = (uint32)ioStreamVMHandle::StdOut;
+
+		// Allocate the stdout buffer. If there isn't enough memory for it, write output unbuffered.
+		stdoutStream.bufferAddress = vmSbrk((int32)outputBufferSize);
+		stdoutStream.numBufferBytes = stdoutStream.bufferAddress == (uint32)-1 ? 0 : outputBufferSize;
+		stdoutStream.numBufferedBytes = 0;
+		return true;
 	}
 }
\ No newline at end of file
@@ -1,40 +1,62 @@
 #include "Core/Core.h"
 #include "Intrinsics.h"
 #include "Core/Platform.h"
-
-#include <string>
+#include "Core/StringHashMap.h"
 
 namespace Intrinsics
 {
-	struct Singleton
+	// The intrinsics registered by the constructors of static Function and Value objects.
+	struct Registry
 	{
-		std::map<std::string,Function*> functionMap;
-		std::map<std::string,Value*> valueMap;
+		std::vector<const Function*> functions;
+		std::vector<const Value*> values;
 		Platform::Mutex mutex;
+		bool isFrozen;
+
+		Registry(): isFrozen(false) {}
+		Registry(const Registry&) = delete;
+
+		static Registry& get()
+		{
+			static Registry result;
+			return result;
+		}
+	};
+
+	// The registry is frozen into immutable hash tables the first time an intrinsic is looked up, which is after static initialization
+	// has registered all the intrinsics. After that, any number of threads can look up intrinsics without locking.
+	struct FrozenRegistry
+	{
+		Core::StringHashMap<const Function*> functionMap;
+		Core::StringHashMap<const Value*> valueMap;
 
-		Singleton() {}
-		Singleton(const Singleton&) = delete;
+		FrozenRegistry()
+		{
+			Registry& registry = Registry::get();
+			Platform::Lock lock(registry.mutex);
+			registry.isFrozen = true;
+
+			// If an intrinsic name is registered more than once, the first registration is used.
+			for(auto function : registry.functions) { functionMap.add(function->name,function); }
+			for(auto value : registry.values) { valueMap.add(value->name,value); }
+		}
+		FrozenRegistry(const FrozenRegistry&) = delete;
 
-		static Singleton& get()
+		static const FrozenRegistry& get()
 		{
-			static Singleton result;
+			static const FrozenRegistry result;
 			return result;
 		}
 	};
 
-	Function::Function(const char* inName,const AST::FunctionType& inType,void* inValue)
+	Function::Function(const char* inName,const AST::FunctionType* inType,void* inValue)
 	:	name(inName)
 	,	type(inType)
 	,	value(inValue)
 	{
-		Platform::Lock lock(Singleton::get().mutex);
-		Singleton::get().functionMap[inName] = this;
-	}
-
-	Function::~Function()
-	{
-		Platform::Lock Lock(Singleton::get().mutex);
-		Singleton::get().functionMap.erase(Singleton::get().functionMap.find(name));
+		Platform::Lock lock(Registry::get().mutex);
+		assert(!Registry::get().isFrozen);
+		Registry::get().functions.push_back(this);
 	}
 
 	Value::Value(const char* inName,AST::TypeId inType,void* inValue)
@@ -42,27 +64,20 @@ namespace Intrinsics
 	,	type(inType)
 	,	value(inValue)
 	{
-		Platform::Lock lock(Singleton::get().mutex);
-		Singleton::get().valueMap[inName] = this;
-	}
-
-	Value::~Value()
-	{
-		Platform::Lock Lock(Singleton::get().mutex);
-		Singleton::get().valueMap.erase(Singleton::get().valueMap.find(name));
+		Platform::Lock lock(Registry::get().mutex);
+		assert(!Registry::get().isFrozen);
+		Registry::get().values.push_back(this);
 	}
 
 	const Function* findFunction(const char* name)
 	{
-		Platform::Lock Lock(Singleton::get().mutex);
-		auto keyValue = Singleton::get().functionMap.find(name);
-		return keyValue == Singleton::get().functionMap.end() ? nullptr : keyValue->second;
+		auto function = FrozenRegistry::get().functionMap.get(name);
+		return function ? *function : nullptr;
 	}
 
 	const Value* findValue(const char* name)
 	{
-		Platform::Lock Lock(Singleton::get().mutex);
-		auto keyValue = Singleton::get().valueMap.find(name);
-		return keyValue == Singleton::get().valueMap.end() ? nullptr : keyValue->second;
+		auto value = FrozenRegistry::get().valueMap.get(name);
+		return value ? *value : nullptr;
 	}
 }
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Intrinsics.h"
@@ -39,8 +40,10 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Vectorize.h"
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -65,6 +68,17 @@ namespace LLVMJIT
 	// Zero constants of each type.
 	llvm::Constant* typedZeroConstants[(size_t)TypeId::num];
 
+	// Type-based alias analysis tags for the memory accessed by JITed code. The instance memory, the module's global variables, and the
+	// global variables imported from intrinsic values are disjoint, but LLVM can't prove it from the pointers alone: instance memory is
+	// addressed from an integer constant base, and imported values and thread globals are addressed through pointers it doesn't know the
+	// target of. The tags let it keep global variables in registers across instance memory stores, and hoist them out of loops.
+	llvm::MDNode* instanceMemoryTBAATag = nullptr;
+	llvm::MDNode* globalTBAATag = nullptr;
+	llvm::MDNode* importedGlobalTBAATag = nullptr;
+
+	// The most different functions a function table can contain for call_indirect through it to be compiled to a switch of direct calls.
+	const uintptr_t maxDevirtualizedCallTargets = 4;
+
 	// All the modules that have been JITted.
 	std::vector<struct JITModule*> jitModules;
 	
@@ -72,23 +86,30 @@ namespace LLVMJIT
 	llvm::Type* asLLVMType(TypeId type) { return llvmTypesByTypeId[(uintptr_t)type]; }
 	
 	// Converts an AST function type to a LLVM type.
-	llvm::FunctionType* asLLVMType(const FunctionType& functionType,bool addFunctionSignatureArg)
+	llvm::FunctionType* asLLVMType(const FunctionType* functionType,bool addFunctionSignatureArg,bool addThreadGlobalsArg)
 	{
-		size_t numExtraLLVMArgs = addFunctionSignatureArg ? 1 : 0;
-		auto llvmArgTypes = (llvm::Type**)alloca(sizeof(llvm::Type*) * (functionType.parameters.size() + numExtraLLVMArgs));
+		size_t numExtraLLVMArgs = (addFunctionSignatureArg ? 1 : 0) + (addThreadGlobalsArg ? 1 : 0);
+		auto llvmArgTypes = (llvm::Type**)alloca(sizeof(llvm::Type*) * (functionType->parameters.size() + numExtraLLVMArgs));
 		uintptr_t llvmArgIndex = 0;
 		if(addFunctionSignatureArg)
 		{
 			llvmArgTypes[llvmArgIndex++] = llvm::Type::getInt32Ty(context);
 		}
-		for(uintptr_t argIndex = 0;argIndex < functionType.parameters.size();++argIndex)
+		if(addThreadGlobalsArg)
 		{
-			llvmArgTypes[llvmArgIndex++] = asLLVMType(functionType.parameters[argIndex]);
+			llvmArgTypes[llvmArgIndex++] = llvm::Type::getInt8PtrTy(context);
 		}
-		auto llvmReturnType = asLLVMType(functionType.returnType);
-		return llvm::FunctionType::get(llvmReturnType,llvm::ArrayRef<llvm::Type*>(llvmArgTypes,functionType.parameters.size() + numExtraLLVMArgs),false);
+		for(uintptr_t argIndex = 0;argIndex < functionType->parameters.size();++argIndex)
+		{
+			llvmArgTypes[llvmArgIndex++] = asLLVMType(functionType->parameters[argIndex]);
+		}
+		auto llvmReturnType = asLLVMType(functionType->returnType);
+		return llvm::FunctionType::get(llvmReturnType,llvm::ArrayRef<llvm::Type*>(llvmArgTypes,functionType->parameters.size() + numExtraLLVMArgs),false);
 	}
 
+	// Returns the name of the LLVM global variable for a function table. Starts with a character that can't be in an export name.
+	std::string getFunctionTableName(uintptr_t tableIndex) { return "#functionTable" + std::to_string(tableIndex); }
+
 	// Converts an AST name to a LLVM name. Ensures that the name is not-null, and prefixes it to ensure it doesn't conflict with export names.
 	llvm::Twine getLLVMName(const char* nullableName) { return nullableName ? (llvm::Twine('_') + llvm::Twine(nullableName)) : ""; }
 
@@ -100,6 +121,7 @@ namespace LLVMJIT
 	llvm::Constant* compileLiteral(float32 value) { return llvm::ConstantFP::get(context,llvm::APFloat(value)); }
 	llvm::Constant* compileLiteral(float64 value) { return llvm::ConstantFP::get(context,llvm::APFloat(value)); }
 	llvm::Constant* compileLiteral(bool value) { return llvm::ConstantInt::get(asLLVMType(TypeId::Bool),llvm::APInt(1,value ? 1 : 0,false)); }
+	llvm::Constant* compileLiteral(const NativeTypes::V128& value) { return llvm::ConstantVector::get({compileLiteral(value.u64[0]),compileLiteral(value.u64[1])}); }
 	
 	// Information about a JITed module.
 	struct JITModule
@@ -108,18 +130,29 @@ namespace LLVMJIT
 		llvm::Module* llvmModule;
 		std::vector<llvm::Function*> functions;
 		std::vector<llvm::GlobalVariable*> globalVariablePointers;
+		std::vector<llvm::MDNode*> globalTBAATags;
 		std::vector<llvm::GlobalVariable*> functionImportPointers;
 		std::vector<llvm::GlobalVariable*> functionTablePointers;
 		llvm::Value* instanceMemoryBase;
 		llvm::Value* instanceMemoryAddressMask;
 		llvm::ExecutionEngine* executionEngine;
 
+		// For each function table that contains at most maxDevirtualizedCallTargets different functions, the indices of those functions,
+		// ordered from the most to the least common in the table. Empty for the other tables.
+		std::vector<std::vector<uintptr_t>> functionTableCallTargets;
+
+		// If the module can create threads, its global variables are stored in per-thread memory returned by Runtime::getThreadGlobals,
+		// and globalVariablePointers is empty. Each function defined by the module takes a pointer to the calling thread's globals as an
+		// extra argument, and the exported functions are thunks that look the pointer up once when the host calls into the module.
+		bool hasThreadGlobals;
+
 		JITModule(const Module* inASTModule)
 		:	astModule(inASTModule)
 		,	llvmModule(new llvm::Module("",context))
 		,	instanceMemoryBase(nullptr)
 		,	instanceMemoryAddressMask(nullptr)
 		,	executionEngine(nullptr)
+		,	hasThreadGlobals(false)
 		{}
 	};
 
@@ -134,6 +167,9 @@ namespace LLVMJIT
 
 		llvm::Value** localVariablePointers;
 
+		// The calling thread's globals, if the module has thread globals. Passed to the function by its caller.
+		llvm::Value* threadGlobals;
+
 		llvm::BasicBlock* unreachableBlock;
 		
 		// An arena for allocations that can be discarded after compiling the function.
@@ -166,6 +202,7 @@ namespace LLVMJIT
 		, llvmFunction(jitModule.functions[functionIndex])
 		, irBuilder(context)
 		, localVariablePointers(nullptr)
+		, threadGlobals(nullptr)
 		, branchContext(nullptr)
 		{
 			unreachableBlock = llvm::BasicBlock::Create(context,"unreachable",llvmFunction);
@@ -207,6 +244,46 @@ namespace LLVMJIT
 			return llvm::Intrinsic::getDeclaration(jitModule.llvmModule,id,llvm::ArrayRef<llvm::Type*>(argTypes.begin(),argTypes.end()));
 		}
 
+		// Compiles a call to a native function in the runtime.
+		llvm::Value* compileRuntimeCall(void* function,llvm::Type* returnType,const std::initializer_list<llvm::Value*>& args)
+		{
+			std::vector<llvm::Type*> argTypes;
+			for(auto arg : args) { argTypes.push_back(arg->getType()); }
+			auto functionType = llvm::FunctionType::get(returnType,argTypes,false);
+			auto functionPointer = llvm::Constant::getIntegerValue(functionType->getPointerTo(),llvm::APInt(64,reinterpret_cast<uintptr_t>(function)));
+			return irBuilder.CreateCall(functionPointer,llvm::ArrayRef<llvm::Value*>(args.begin(),args.end()));
+		}
+
+		// Traps if the condition is true.
+		void compileTrapIf(llvm::Value* condition,const char* name)
+		{
+			auto trapBlock = llvm::BasicBlock::Create(context,llvm::Twine(name) + "Trap",llvmFunction);
+			auto continueBlock = llvm::BasicBlock::Create(context,llvm::Twine(name) + "Continue",llvmFunction);
+			compileCondBranch(condition,trapBlock,continueBlock);
+
+			irBuilder.SetInsertPoint(trapBlock);
+			irBuilder.CreateCall(getLLVMIntrinsic({},llvm::Intrinsic::trap));
+			irBuilder.CreateUnreachable();
+
+			irBuilder.SetInsertPoint(continueBlock);
+		}
+
+		// Returns a pointer to a global variable.
+		llvm::Value* getGlobalPointer(uintptr_t globalIndex)
+		{
+			if(!threadGlobals)
+			{
+				assert(globalIndex < jitModule.globalVariablePointers.size());
+				return jitModule.globalVariablePointers[globalIndex];
+			}
+			else
+			{
+				assert(globalIndex < astModule->globals.size());
+				auto bytePointer = irBuilder.CreateInBoundsGEP(threadGlobals,compileLiteral((uint64)(globalIndex * Runtime::threadGlobalSlotBytes)));
+				return irBuilder.CreatePointerCast(bytePointer,asLLVMType(astModule->globals[globalIndex].type)->getPointerTo());
+			}
+		}
+
 		DispatchResult compileAddress(Expression<IntClass>* address,bool isFarAddress,TypeId memoryType)
 		{
 			// If the address is 32-bits, zext it to 64-bits.
@@ -215,35 +292,38 @@ namespace LLVMJIT
 			auto byteIndex = isFarAddress ? dispatch(*this,address,TypeId::I64)
 				: irBuilder.CreateZExt(dispatch(*this,address,TypeId::I32),llvm::Type::getInt64Ty(context));
 
-			// Mask the index to the address-space size.
-			auto maskedByteIndex = irBuilder.CreateAnd(byteIndex,jitModule.instanceMemoryAddressMask);
-
-			// Cast the pointer to the appropriate type.
-			auto bytePointer = irBuilder.CreateInBoundsGEP(jitModule.instanceMemoryBase,maskedByteIndex);
+			// Mask the index to the instance's maximum memory size, rounded up to a power of two. vmSbrk never commits memory past the
+			// maximum, so an access past it faults, and the mask keeps the access within the address-space reserved for the instance.
+			// If the maximum is 4GB, LLVM removes the mask from 32-bit addresses. Otherwise, every access is masked: there's no analysis
+			// of induction variables or address ranges that would let the mask be hoisted out of a loop or removed.
+			static_assert(Runtime::instanceAddressSpaceReservedBytes >= (1ull << 32) + 16,"masked addresses must be within the reserved address-space");
+			return compileAddressPointer(irBuilder.CreateAnd(byteIndex,jitModule.instanceMemoryAddressMask),memoryType);
+		}
+		// Returns a typed pointer to the instance memory at a byte index, which must be within the address-space reserved for the instance.
+		DispatchResult compileAddressPointer(llvm::Value* byteIndex,TypeId memoryType)
+		{
+			auto bytePointer = irBuilder.CreateInBoundsGEP(jitModule.instanceMemoryBase,byteIndex);
 			return irBuilder.CreatePointerCast(bytePointer,asLLVMType(memoryType)->getPointerTo());
 		}
 
-		DispatchResult compileCall(const FunctionType& functionType,llvm::Value* function,UntypedExpression** args,bool isImport)
+		// Compiles the parameter values for a call. Calls to functions defined in the module have an extra signature argument if WITH_FUNCTION_PROLOGUE_CHECK is enabled,
+		// which is the FunctionType::id of the signature the caller expects, followed by the caller's thread globals if the module has them.
+		llvm::ArrayRef<llvm::Value*> compileCallArgs(const FunctionType* functionType,UntypedExpression** args,bool isImport)
 		{
-			if(WITH_FUNCTION_PROLOGUE_CHECK && !isImport)
-			{
-				// Compile the parameter values for the call.
-				auto llvmArgs = (llvm::Value**)alloca(sizeof(llvm::Value*) * (functionType.parameters.size() + 1));
-				llvmArgs[0] = compileLiteral((uint32)0);
-				for(size_t argIndex = 0;argIndex < functionType.parameters.size();++argIndex)
-					{ llvmArgs[argIndex + 1] = dispatch(*this,args[argIndex],functionType.parameters[argIndex]); }
-				// Create the call instruction.
-				return irBuilder.CreateCall(function,llvm::ArrayRef<llvm::Value*>(llvmArgs,functionType.parameters.size() + 1));
-			}
-			else
-			{
-				// Compile the parameter values for the call.
-				auto llvmArgs = (llvm::Value**)alloca(sizeof(llvm::Value*) * functionType.parameters.size());
-				for(size_t argIndex = 0;argIndex < functionType.parameters.size();++argIndex)
-					{ llvmArgs[argIndex] = dispatch(*this,args[argIndex],functionType.parameters[argIndex]); }
-				// Create the call instruction.
-				return irBuilder.CreateCall(function,llvm::ArrayRef<llvm::Value*>(llvmArgs,functionType.parameters.size()));
-			}
+			const bool hasSignatureArg = WITH_FUNCTION_PROLOGUE_CHECK && !isImport;
+			const bool hasThreadGlobalsArg = threadGlobals && !isImport;
+			size_t numExtraLLVMArgs = (hasSignatureArg ? 1 : 0) + (hasThreadGlobalsArg ? 1 : 0);
+			auto llvmArgs = new(scopedArena) llvm::Value*[functionType->parameters.size() + numExtraLLVMArgs];
+			if(hasSignatureArg) { llvmArgs[0] = compileLiteral((uint32)functionType->id); }
+			if(hasThreadGlobalsArg) { llvmArgs[hasSignatureArg ? 1 : 0] = threadGlobals; }
+			for(size_t argIndex = 0;argIndex < functionType->parameters.size();++argIndex)
+				{ llvmArgs[argIndex + numExtraLLVMArgs] = dispatch(*this,args[argIndex],functionType->parameters[argIndex]); }
+			return llvm::ArrayRef<llvm::Value*>(llvmArgs,functionType->parameters.size() + numExtraLLVMArgs);
+		}
+
+		DispatchResult compileCall(const FunctionType* functionType,llvm::Value* function,UntypedExpression** args,bool isImport)
+		{
+			return irBuilder.CreateCall(function,compileCallArgs(functionType,args,isImport));
 		}
 		
 		template<typename Type> DispatchResult visitLiteral(const Literal<Type>* literal) { return compileLiteral(literal->value); }
@@ -264,8 +344,9 @@ namespace LLVMJIT
 		}
 		DispatchResult visitGetVariable(TypeId type,const GetVariable* getVariable,OpTypes<AnyClass>::getGlobal)
 		{
-			assert(getVariable->variableIndex < jitModule.globalVariablePointers.size());
-			return irBuilder.CreateLoad(jitModule.globalVariablePointers[getVariable->variableIndex]);
+			auto load = irBuilder.CreateLoad(getGlobalPointer(getVariable->variableIndex));
+			load->setMetadata(llvm::LLVMContext::MD_tbaa,jitModule.globalTBAATags[getVariable->variableIndex]);
+			return load;
 		}
 		DispatchResult visitSetVariable(const SetVariable* setVariable,OpTypes<AnyClass>::setLocal)
 		{
@@ -276,41 +357,61 @@ namespace LLVMJIT
 		}
 		DispatchResult visitSetVariable(const SetVariable* setVariable,OpTypes<AnyClass>::setGlobal)
 		{
-			assert(setVariable->variableIndex < jitModule.globalVariablePointers.size());
 			auto value = dispatch(*this,setVariable->value,astModule->globals[setVariable->variableIndex].type);
-			irBuilder.CreateStore(value,jitModule.globalVariablePointers[setVariable->variableIndex]);
+			auto store = irBuilder.CreateStore(value,getGlobalPointer(setVariable->variableIndex));
+			store->setMetadata(llvm::LLVMContext::MD_tbaa,jitModule.globalTBAATags[setVariable->variableIndex]);
 			return value;
 		}
 
 		// Memory load/store
+		// The loads and stores are given the alignment the AST op declares for its address, so LLVM can use aligned vector instructions
+		// for them. The text format allows declaring more than the natural alignment of the memory type, but that can't make the access
+		// any faster, so the alignment is capped at the natural alignment.
+		static uint32 getMemoryOpAlignment(uint8 alignmentLog2,TypeId memoryType)
+		{
+			return 1u << std::min(alignmentLog2,getNaturalAlignmentLog2(memoryType));
+		}
+		template<typename Class>
+		llvm::Value* compileMemoryLoad(const Load<Class>* load)
+		{
+			auto memoryLoad = irBuilder.CreateAlignedLoad(compileAddress(load->address,load->isFarAddress,load->memoryType),getMemoryOpAlignment(load->alignmentLog2,load->memoryType));
+			memoryLoad->setMetadata(llvm::LLVMContext::MD_tbaa,instanceMemoryTBAATag);
+			return memoryLoad;
+		}
+		template<typename Class>
+		void compileMemoryStore(const Store<Class>* store,llvm::Value* memoryValue)
+		{
+			auto memoryStore = irBuilder.CreateAlignedStore(memoryValue,compileAddress(store->address,store->isFarAddress,store->memoryType),getMemoryOpAlignment(store->alignmentLog2,store->memoryType));
+			memoryStore->setMetadata(llvm::LLVMContext::MD_tbaa,instanceMemoryTBAATag);
+		}
 		template<typename Class>
 		DispatchResult visitLoad(TypeId type,const Load<Class>* load,typename OpTypes<AnyClass>::load)
 		{
 			assert(type == load->memoryType);
-			return irBuilder.CreateLoad(compileAddress(load->address,load->isFarAddress,load->memoryType));
+			return compileMemoryLoad(load);
 		}
 		DispatchResult visitLoad(TypeId type,const Load<IntClass>* load,OpTypes<AnyClass>::load)
 		{
-			auto memoryValue = irBuilder.CreateLoad(compileAddress(load->address,load->isFarAddress,load->memoryType));
+			auto memoryValue = compileMemoryLoad(load);
 			assert(isTypeClass(load->memoryType,TypeClassId::Int));
 			return type == load->memoryType ? memoryValue
 				: irBuilder.CreateTrunc(memoryValue,asLLVMType(type));
 		}
 		DispatchResult visitLoad(TypeId type,const Load<IntClass>* load,OpTypes<IntClass>::loadZExt)
 		{
-			auto memoryValue = irBuilder.CreateLoad(compileAddress(load->address,load->isFarAddress,load->memoryType));
+			auto memoryValue = compileMemoryLoad(load);
 			return irBuilder.CreateZExt(memoryValue,asLLVMType(type));
 		}
 		DispatchResult visitLoad(TypeId type,const Load<IntClass>* load,OpTypes<IntClass>::loadSExt)
 		{
-			auto memoryValue = irBuilder.CreateLoad(compileAddress(load->address,load->isFarAddress,load->memoryType));
+			auto memoryValue = compileMemoryLoad(load);
 			return irBuilder.CreateSExt(memoryValue,asLLVMType(type));
 		}
 		template<typename Class>
 		DispatchResult visitStore(const Store<Class>* store)
 		{
 			auto value = dispatch(*this,store->value);
-			irBuilder.CreateStore(value,compileAddress(store->address,store->isFarAddress,store->memoryType));
+			compileMemoryStore(store,value);
 			return value;
 		}
 		DispatchResult visitStore(const Store<IntClass>* store)
@@ -322,20 +423,20 @@ namespace LLVMJIT
 				assert(isTypeClass(store->memoryType,TypeClassId::Int));
 				memoryValue = irBuilder.CreateTrunc(value,asLLVMType(store->memoryType));
 			}
-			irBuilder.CreateStore(memoryValue,compileAddress(store->address,store->isFarAddress,store->memoryType));
+			compileMemoryStore(store,memoryValue);
 			return value;
 		}
 
 		DispatchResult visitCall(TypeId type,const Call* call,OpTypes<AnyClass>::callDirect)
 		{
 			auto astFunction = astModule->functions[call->functionIndex];
-			assert(astFunction->type.returnType == type);
+			assert(astFunction->type->returnType == type);
 			return compileCall(astFunction->type,jitModule.functions[call->functionIndex],call->parameters,false);
 		}
 		DispatchResult visitCall(TypeId type,const Call* call,OpTypes<AnyClass>::callImport)
 		{
 			auto astFunctionImport = astModule->functionImports[call->functionIndex];
-			assert(astFunctionImport.type.returnType == type);
+			assert(astFunctionImport.type->returnType == type);
 			auto function = jitModule.functionImportPointers[call->functionIndex];
 			return compileCall(astFunctionImport.type,function,call->parameters,true);
 		}
@@ -344,13 +445,26 @@ namespace LLVMJIT
 			assert(callIndirect->tableIndex < astModule->functionTables.size());
 			auto functionTablePointer = jitModule.functionTablePointers[callIndirect->tableIndex];
 			auto astFunctionTable = astModule->functionTables[callIndirect->tableIndex];
-			assert(astFunctionTable.type.returnType == type);
+			auto& callTargets = jitModule.functionTableCallTargets[callIndirect->tableIndex];
+			assert(astFunctionTable.type->returnType == type);
 			assert(astFunctionTable.numFunctions > 0);
 
 			// Compile the function index and mask it to be within the function table's bounds (which are already verified to be 2^N).
 			auto functionIndex = dispatch(*this,callIndirect->functionIndex,TypeId::I32);
 			auto functionIndexMask = compileLiteral((uint32)astFunctionTable.numFunctions-1);
 			auto maskedFunctionIndex = irBuilder.CreateAnd(functionIndex,functionIndexMask);
+			auto llvmArgs = compileCallArgs(astFunctionTable.type,callIndirect->parameters,false);
+
+			// The function tables can't be changed after the module is compiled, so if the call can only reach a few different functions,
+			// call them directly. That avoids the load and prefix check, and lets LLVM inline the functions into the caller.
+			if(auto constantFunctionIndex = llvm::dyn_cast<llvm::ConstantInt>(maskedFunctionIndex))
+			{
+				auto calleeIndex = astFunctionTable.functionIndices[constantFunctionIndex->getZExtValue()];
+				return irBuilder.CreateCall(jitModule.functions[calleeIndex],llvmArgs);
+			}
+			else if(callTargets.size() == 1) { return irBuilder.CreateCall(jitModule.functions[callTargets[0]],llvmArgs); }
+			else if(callTargets.size() > 1 && irBuilder.GetInsertBlock() != unreachableBlock)
+			{ return compileDevirtualizedCallIndirect(type,astFunctionTable,callTargets,maskedFunctionIndex,llvmArgs); }
 
 			// Get a pointer to the function pointer in the function table using the masked function index.
 			llvm::Value* gepIndices[2] = {compileLiteral((uint32)0),maskedFunctionIndex};
@@ -359,11 +473,11 @@ namespace LLVMJIT
 			auto function = irBuilder.CreateLoad(irBuilder.CreateInBoundsGEP(functionTablePointer,gepIndices));
 
 			#if WITH_FUNCTION_PREFIX_CHECK
-				// Look up an I32 prefix stored with the function, and if it's not zero, call a random function of the right type instead.
+				// Look up the FunctionType::id stored in the I32 prefix of the function, and if it's not the table's signature, call a function of the right type instead.
 				auto prefixPointer = irBuilder.CreateBitCast(function,llvm::Type::getInt32Ty(context)->getPointerTo());
-				auto functionType = irBuilder.CreateLoad(irBuilder.CreateInBoundsGEP(prefixPointer,{compileLiteral((uint64)-1)}));
+				auto functionTypeId = irBuilder.CreateLoad(irBuilder.CreateInBoundsGEP(prefixPointer,{compileLiteral((uint64)-1)}));
 				auto safeFunction = irBuilder.CreateSelect(
-					irBuilder.CreateICmpEQ(functionType,compileLiteral((uint32)0)),
+					irBuilder.CreateICmpEQ(functionTypeId,compileLiteral((uint32)astFunctionTable.type->id)),
 					function,
 					jitModule.functions[astFunctionTable.functionIndices[0]]
 					);
@@ -371,7 +485,52 @@ namespace LLVMJIT
 				auto safeFunction = function;
 			#endif
 
-			return compileCall(astFunctionTable.type,safeFunction,callIndirect->parameters,false);
+			return irBuilder.CreateCall(safeFunction,llvmArgs);
+		}
+
+		// Compiles a call through a function table that only contains the given functions as a switch on the masked function index,
+		// with a direct call to each function. The first function is the most common in the table, so it is the switch's default.
+		DispatchResult compileDevirtualizedCallIndirect(
+			TypeId type,
+			const FunctionTable& astFunctionTable,
+			const std::vector<uintptr_t>& callTargets,
+			llvm::Value* maskedFunctionIndex,
+			llvm::ArrayRef<llvm::Value*> llvmArgs
+			)
+		{
+			auto targetBlocks = new(scopedArena) llvm::BasicBlock*[callTargets.size()];
+			for(uintptr_t targetIndex = 0;targetIndex < callTargets.size();++targetIndex)
+			{ targetBlocks[targetIndex] = llvm::BasicBlock::Create(context,"callIndirectTarget",llvmFunction); }
+			auto successorBlock = llvm::BasicBlock::Create(context,"callIndirectSucc",llvmFunction);
+
+			// Branch to the block for the function in each element of the table that doesn't contain the default function.
+			auto switchInstruction = irBuilder.CreateSwitch(maskedFunctionIndex,targetBlocks[0]);
+			for(uint32 elementIndex = 0;elementIndex < astFunctionTable.numFunctions;++elementIndex)
+			{
+				for(uintptr_t targetIndex = 1;targetIndex < callTargets.size();++targetIndex)
+				{
+					if(astFunctionTable.functionIndices[elementIndex] == callTargets[targetIndex])
+					{ switchInstruction->addCase(compileLiteral(elementIndex),targetBlocks[targetIndex]); break; }
+				}
+			}
+
+			// Call each function, and merge the results with a phi node.
+			auto results = new(scopedArena) llvm::Value*[callTargets.size()];
+			for(uintptr_t targetIndex = 0;targetIndex < callTargets.size();++targetIndex)
+			{
+				irBuilder.SetInsertPoint(targetBlocks[targetIndex]);
+				results[targetIndex] = irBuilder.CreateCall(jitModule.functions[callTargets[targetIndex]],llvmArgs);
+				compileBranch(successorBlock);
+			}
+
+			irBuilder.SetInsertPoint(successorBlock);
+			if(type == TypeId::Void) { return voidDummy; }
+			else
+			{
+				auto phi = irBuilder.CreatePHI(asLLVMType(type),(uint32)callTargets.size());
+				for(uintptr_t targetIndex = 0;targetIndex < callTargets.size();++targetIndex) { phi->addIncoming(results[targetIndex],targetBlocks[targetIndex]); }
+				return phi;
+			}
 		}
 		
 		template<typename Class>
@@ -518,12 +677,12 @@ namespace LLVMJIT
 		template<typename Class>
 		DispatchResult visitReturn(TypeId type,const Return<Class>* ret)
 		{
-			auto returnValue = astFunction->type.returnType == TypeId::Void ? nullptr
-				: dispatch(*this,ret->value,astFunction->type.returnType);
+			auto returnValue = astFunction->type->returnType == TypeId::Void ? nullptr
+				: dispatch(*this,ret->value,astFunction->type->returnType);
 
 			if(irBuilder.GetInsertBlock() != unreachableBlock)
 			{
-				if(astFunction->type.returnType == TypeId::Void) { irBuilder.CreateRetVoid(); }
+				if(astFunction->type->returnType == TypeId::Void) { irBuilder.CreateRetVoid(); }
 				else { irBuilder.CreateRet(returnValue); }
 			
 				// Set the insert point to the unreachable block.
@@ -596,6 +755,92 @@ namespace LLVMJIT
 			dispatch(*this,discardResult->expression);
 			return voidDummy;
 		}
+		DispatchResult visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			// Zext the 32-bit operands to 64-bits, so adding the number of bytes to an address can't overflow.
+			auto destAddress = irBuilder.CreateZExt(dispatch(*this,bulkMemory->destAddress,TypeId::I32),llvm::Type::getInt64Ty(context));
+			auto source = dispatch(*this,bulkMemory->source,TypeId::I32);
+			auto numBytes = irBuilder.CreateZExt(dispatch(*this,bulkMemory->numBytes,TypeId::I32),llvm::Type::getInt64Ty(context));
+
+			// Check once that the whole range (and the source range for copies and moves) is within the instance's maximum memory size.
+			// Unlike the single access compiled by compileAddress, the range can extend past the address-space reserved for the
+			// instance, and it can't be masked, since the range would wrap around the end of the address space.
+			auto addressSpaceMaxBytes = compileLiteral((uint64)Runtime::instanceAddressSpaceMaxBytes);
+			auto isOutOfBounds = irBuilder.CreateICmpUGT(irBuilder.CreateAdd(destAddress,numBytes),addressSpaceMaxBytes);
+			llvm::Value* sourceAddress = nullptr;
+			if(bulkMemory->op() != VoidOp::fillMemory)
+			{
+				sourceAddress = irBuilder.CreateZExt(source,llvm::Type::getInt64Ty(context));
+				isOutOfBounds = irBuilder.CreateOr(isOutOfBounds,irBuilder.CreateICmpUGT(irBuilder.CreateAdd(sourceAddress,numBytes),addressSpaceMaxBytes));
+			}
+
+			compileTrapIf(isOutOfBounds,"bulkMemoryOutOfBounds");
+
+			// Lower the operation to a LLVM memcpy/memmove/memset intrinsic, which LLVM will turn into an inline sequence of
+			// vector moves for small constant sizes, or a call to the host's optimized C library implementation.
+			auto destPointer = irBuilder.CreateInBoundsGEP(jitModule.instanceMemoryBase,destAddress);
+			switch(bulkMemory->op())
+			{
+			case VoidOp::copyMemory: irBuilder.CreateMemCpy(destPointer,irBuilder.CreateInBoundsGEP(jitModule.instanceMemoryBase,sourceAddress),numBytes,1,false,instanceMemoryTBAATag); break;
+			case VoidOp::moveMemory: irBuilder.CreateMemMove(destPointer,irBuilder.CreateInBoundsGEP(jitModule.instanceMemoryBase,sourceAddress),numBytes,1,false,instanceMemoryTBAATag); break;
+			case VoidOp::fillMemory: irBuilder.CreateMemSet(destPointer,irBuilder.CreateTrunc(source,llvm::Type::getInt8Ty(context)),numBytes,1,false,instanceMemoryTBAATag); break;
+			default: throw;
+			}
+			return voidDummy;
+		}
+
+		template<typename OpAsType>
+		DispatchResult visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			auto op = atomic->op();
+			auto memoryType = Atomic::getOperandType(op,type);
+			auto address = dispatch(*this,atomic->address,TypeId::I32);
+			auto operand = atomic->operand ? dispatch(*this,atomic->operand,memoryType) : nullptr;
+			auto replacement = atomic->replacement ? dispatch(*this,atomic->replacement,Atomic::getReplacementType(op,type)) : nullptr;
+
+			// Waiting and notifying are implemented by the runtime, which checks the address itself.
+			if(op == IntOp::atomicWait) { return compileRuntimeCall((void*)&Runtime::atomicWait,asLLVMType(TypeId::I32),{address,operand,replacement}); }
+			else if(op == IntOp::atomicNotify) { return compileRuntimeCall((void*)&Runtime::atomicNotify,asLLVMType(TypeId::I32),{address,operand}); }
+
+			// Atomic accesses must be naturally aligned, so they can't straddle a cache line or page.
+			const uint32 numBytes = (uint32)getTypeBitWidth(memoryType) / 8;
+			auto isMisaligned = irBuilder.CreateICmpNE(irBuilder.CreateAnd(address,compileLiteral(numBytes - 1)),compileLiteral((uint32)0));
+			compileTrapIf(isMisaligned,"atomicMisaligned");
+			auto pointer = compileAddressPointer(irBuilder.CreateZExt(address,llvm::Type::getInt64Ty(context)),memoryType);
+
+			switch(op)
+			{
+			case IntOp::atomicLoad:
+			{
+				auto load = irBuilder.CreateLoad(pointer);
+				load->setAlignment(numBytes);
+				load->setAtomic(llvm::SequentiallyConsistent);
+				load->setMetadata(llvm::LLVMContext::MD_tbaa,instanceMemoryTBAATag);
+				return load;
+			}
+			case IntOp::atomicStore:
+			{
+				auto store = irBuilder.CreateStore(operand,pointer);
+				store->setAlignment(numBytes);
+				store->setAtomic(llvm::SequentiallyConsistent);
+				store->setMetadata(llvm::LLVMContext::MD_tbaa,instanceMemoryTBAATag);
+				return operand;
+			}
+			case IntOp::atomicAdd: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::Add,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicSub: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::Sub,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicAnd: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::And,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicOr: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::Or,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicXor: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::Xor,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicExchange: return irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::Xchg,pointer,operand,llvm::SequentiallyConsistent);
+			case IntOp::atomicCompareExchange:
+			{
+				// cmpxchg results in {old value,success}; the AST op only results in the old value.
+				auto result = irBuilder.CreateAtomicCmpXchg(pointer,operand,replacement,llvm::SequentiallyConsistent,llvm::SequentiallyConsistent);
+				return irBuilder.CreateExtractValue(result,0);
+			}
+			default: throw;
+			}
+		}
 		
 		DispatchResult compileIntrinsic(llvm::Intrinsic::ID intrinsicId,llvm::Value* firstOperand)
 		{
@@ -714,10 +959,97 @@ namespace LLVMJIT
 		IMPLEMENT_COMPARE_OP(ges,irBuilder.CreateICmpSGE(left,right))
 		IMPLEMENT_COMPARE_OP(geu,irBuilder.CreateICmpUGE(left,right))
 
+		IMPLEMENT_UNARY_OP(V128Class,bitwiseNot,irBuilder.CreateNot(operand))
+		IMPLEMENT_BINARY_OP(V128Class,bitwiseAnd,irBuilder.CreateAnd(left,right))
+		IMPLEMENT_BINARY_OP(V128Class,bitwiseOr,irBuilder.CreateOr(left,right))
+		IMPLEMENT_BINARY_OP(V128Class,bitwiseXor,irBuilder.CreateXor(left,right))
+
 		#undef IMPLEMENT_UNARY_OP
 		#undef IMPLEMENT_BINARY_OP
 		#undef IMPLEMENT_CAST_OP
 		#undef IMPLEMENT_COMPARE_OP
+
+		// V128 values are represented as <2 x i64>, and are bitcast to a vector of the lane type for lane-wise operations.
+		llvm::Value* compileLanes(llvm::Value* vector,TypeId laneType)
+		{
+			return irBuilder.CreateBitCast(vector,llvm::VectorType::get(asLLVMType(laneType),(unsigned)getNumV128Lanes(laneType)));
+		}
+		llvm::Value* compileV128(llvm::Value* lanes) { return irBuilder.CreateBitCast(lanes,asLLVMType(TypeId::V128)); }
+
+		template<typename OpAsType> DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpAsType);
+		template<typename OpAsType> DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpAsType);
+
+		#define IMPLEMENT_LANE_UNARY_OP(op,intOp,floatOp) \
+			DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpTypes<V128Class>::op) \
+			{ \
+				auto operand = compileLanes(dispatch(*this,laneUnary->operand),laneUnary->laneType); \
+				return compileV128(isTypeClass(laneUnary->laneType,TypeClassId::Float) ? (floatOp) : (intOp)); \
+			}
+		#define IMPLEMENT_LANE_BINARY_OP(op,intOp,floatOp) \
+			DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpTypes<V128Class>::op) \
+			{ \
+				auto left = compileLanes(dispatch(*this,laneBinary->left),laneBinary->laneType); \
+				auto right = compileLanes(dispatch(*this,laneBinary->right),laneBinary->laneType); \
+				return compileV128(isTypeClass(laneBinary->laneType,TypeClassId::Float) ? (floatOp) : (intOp)); \
+			}
+		#define IMPLEMENT_FLOAT_LANE_UNARY_OP(op,floatOp) \
+			DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpTypes<V128Class>::op) \
+			{ \
+				assert(isTypeClass(laneUnary->laneType,TypeClassId::Float)); \
+				auto operand = compileLanes(dispatch(*this,laneUnary->operand),laneUnary->laneType); \
+				return compileV128(floatOp); \
+			}
+		#define IMPLEMENT_FLOAT_LANE_BINARY_OP(op,floatOp) \
+			DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpTypes<V128Class>::op) \
+			{ \
+				assert(isTypeClass(laneBinary->laneType,TypeClassId::Float)); \
+				auto left = compileLanes(dispatch(*this,laneBinary->left),laneBinary->laneType); \
+				auto right = compileLanes(dispatch(*this,laneBinary->right),laneBinary->laneType); \
+				return compileV128(floatOp); \
+			}
+
+		IMPLEMENT_LANE_UNARY_OP(neg,irBuilder.CreateNeg(operand),irBuilder.CreateFNeg(operand))
+		IMPLEMENT_LANE_UNARY_OP(abs,compileIntAbs(operand),compileIntrinsic(llvm::Intrinsic::fabs,operand))
+		IMPLEMENT_FLOAT_LANE_UNARY_OP(sqrt,compileIntrinsic(llvm::Intrinsic::sqrt,operand))
+		IMPLEMENT_LANE_BINARY_OP(add,irBuilder.CreateAdd(left,right),irBuilder.CreateFAdd(left,right))
+		IMPLEMENT_LANE_BINARY_OP(sub,irBuilder.CreateSub(left,right),irBuilder.CreateFSub(left,right))
+		IMPLEMENT_LANE_BINARY_OP(mul,irBuilder.CreateMul(left,right),irBuilder.CreateFMul(left,right))
+		IMPLEMENT_FLOAT_LANE_BINARY_OP(div,irBuilder.CreateFDiv(left,right))
+		IMPLEMENT_FLOAT_LANE_BINARY_OP(min,compileIntrinsic(llvm::Intrinsic::minnum,left,right))
+		IMPLEMENT_FLOAT_LANE_BINARY_OP(max,compileIntrinsic(llvm::Intrinsic::maxnum,left,right))
+
+		#undef IMPLEMENT_LANE_UNARY_OP
+		#undef IMPLEMENT_LANE_BINARY_OP
+		#undef IMPLEMENT_FLOAT_LANE_UNARY_OP
+		#undef IMPLEMENT_FLOAT_LANE_BINARY_OP
+
+		DispatchResult visitSplat(const Splat* splat)
+		{
+			auto scalar = dispatch(*this,splat->scalar);
+			return compileV128(irBuilder.CreateVectorSplat((unsigned)getNumV128Lanes(splat->scalar.type),scalar));
+		}
+		template<typename Class>
+		DispatchResult visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane)
+		{
+			auto lanes = compileLanes(dispatch(*this,extractLane->vector),type);
+			return irBuilder.CreateExtractElement(lanes,compileLiteral((uint32)extractLane->laneIndex));
+		}
+		DispatchResult visitReplaceLane(const ReplaceLane* replaceLane)
+		{
+			auto lanes = compileLanes(dispatch(*this,replaceLane->vector),replaceLane->scalar.type);
+			auto scalar = dispatch(*this,replaceLane->scalar);
+			return compileV128(irBuilder.CreateInsertElement(lanes,scalar,compileLiteral((uint32)replaceLane->laneIndex)));
+		}
+		DispatchResult visitShuffle(const Shuffle* shuffle)
+		{
+			auto left = compileLanes(dispatch(*this,shuffle->left),shuffle->laneType);
+			auto right = compileLanes(dispatch(*this,shuffle->right),shuffle->laneType);
+			auto numLanes = getNumV128Lanes(shuffle->laneType);
+			auto mask = (llvm::Constant**)alloca(sizeof(llvm::Constant*) * numLanes);
+			for(uintptr_t laneIndex = 0;laneIndex < numLanes;++laneIndex) { mask[laneIndex] = compileLiteral((uint32)shuffle->laneIndices[laneIndex]); }
+			auto maskVector = llvm::ConstantVector::get(llvm::ArrayRef<llvm::Constant*>(mask,numLanes));
+			return compileV128(irBuilder.CreateShuffleVector(left,right,maskVector));
+		}
 	};
 
 
@@ -746,7 +1078,7 @@ namespace LLVMJIT
 		// Create an initial basic block for the function.
 		auto entryBasicBlock = llvm::BasicBlock::Create(context,"entry",llvmFunction);
 		irBuilder.SetInsertPoint(entryBasicBlock);
-		
+
 		// Create allocas for all the locals and initialize them to zero.
 		localVariablePointers = new(scopedArena) llvm::Value*[astFunction->locals.size()];
 		for(uintptr_t localIndex = 0;localIndex < astFunction->locals.size();++localIndex)
@@ -761,6 +1093,7 @@ namespace LLVMJIT
 			case TypeId::I64: irBuilder.CreateStore(compileLiteral((uint64)0),localVariablePointers[localIndex]); break;
 			case TypeId::F32: irBuilder.CreateStore(compileLiteral((float32)0.0f),localVariablePointers[localIndex]); break;
 			case TypeId::F64: irBuilder.CreateStore(compileLiteral((float64)0.0),localVariablePointers[localIndex]); break;
+			case TypeId::V128: irBuilder.CreateStore(typedZeroConstants[(size_t)TypeId::V128],localVariablePointers[localIndex]); break;
 			case TypeId::Bool: irBuilder.CreateStore(compileLiteral((bool)false),localVariablePointers[localIndex]); break;
 			default: throw;
 			}
@@ -773,6 +1106,11 @@ namespace LLVMJIT
 		{
 			++llvmArgIt;
 		}
+		if(jitModule.hasThreadGlobals)
+		{
+			threadGlobals = &*llvmArgIt;
+			++llvmArgIt;
+		}
 		for(;llvmArgIt != llvmFunction->arg_end();++parameterIndex,++llvmArgIt)
 		{
 			auto localIndex = astFunction->parameterLocalIndices[parameterIndex];
@@ -784,7 +1122,7 @@ namespace LLVMJIT
 			auto signatureCheckFailBlock = llvm::BasicBlock::Create(context,"signatureCheckFail",llvmFunction);
 			auto signatureCheckSuccBlock = llvm::BasicBlock::Create(context,"signatureCheckSucc",llvmFunction);
 			irBuilder.CreateCondBr(
-				irBuilder.CreateICmpEQ(llvmFunction->arg_begin(),compileLiteral((uint32)0)),
+				irBuilder.CreateICmpEQ(llvmFunction->arg_begin(),compileLiteral((uint32)astFunction->type->id)),
 				signatureCheckSuccBlock,
 				signatureCheckFailBlock
 				);
@@ -797,12 +1135,12 @@ namespace LLVMJIT
 		}
 
 		// Traverse the function's expressions.
-		auto value = dispatch(*this,astFunction->expression,astFunction->type.returnType);
+		auto value = dispatch(*this,astFunction->expression,astFunction->type->returnType);
 
 		// If the final value of the function is reachable, return it.
 		if(irBuilder.GetInsertBlock() != unreachableBlock)
 		{
-			if(astFunction->type.returnType == TypeId::Void) { irBuilder.CreateRetVoid(); }
+			if(astFunction->type->returnType == TypeId::Void) { irBuilder.CreateRetVoid(); }
 			else { irBuilder.CreateRet(value); }
 		}
 
@@ -810,6 +1148,27 @@ namespace LLVMJIT
 		unreachableBlock->eraseFromParent();
 		unreachableBlock = nullptr;
 	}
+
+	// Creates the function that a module with thread globals exports for one of its functions. It looks up the calling thread's globals,
+	// and passes them to the function along with the host's arguments.
+	static void compileExportThunk(JITModule& jitModule,uintptr_t functionIndex,const char* exportName)
+	{
+		auto astFunction = jitModule.astModule->functions[functionIndex];
+		auto thunk = llvm::Function::Create(asLLVMType(astFunction->type,false,false),llvm::Function::ExternalLinkage,exportName,jitModule.llvmModule);
+		llvm::IRBuilder<> irBuilder(context);
+		irBuilder.SetInsertPoint(llvm::BasicBlock::Create(context,"entry",thunk));
+
+		auto getThreadGlobalsType = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(context),false);
+		auto getThreadGlobalsPointer = llvm::Constant::getIntegerValue(getThreadGlobalsType->getPointerTo(),llvm::APInt(64,reinterpret_cast<uintptr_t>(&Runtime::getThreadGlobals)));
+		std::vector<llvm::Value*> llvmArgs;
+		if(WITH_FUNCTION_PROLOGUE_CHECK) { llvmArgs.push_back(compileLiteral((uint32)astFunction->type->id)); }
+		llvmArgs.push_back(irBuilder.CreateCall(getThreadGlobalsPointer));
+		for(auto llvmArgIt = thunk->arg_begin();llvmArgIt != thunk->arg_end();++llvmArgIt) { llvmArgs.push_back(&*llvmArgIt); }
+
+		auto result = irBuilder.CreateCall(jitModule.functions[functionIndex],llvmArgs);
+		if(astFunction->type->returnType == TypeId::Void) { irBuilder.CreateRetVoid(); }
+		else { irBuilder.CreateRet(result); }
+	}
 	
 	static void init()
 	{
@@ -826,6 +1185,7 @@ namespace LLVMJIT
 		llvmTypesByTypeId[(size_t)TypeId::I64] = llvm::Type::getInt64Ty(context);
 		llvmTypesByTypeId[(size_t)TypeId::F32] = llvm::Type::getFloatTy(context);
 		llvmTypesByTypeId[(size_t)TypeId::F64] = llvm::Type::getDoubleTy(context);
+		llvmTypesByTypeId[(size_t)TypeId::V128] = llvm::VectorType::get(llvm::Type::getInt64Ty(context),2);
 		llvmTypesByTypeId[(size_t)TypeId::Bool] = llvm::Type::getInt1Ty(context);
 		llvmTypesByTypeId[(size_t)TypeId::Void] = llvm::Type::getVoidTy(context);
 		
@@ -840,8 +1200,17 @@ namespace LLVMJIT
 		typedZeroConstants[(size_t)TypeId::I64] = compileLiteral((uint64)0);
 		typedZeroConstants[(size_t)TypeId::F32] = compileLiteral((float32)0.0f);
 		typedZeroConstants[(size_t)TypeId::F64] = compileLiteral((float64)0.0);
+		typedZeroConstants[(size_t)TypeId::V128] = llvm::ConstantAggregateZero::get(asLLVMType(TypeId::V128));
 		typedZeroConstants[(size_t)TypeId::Bool] = compileLiteral(false);
 		typedZeroConstants[(size_t)TypeId::Void] = voidDummy;
+
+		// Create the TBAA tags, which all have the same root so they are known not to alias each other.
+		llvm::MDBuilder mdBuilder(context);
+		auto tbaaRoot = mdBuilder.createTBAARoot("WAVM TBAA root");
+		auto createTBAATag = [&](const char* name) { auto typeNode = mdBuilder.createTBAAScalarTypeNode(name,tbaaRoot); return mdBuilder.createTBAAStructTagNode(typeNode,typeNode,0); };
+		instanceMemoryTBAATag = createTBAATag("instance memory");
+		globalTBAATag = createTBAATag("global");
+		importedGlobalTBAATag = createTBAATag("imported global");
 	}
 
 	bool compileModule(const Module* astModule)
@@ -858,57 +1227,67 @@ namespace LLVMJIT
 
 		// Create literals for the virtual memory base and mask.
 		jitModule->instanceMemoryBase = llvm::Constant::getIntegerValue(llvm::Type::getInt8PtrTy(context),llvm::APInt(64,reinterpret_cast<uintptr_t>(Runtime::instanceMemoryBase)));
-		auto instanceMemoryAddressMask = Runtime::instanceAddressSpaceMaxBytes - 1;
+		uint64 instanceMemoryAddressMask = 0;
+		while(instanceMemoryAddressMask + 1 < Runtime::instanceAddressSpaceMaxBytes) { instanceMemoryAddressMask = (instanceMemoryAddressMask << 1) | 1; }
 		jitModule->instanceMemoryAddressMask = sizeof(uintptr_t) == 8 ? compileLiteral((uint64)instanceMemoryAddressMask) : compileLiteral((uint32)instanceMemoryAddressMask);
 		
-		// Build a reverse map from function index to export.
-		std::map<uintptr_t,const char*> functionIndexToExportNameMap;
-		for(auto exportIt : astModule->exportNameToFunctionIndexMap)
+		// If the module imports pthread_create, each thread needs its own copy of the module's global variables (e.g. the stack pointer),
+		// so they are stored in per-thread memory instead of LLVM global variables.
+		for(auto& functionImport : astModule->functionImports)
 		{
-			assert(exportIt.second < astModule->functions.size());
-			functionIndexToExportNameMap[exportIt.second] = exportIt.first;
+			if(!strcmp(functionImport.name,"_pthread_create")) { jitModule->hasThreadGlobals = true; }
 		}
 
-		// Create the LLVM functions.
+		// Create the LLVM functions. If the module has thread globals, the host calls an exported function through a thunk instead.
 		jitModule->functions.resize(astModule->functions.size());
 		for(uintptr_t functionIndex = 0;functionIndex < astModule->functions.size();++functionIndex)
 		{
 			auto astFunction = astModule->functions[functionIndex];
-			auto exportIt = functionIndexToExportNameMap.find(functionIndex);
-			bool isExported = exportIt != functionIndexToExportNameMap.end();
-			auto functionName = isExported ? llvm::Twine(exportIt->second) : getLLVMName(astFunction->name);
-			auto linkage = isExported ? llvm::Function::ExternalLinkage : llvm::Function::PrivateLinkage;
-			auto llvmFunctionType = asLLVMType(astFunction->type,WITH_FUNCTION_PROLOGUE_CHECK && !isExported);
+			auto exportName = astModule->exports.getExportName(functionIndex);
+			bool isHostCallable = exportName != nullptr && !jitModule->hasThreadGlobals;
+
+			// An exported function's thunk takes its export name, so leave the function unnamed in case its name would conflict with it.
+			auto functionName = isHostCallable ? llvm::Twine(exportName) : exportName ? llvm::Twine() : getLLVMName(astFunction->name);
+			auto linkage = isHostCallable ? llvm::Function::ExternalLinkage : llvm::Function::PrivateLinkage;
+			auto llvmFunctionType = asLLVMType(astFunction->type,WITH_FUNCTION_PROLOGUE_CHECK && !isHostCallable,jitModule->hasThreadGlobals);
 			jitModule->functions[functionIndex] = llvm::Function::Create(llvmFunctionType,linkage,functionName,jitModule->llvmModule);
 			#if WITH_FUNCTION_PREFIX_CHECK
-				jitModule->functions[functionIndex]->setPrefixData(compileLiteral((uint32)0));
+				jitModule->functions[functionIndex]->setPrefixData(compileLiteral((uint32)astFunction->type->id));
 			#endif
+			if(exportName && !isHostCallable) { compileExportThunk(*jitModule,functionIndex,exportName); }
 		}
 
-		// Create the global variables.
-		jitModule->globalVariablePointers.resize(astModule->globals.size());
-		for(uintptr_t importIndex = 0;importIndex < jitModule->globalVariablePointers.size();++importIndex)
+		if(!jitModule->hasThreadGlobals)
 		{
-			auto globalVariable = astModule->globals[importIndex];
-			llvm::Constant* initializer = typedZeroConstants[(size_t)globalVariable.type];
-			jitModule->globalVariablePointers[importIndex] = new llvm::GlobalVariable(*jitModule->llvmModule,asLLVMType(globalVariable.type),false,llvm::GlobalValue::PrivateLinkage,initializer,getLLVMName(globalVariable.name));
-		}
+			// Create the global variables.
+			jitModule->globalVariablePointers.resize(astModule->globals.size());
+			for(uintptr_t importIndex = 0;importIndex < jitModule->globalVariablePointers.size();++importIndex)
+			{
+				auto globalVariable = astModule->globals[importIndex];
+				llvm::Constant* initializer = typedZeroConstants[(size_t)globalVariable.type];
+				jitModule->globalVariablePointers[importIndex] = new llvm::GlobalVariable(*jitModule->llvmModule,asLLVMType(globalVariable.type),false,llvm::GlobalValue::PrivateLinkage,initializer,getLLVMName(globalVariable.name));
+			}
 		
-		// Set imported global variables to have external linkage and give them the unmangled import name.
-		for(uintptr_t variableImportIndex = 0;variableImportIndex < astModule->variableImports.size();++variableImportIndex)
-		{
-			auto variableImport = astModule->variableImports[variableImportIndex];
-			jitModule->globalVariablePointers[variableImport.globalIndex]->setName(variableImport.name);
-			jitModule->globalVariablePointers[variableImport.globalIndex]->setLinkage(llvm::GlobalValue::ExternalLinkage);
-			jitModule->globalVariablePointers[variableImport.globalIndex]->setInitializer(nullptr);
+			// Set imported global variables to have external linkage and give them the unmangled import name.
+			for(uintptr_t variableImportIndex = 0;variableImportIndex < astModule->variableImports.size();++variableImportIndex)
+			{
+				auto variableImport = astModule->variableImports[variableImportIndex];
+				jitModule->globalVariablePointers[variableImport.globalIndex]->setName(variableImport.name);
+				jitModule->globalVariablePointers[variableImport.globalIndex]->setLinkage(llvm::GlobalValue::ExternalLinkage);
+				jitModule->globalVariablePointers[variableImport.globalIndex]->setInitializer(nullptr);
+			}
 		}
 
+		// Imported global variables use a different TBAA tag, since they are the host's memory instead of the module's.
+		jitModule->globalTBAATags.assign(astModule->globals.size(),globalTBAATag);
+		for(auto& variableImport : astModule->variableImports) { jitModule->globalTBAATags[variableImport.globalIndex] = importedGlobalTBAATag; }
+
 		// Create the function import globals.
 		jitModule->functionImportPointers.resize(astModule->functionImports.size());
 		for(uintptr_t importIndex = 0;importIndex < jitModule->functionImportPointers.size();++importIndex)
 		{
 			auto functionImport = astModule->functionImports[importIndex];
-			jitModule->functionImportPointers[importIndex] = new llvm::GlobalVariable(*jitModule->llvmModule,asLLVMType(functionImport.type,false),true,llvm::GlobalValue::ExternalLinkage,nullptr,functionImport.name);
+			jitModule->functionImportPointers[importIndex] = new llvm::GlobalVariable(*jitModule->llvmModule,asLLVMType(functionImport.type,false,false),true,llvm::GlobalValue::ExternalLinkage,nullptr,functionImport.name);
 		}
 
 		// Create the function table globals.
@@ -927,14 +1306,37 @@ namespace LLVMJIT
 			assert((astFunctionTable.numFunctions & (astFunctionTable.numFunctions-1)) == 0);
 
 			// Create a LLVM global variable that holds the array of function pointers.
-			auto llvmFunctionTablePointerType = llvm::ArrayType::get(asLLVMType(astFunctionTable.type,WITH_FUNCTION_PROLOGUE_CHECK)->getPointerTo(),llvmFunctionTableElements.size());
+			// It has external linkage so getFunctionTableElement can look it up by name.
+			auto llvmFunctionTablePointerType = llvm::ArrayType::get(asLLVMType(astFunctionTable.type,WITH_FUNCTION_PROLOGUE_CHECK,jitModule->hasThreadGlobals)->getPointerTo(),llvmFunctionTableElements.size());
 			auto llvmFunctionTablePointer = new llvm::GlobalVariable(
-				*jitModule->llvmModule,llvmFunctionTablePointerType,true,llvm::GlobalValue::PrivateLinkage,
-				llvm::ConstantArray::get(llvmFunctionTablePointerType,llvmFunctionTableElements)
+				*jitModule->llvmModule,llvmFunctionTablePointerType,true,llvm::GlobalValue::ExternalLinkage,
+				llvm::ConstantArray::get(llvmFunctionTablePointerType,llvmFunctionTableElements),
+				getFunctionTableName(tableIndex)
 				);
 			jitModule->functionTablePointers[tableIndex] = llvmFunctionTablePointer;
 		}
 
+		// Find the function tables that only contain a few different functions, and count how many elements of the table contain each function.
+		jitModule->functionTableCallTargets.resize(astModule->functionTables.size());
+		for(uintptr_t tableIndex = 0;tableIndex < astModule->functionTables.size();++tableIndex)
+		{
+			auto astFunctionTable = astModule->functionTables[tableIndex];
+			std::vector<std::pair<uint32,uintptr_t>> targetCounts;
+			for(uint32 elementIndex = 0;elementIndex < astFunctionTable.numFunctions && targetCounts.size() <= maxDevirtualizedCallTargets;++elementIndex)
+			{
+				auto functionIndex = astFunctionTable.functionIndices[elementIndex];
+				auto targetCountIt = targetCounts.begin();
+				while(targetCountIt != targetCounts.end() && targetCountIt->second != functionIndex) { ++targetCountIt; }
+				if(targetCountIt != targetCounts.end()) { ++targetCountIt->first; }
+				else { targetCounts.push_back(std::make_pair(1u,functionIndex)); }
+			}
+			if(targetCounts.size() <= maxDevirtualizedCallTargets)
+			{
+				std::stable_sort(targetCounts.begin(),targetCounts.end(),[](const std::pair<uint32,uintptr_t>& a,const std::pair<uint32,uintptr_t>& b) { return a.first > b.first; });
+				for(auto& targetCount : targetCounts) { jitModule->functionTableCallTargets[tableIndex].push_back(targetCount.second); }
+			}
+		}
+
 		// Compile each function in the module.
 		for(uintptr_t functionIndex = 0;functionIndex < astModule->functions.size();++functionIndex)
 		{
@@ -970,17 +1372,19 @@ namespace LLVMJIT
 			if(!functionPointer)
 			{
 				std::cerr << "Missing imported function " << functionImport.name << " : (";
-				for(auto argIt = functionImport.type.parameters.begin();argIt != functionImport.type.parameters.end();++argIt)
+				for(auto argIt = functionImport.type->parameters.begin();argIt != functionImport.type->parameters.end();++argIt)
 				{
-					if(argIt != functionImport.type.parameters.begin()) { std::cerr << ","; }
+					if(argIt != functionImport.type->parameters.begin()) { std::cerr << ","; }
 					std::cerr << getTypeName(*argIt);
 				}
-				std::cerr << ") -> " << getTypeName(functionImport.type.returnType) << std::endl;
+				std::cerr << ") -> " << getTypeName(functionImport.type->returnType) << std::endl;
 				missingImport = true;
 			}
 		}
 
 		// Look up intrinsic values that match the name+type of values imported by the module, and bind them to the global variable used by the module to access the import.
+		// If the module has thread globals, the intrinsic values are instead copied into each thread's globals when they are created.
+		std::vector<Runtime::ThreadGlobalImport> threadGlobalImports;
 		for(uintptr_t variableImportIndex = 0;variableImportIndex < astModule->variableImports.size();++variableImportIndex)
 		{
 			auto variableImport = astModule->variableImports[variableImportIndex];
@@ -991,8 +1395,10 @@ namespace LLVMJIT
 				std::cerr << "Missing imported variable " << variableImport.name << " : " << getTypeName(variableImport.type) << std::endl;
 				missingImport = true;
 			}
+			else if(jitModule->hasThreadGlobals) { threadGlobalImports.push_back({variableImport.globalIndex,intrinsicValue->value,(getTypeBitWidth(variableImport.type) + 7) / 8}); }
 			else { jitModule->executionEngine->addGlobalMapping(jitModule->globalVariablePointers[variableImport.globalIndex],intrinsicValue->value); }
 		}
+		if(jitModule->hasThreadGlobals) { Runtime::setThreadGlobalLayout(astModule->globals.size(),threadGlobalImports); }
 
 		// Fail if there were any missing imports.
 		if(missingImport) { return false; }
@@ -1021,6 +1427,7 @@ namespace LLVMJIT
 
 		auto fpm = new llvm::legacy::FunctionPassManager(jitModule->llvmModule);
 		fpm->add(llvm::createPromoteMemoryToRegisterPass());
+		fpm->add(llvm::createTypeBasedAliasAnalysisPass());
 		fpm->add(llvm::createBasicAliasAnalysisPass());
 		fpm->add(llvm::createInstructionCombiningPass());
 		fpm->add(llvm::createReassociatePass());
@@ -1072,13 +1479,42 @@ namespace Runtime
 		return LLVMJIT::compileModule(astModule);
 	}
 
-	void* getFunctionPointer(const Module* module,uintptr_t functionIndex)
+	static LLVMJIT::JITModule* getJITModule(const Module* module)
 	{
 		for(auto jitModule : LLVMJIT::jitModules)
 		{
-			if(jitModule->astModule == module)
+			if(jitModule->astModule == module) { return jitModule; }
+		}
+		return nullptr;
+	}
+
+	void* getFunctionPointer(const Module* module,uintptr_t functionIndex)
+	{
+		auto jitModule = getJITModule(module);
+		auto exportName = module->exports.getExportName(functionIndex);
+		if(!jitModule || !exportName) { return nullptr; }
+		return (void*)jitModule->executionEngine->getFunctionAddress(exportName);
+	}
+
+	bool hasThreadGlobals(const Module* module)
+	{
+		auto jitModule = getJITModule(module);
+		return jitModule && jitModule->hasThreadGlobals;
+	}
+
+	void* getFunctionTableElement(const Module* module,const FunctionType* type,uint32 elementIndex)
+	{
+		auto jitModule = getJITModule(module);
+		if(!jitModule) { return nullptr; }
+		auto astModule = jitModule->astModule;
+		for(uintptr_t tableIndex = 0;tableIndex < astModule->functionTables.size();++tableIndex)
+		{
+			auto& functionTable = astModule->functionTables[tableIndex];
+			if(functionTable.type == type)
 			{
-				return (void*)jitModule->executionEngine->getFunctionAddress(jitModule->functions[functionIndex]->getName());
+				auto tableAddress = jitModule->executionEngine->getGlobalValueAddress(LLVMJIT::getFunctionTableName(tableIndex));
+				if(!tableAddress) { return nullptr; }
+				return ((void**)tableAddress)[elementIndex & (functionTable.numFunctions - 1)];
 			}
 		}
 		return nullptr;
@@ -11,23 +11,25 @@ namespace Runtime
 
 	static size_t numCommittedVirtualPages = 0;
 	static uint32 numAllocatedBytes = 0;
+	static Platform::Mutex sbrkMutex;
 
 	bool initInstanceMemory(size_t maxBytes)
 	{
-		numCommittedVirtualPages = 0;
-		numAllocatedBytes = 0;
-		if(!instanceMemoryBase)
-		{
-			// Allocate 4TB of address space for the instance. This is a tradeoff:
-			// - Windows 8+ and Linux user processes can allocate 128TB of virtual memory.
-			// - Windows 7 user processes can allocate 8TB of virtual memory.
-			// - Windows (haven't checked on Linux) allocates a fair amount of physical memory
-			//   for memory management data structures: 128MB for 64TB.
-			const size_t addressSpaceMaxBytes = 4ull*1024*1024*1024*1024;
-			if(maxBytes > addressSpaceMaxBytes) { return false; }
-
-			instanceAddressSpaceMaxBytes = maxBytes;
+		// Allocate 4TB of address space for the instance. This is a tradeoff:
+		// - Windows 8+ and Linux user processes can allocate 128TB of virtual memory.
+		// - Windows 7 user processes can allocate 8TB of virtual memory.
+		// - Windows (haven't checked on Linux) allocates a fair amount of physical memory
+		//   for memory management data structures: 128MB for 64TB.
+		const size_t addressSpaceMaxBytes = instanceAddressSpaceReservedBytes;
+		if(maxBytes > addressSpaceMaxBytes) { return false; }
 
+		if(instanceMemoryBase)
+		{
+			// If the memory is being reinitialized for another module, decommit the previous module's memory.
+			if(numCommittedVirtualPages) { Platform::decommitVirtualPages(instanceMemoryBase,numCommittedVirtualPages); }
+		}
+		else
+		{
 			// Align the instance memory base to a 4GB boundary, so the lower 32-bits will all be zero. Maybe it will allow better code generation?
 			const size_t numAllocatedVirtualPages = addressSpaceMaxBytes >> Platform::getPreferredVirtualPageSizeLog2();
 			const size_t alignment = 4ull*1024*1024*1024;
@@ -36,37 +38,44 @@ namespace Runtime
 			if(!unalignedInstanceMemoryBase) { return false; }
 			instanceMemoryBase = (uint8*)((uintptr_t)(unalignedInstanceMemoryBase + alignment - 1) & ~(alignment - 1));
 		}
+
+		instanceAddressSpaceMaxBytes = maxBytes;
+		numCommittedVirtualPages = 0;
+		numAllocatedBytes = 0;
 		return true;
 	}
 
 	uint32 vmSbrk(int32 numBytes)
 	{
+		Platform::Lock sbrkLock(sbrkMutex);
 		const uint32 existingNumBytes = numAllocatedBytes;
 		if(numBytes > 0)
 		{
-			if(uint64(existingNumBytes) + numBytes > (1ull<<32))
+			// Don't commit memory past the instance's maximum size: the JIT, the intrinsics and the bulk memory operators all
+			// rely on memory past it faulting.
+			if(uint64(existingNumBytes) + numBytes > std::min<uint64>(instanceAddressSpaceMaxBytes,1ull<<32))
 			{
 				return (uint32)-1;
 			}
 
 			const uint32 pageSizeLog2 = Platform::getPreferredVirtualPageSizeLog2();
 			const uint32 pageSize = 1ull << pageSizeLog2;
-			const size_t numDesiredPages = (numAllocatedBytes + numBytes + pageSize - 1) >> pageSizeLog2;
-			const size_t numNewPages = numDesiredPages - numCommittedVirtualPages;
-			if(numNewPages > 0)
+			const size_t numDesiredPages = (uint64(numAllocatedBytes) + numBytes + pageSize - 1) >> pageSizeLog2;
+			if(numDesiredPages > numCommittedVirtualPages)
 			{
+				const size_t numNewPages = numDesiredPages - numCommittedVirtualPages;
 				bool successfullyCommittedPhysicalMemory = Platform::commitVirtualPages(instanceMemoryBase + (numCommittedVirtualPages << pageSizeLog2),numNewPages);
 				if(!successfullyCommittedPhysicalMemory)
 				{
 					return (uint32)-1;
 				}
-				numAllocatedBytes += numBytes;
 				numCommittedVirtualPages += numNewPages;
 			}
+			numAllocatedBytes += numBytes;
 		}
 		else if(numBytes < 0)
 		{
-			numAllocatedBytes -= numBytes;
+			numAllocatedBytes += numBytes;
 		}
 		return (int32)existingNumBytes;
 	}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Core/Core.h"
+#include <vector>
+#include <utility>
 
-namespace AST { struct Module; }
+namespace AST { struct Module; struct FunctionType; }
 
 namespace Runtime
 {
@@ -10,18 +12,34 @@ namespace Runtime
 	// This is never changed after it is initialized.
 	extern uint8* instanceMemoryBase;
 
-	// The number of bytes of address-space reserved (but not necessarily committed) for the VM.
-	// This should be a power of two, and is never changed after it is initialized.
+	// The maximum number of bytes of memory the instance may use. vmSbrk never commits memory past it, and the JIT,
+	// the intrinsics and the bulk memory operators all bound the addresses they access by it.
+	// It is set by initInstanceMemory, and must not change while a module compiled against it is running.
 	extern size_t instanceAddressSpaceMaxBytes;
 
+	// The number of bytes of address-space that are always reserved following instanceMemoryBase, regardless of instanceAddressSpaceMaxBytes.
+	// Accessing reserved memory that isn't committed faults, so the JIT only needs to mask addresses to keep them within it.
+	const uint64 instanceAddressSpaceReservedBytes = 4ull*1024*1024*1024*1024;
+
 	// Initializes the instance memory.
 	extern bool initInstanceMemory(size_t maxBytes);
 
-	// Commits or decommits memory in the VM virtual address space.
+	// Commits or decommits memory in the VM virtual address space. Thread-safe.
 	extern uint32 vmSbrk(int32 numBytes);
 
-	// Initializes intrinsic values used by WASM from Emscripten.
-	void initEmscriptenIntrinsics();
+	// Sets the file descriptors that the instance's stdout and stderr streams are written to. Defaults to the process's stdout and stderr.
+	void setEmscriptenOutputFiles(int stdoutFileDescriptor,int stderrFileDescriptor);
+
+	// Sets the number of bytes of output the instance's stdout stream buffers before writing it to its file. stderr isn't buffered.
+	// Zero disables buffering. Must be called before initEmscriptenIntrinsics, which allocates the buffers in the instance's memory.
+	void setEmscriptenOutputBufferSize(uint32 numBytes);
+
+	// Initializes intrinsic values used by WASM from Emscripten, for an instance of the given module.
+	// Returns false if the stack and stream handles don't fit in the instance's maximum memory size.
+	bool initEmscriptenIntrinsics(const AST::Module* module);
+
+	// Writes any output buffered by the instance's stdout stream to its file.
+	void flushEmscriptenOutput();
 
 	// Given an address as a byte index, returns a typed reference to that address of VM memory.
 	template<typename memoryType> memoryType& instanceMemoryRef(uint32 address)
@@ -32,7 +50,44 @@ namespace Runtime
 	// Generates native code for an AST module.
 	bool compileModule(const AST::Module* module);
 
-	// Gets a pointer to the native code for the given function of a module.
+	// Gets a pointer to the native code for the given exported function of a module.
 	// If the module hasn't yet been passed to jitCompileModule, will return nullptr.
 	void* getFunctionPointer(const AST::Module* module,uintptr_t functionIndex);
+
+	// Returns whether the JIT stores a module's global variables in per-thread memory. See setThreadGlobalLayout.
+	bool hasThreadGlobals(const AST::Module* module);
+
+	// Gets a pointer to the native code for an element of a module's function table with the given type.
+	// The element index is masked to the table's size, the same as call_indirect. Returns nullptr if there's no table with the type.
+	// If the module has thread globals, the function takes the calling thread's globals as an extra first argument.
+	void* getFunctionTableElement(const AST::Module* module,const AST::FunctionType* type,uint32 elementIndex);
+
+	// Blocks the calling thread while the I32 at address equals expectedValue, until another thread calls atomicNotify for the address,
+	// or until timeoutNanoseconds have elapsed if it's non-negative. Returns 0 if woken, 1 if the value didn't match, or 2 if timed out.
+	uint32 atomicWait(uint32 address,uint32 expectedValue,int64 timeoutNanoseconds);
+
+	// Wakes up to numWaiters threads waiting on address, in the order they started waiting. Returns the number of threads woken.
+	uint32 atomicNotify(uint32 address,uint32 numWaiters);
+
+	// If a module can create threads, the JIT stores its global variables in a block of memory allocated for each thread instead of in
+	// the module's data. Each global has a threadGlobalSlotBytes slot, which is large enough for any value type. A thread's globals start
+	// at zero, except for globals imported from intrinsic values, which start with the intrinsic value at the time the thread's globals are created.
+	enum { threadGlobalSlotBytes = 16 };
+	struct ThreadGlobalImport
+	{
+		uintptr_t globalIndex;
+		const void* intrinsicValue;
+		size_t numBytes;
+	};
+
+	// Called by the JIT to set the layout of the thread globals for the instance's module.
+	void setThreadGlobalLayout(uintptr_t numGlobals,const std::vector<ThreadGlobalImport>& imports);
+
+	// Returns the calling thread's globals, creating them if this is the first call on the thread. The JIT calls this when the host
+	// calls a function exported by the module, and passes the result through calls within the module.
+	uint8* getThreadGlobals();
+
+	// Creates the calling thread's globals, initializing the globals imported from the intrinsic values in valueOverrides with the
+	// corresponding override value instead. Used to give a new thread its own stack. The globals are freed when the thread exits.
+	uint8* createThreadGlobals(const std::vector<std::pair<const void*,uint64>>& valueOverrides);
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "Core/Core.h"
+#include "Core/Platform.h"
+#include "Runtime.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string.h>
+
+namespace Runtime
+{
+	// A thread blocked in atomicWait.
+	struct Waiter
+	{
+		std::condition_variable condition;
+		bool isWoken;
+
+		Waiter(): isWoken(false) {}
+	};
+
+	// The threads waiting on each address, in the order they started waiting. Protected by waiterMutex.
+	// atomicWait compares the value in memory while holding the mutex, and atomicNotify is called after the value is changed,
+	// so a notification can't be lost between a waiter comparing the value and starting to wait.
+	static std::mutex waiterMutex;
+	static std::map<uint32,std::deque<Waiter*>> addressToWaitersMap;
+
+	uint32 atomicWait(uint32 address,uint32 expectedValue,int64 timeoutNanoseconds)
+	{
+		if((address & 3) || uint64(address) + sizeof(uint32) > instanceAddressSpaceMaxBytes) { throw "atomicWait: invalid address"; }
+
+		std::unique_lock<std::mutex> waiterLock(waiterMutex);
+		auto value = ((std::atomic<uint32>*)&instanceMemoryRef<uint32>(address))->load();
+		if(value != expectedValue) { return 1; }
+
+		Waiter waiter;
+		auto& waiters = addressToWaitersMap[address];
+		waiters.push_back(&waiter);
+		if(timeoutNanoseconds < 0)
+		{
+			while(!waiter.isWoken) { waiter.condition.wait(waiterLock); }
+		}
+		else
+		{
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNanoseconds);
+			while(!waiter.isWoken)
+			{
+				if(waiter.condition.wait_until(waiterLock,deadline) == std::cv_status::timeout) { break; }
+			}
+		}
+		if(waiter.isWoken) { return 0; }
+
+		// The wait timed out, so remove the waiter from the address's list. atomicNotify removes the waiters it wakes.
+		auto waitersIt = addressToWaitersMap.find(address);
+		auto& timedOutWaiters = waitersIt->second;
+		for(auto waiterIt = timedOutWaiters.begin();waiterIt != timedOutWaiters.end();++waiterIt)
+		{
+			if(*waiterIt == &waiter) { timedOutWaiters.erase(waiterIt); break; }
+		}
+		if(timedOutWaiters.empty()) { addressToWaitersMap.erase(waitersIt); }
+		return 2;
+	}
+
+	uint32 atomicNotify(uint32 address,uint32 numWaiters)
+	{
+		if((address & 3) || uint64(address) + sizeof(uint32) > instanceAddressSpaceMaxBytes) { throw "atomicNotify: invalid address"; }
+
+		std::lock_guard<std::mutex> waiterLock(waiterMutex);
+		auto waitersIt = addressToWaitersMap.find(address);
+		if(waitersIt == addressToWaitersMap.end()) { return 0; }
+
+		auto& waiters = waitersIt->second;
+		uint32 numWokenWaiters = 0;
+		while(numWokenWaiters < numWaiters && !waiters.empty())
+		{
+			auto waiter = waiters.front();
+			waiters.pop_front();
+			waiter->isWoken = true;
+			waiter->condition.notify_one();
+			++numWokenWaiters;
+		}
+		if(waiters.empty()) { addressToWaitersMap.erase(waitersIt); }
+		return numWokenWaiters;
+	}
+
+	// The layout of the thread globals, set by the JIT before any of the module's code runs. The generation is incremented each
+	// time the layout is set, so globals created for the layout of a previously compiled module aren't reused.
+	static uintptr_t numThreadGlobals = 0;
+	static std::vector<ThreadGlobalImport> threadGlobalImports;
+	static uint64 threadGlobalLayoutGeneration = 0;
+
+	// The calling thread's globals, and the generation of the layout they were created for.
+	// This uses thread_local instead of THREAD_LOCAL, so they are freed when the thread exits.
+	static thread_local std::unique_ptr<uint8[]> threadGlobals;
+	static thread_local uint64 threadGlobalsLayoutGeneration = 0;
+
+	void setThreadGlobalLayout(uintptr_t numGlobals,const std::vector<ThreadGlobalImport>& imports)
+	{
+		numThreadGlobals = numGlobals;
+		threadGlobalImports = imports;
+		++threadGlobalLayoutGeneration;
+	}
+
+	uint8* getThreadGlobals()
+	{
+		if(!threadGlobals || threadGlobalsLayoutGeneration != threadGlobalLayoutGeneration) { return createThreadGlobals({}); }
+		return threadGlobals.get();
+	}
+
+	uint8* createThreadGlobals(const std::vector<std::pair<const void*,uint64>>& valueOverrides)
+	{
+		threadGlobalsLayoutGeneration = threadGlobalLayoutGeneration;
+		threadGlobals.reset(new uint8[numThreadGlobals * threadGlobalSlotBytes]);
+		memset(threadGlobals.get(),0,numThreadGlobals * threadGlobalSlotBytes);
+		for(auto& import : threadGlobalImports)
+		{
+			const void* value = import.intrinsicValue;
+			for(auto& valueOverride : valueOverrides)
+			{
+				if(valueOverride.first == import.intrinsicValue) { value = &valueOverride.second; break; }
+			}
+			memcpy(threadGlobals.get() + import.globalIndex * threadGlobalSlotBytes,value,import.numBytes);
+		}
+		return threadGlobals.get();
+	}
+}
\ No newline at end of file
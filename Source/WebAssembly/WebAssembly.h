@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Core/Core.h"
+#include "Core/OutputBuffer.h"
+#include "Core/SExpressions.h"
 #include "AST/AST.h"
 
 #include <vector>
+#include <memory>
 
 namespace WebAssemblyText
 {
@@ -14,7 +17,8 @@ namespace WebAssemblyText
 		uintptr_t invokeFunctionIndex;
 		std::vector<AST::TypedExpression> parameters;
 		AST::TypedExpression value;
-		Core::TextFileLocus locus;
+		// The offset of the assertion in the parsed string. File::sourceLocator maps it to a locus when one is needed for a message.
+		uint32 sourceOffset;
 	};
 
 	struct File
@@ -23,10 +27,18 @@ namespace WebAssemblyText
 		std::vector<AST::ErrorRecord*> errors;
 
 		std::vector<AssertEq> assertEqs;
+
+		// Maps offsets in the parsed string to loci. It references the parsed string, so it may only be used while the string is alive.
+		std::shared_ptr<SExp::SourceLocator> sourceLocator;
 	};
 
-	bool parse(const char* string,File& outFile);
+	// Parses a WAST string. The modules and assertions in the string are distributed across numThreads threads, but the results and
+	// errors are added to outFile in the same order as parsing them on a single thread would.
+	bool parse(const char* string,File& outFile,uintptr_t numThreads = 1);
 	std::string print(const AST::Module* module);
+
+	// Prints a module straight to an output buffer, which avoids building the whole WAST text in memory.
+	void print(const AST::Module* module,Core::OutputBuffer& outputBuffer);
 }
 
 namespace WebAssemblyBinary
@@ -471,7 +471,7 @@ namespace WebAssemblyBinary
 		std::vector<uint32> i32Constants;
 		std::vector<float32> f32Constants;
 		std::vector<float64> f64Constants;
-		std::vector<FunctionType> functionTypes;
+		std::vector<const FunctionType*> functionTypes;
 		std::map<std::string,uintptr_t> intrinsicNameToFunctionImportIndex;
 
 		// Information about the current operation being decoded.
@@ -576,7 +576,7 @@ namespace WebAssemblyBinary
 		template<typename Type>
 		typename Type::TypeExpression* load(TypeId memoryType,typename Type::Op loadOp,IntExpression* address)
 		{
-			return new(arena) Load<typename Type::Class>(loadOp,false,true,address,memoryType);
+			return new(arena) Load<typename Type::Class>(loadOp,false,getNaturalAlignmentLog2(memoryType),address,memoryType);
 		}
 
 		// Stores a value to memory.
@@ -584,7 +584,7 @@ namespace WebAssemblyBinary
 		typename Type::TypeExpression* store(TypeId memoryType,IntExpression* address)
 		{
 			auto value = decodeExpression(Type());
-			return new(arena) Store<typename Type::Class>(false,true,address,TypedExpression(value,Type::id),memoryType);
+			return new(arena) Store<typename Type::Class>(false,getNaturalAlignmentLog2(memoryType),address,TypedExpression(value,Type::id),memoryType);
 		}
 
 		// Converts a signed or unsigned 32-bit integer to a float32.
@@ -669,8 +669,8 @@ namespace WebAssemblyBinary
 		{
 			if(functionIndex >= module.functions.size()) { throw new FatalDecodeException("callinternal: invalid function index"); }
 			auto function = module.functions[functionIndex];
-			auto parameters = decodeParameters(function->type.parameters);
-			return function->type.returnType == returnType
+			auto parameters = decodeParameters(function->type->parameters);
+			return function->type->returnType == returnType
 				? as<Class>(new(arena) Call(AnyOp::callDirect,Class::id,functionIndex,parameters))
 				: recordError<Class>("callinternal: incorrect type");
 		}
@@ -678,8 +678,8 @@ namespace WebAssemblyBinary
 		{
 			if(functionIndex >= module.functions.size()) { throw new FatalDecodeException("callinternal: invalid function index"); }
 			auto function = module.functions[functionIndex];
-			auto returnType = function->type.returnType;
-			switch(function->type.returnType)
+			auto returnType = function->type->returnType;
+			switch(function->type->returnType)
 			{
 			case TypeId::I32: return new(arena) DiscardResult(TypedExpression(callInternal<IntClass>(TypeId::I32,functionIndex),returnType));
 			case TypeId::F32: return new(arena) DiscardResult(TypedExpression(callInternal<FloatClass>(TypeId::F32,functionIndex),returnType));
@@ -696,8 +696,8 @@ namespace WebAssemblyBinary
 			if(tableIndex >= module.functions.size()) { throw new FatalDecodeException("callindirect: invalid table index"); }
 			const FunctionTable& functionTable = module.functionTables[tableIndex];
 			auto functionIndex = decodeExpression(I32Type());
-			auto parameters = decodeParameters(functionTable.type.parameters);
-			return functionTable.type.returnType == returnType
+			auto parameters = decodeParameters(functionTable.type->parameters);
+			return functionTable.type->returnType == returnType
 				? as<Class>(new(arena) CallIndirect(Class::id,tableIndex,functionIndex,parameters))
 				: recordError<Class>("callindirect: incorrect type");
 		}
@@ -705,8 +705,8 @@ namespace WebAssemblyBinary
 		{
 			if(tableIndex >= module.functions.size()) { throw new FatalDecodeException("callindirect: invalid table index"); }
 			const FunctionTable& functionTable = module.functionTables[tableIndex];
-			auto returnType = functionTable.type.returnType;
-			switch(functionTable.type.returnType)
+			auto returnType = functionTable.type->returnType;
+			switch(functionTable.type->returnType)
 			{
 			case TypeId::I32: return new(arena) DiscardResult(TypedExpression(callIndirect<IntClass>(TypeId::I32,tableIndex),returnType));
 			case TypeId::F32: return new(arena) DiscardResult(TypedExpression(callIndirect<FloatClass>(TypeId::F32,tableIndex),returnType));
@@ -722,8 +722,8 @@ namespace WebAssemblyBinary
 		{
 			if(functionImportIndex >= module.functionImports.size()) { throw new FatalDecodeException("callimport: invalid import index"); }
 			const FunctionImport& functionImport = module.functionImports[functionImportIndex];
-			UntypedExpression** parameters = decodeParameters(functionImport.type.parameters);
-			return functionImport.type.returnType == returnType
+			UntypedExpression** parameters = decodeParameters(functionImport.type->parameters);
+			return functionImport.type->returnType == returnType
 				? as<Class>(new(arena) Call(AnyOp::callImport,Class::id,functionImportIndex,parameters))
 				: recordError<Class>("callimport: incorrect type");
 		}
@@ -731,8 +731,8 @@ namespace WebAssemblyBinary
 		{
 			if(functionImportIndex >= module.functionImports.size()) { throw new FatalDecodeException("callimport: invalid import index"); }
 			const FunctionImport& functionImport = module.functionImports[functionImportIndex];
-			auto returnType = functionImport.type.returnType;
-			switch(functionImport.type.returnType)
+			auto returnType = functionImport.type->returnType;
+			switch(functionImport.type->returnType)
 			{
 			case TypeId::I32: return new(arena) DiscardResult(TypedExpression(callImport<IntClass>(TypeId::I32,functionImportIndex),returnType));
 			case TypeId::F32: return new(arena) DiscardResult(TypedExpression(callImport<FloatClass>(TypeId::F32,functionImportIndex),returnType));
@@ -741,7 +741,7 @@ namespace WebAssemblyBinary
 			default: throw;
 			};
 		}
-		uintptr_t getIntrinsicFunctionImport(const FunctionType& intrinsicType,const char* intrinsicName)
+		uintptr_t getIntrinsicFunctionImport(const FunctionType* intrinsicType,const char* intrinsicName)
 		{
 			// Add one import for every unique intrinsic name used.
 			auto intrinsicIt = intrinsicNameToFunctionImportIndex.find(intrinsicName);
@@ -759,9 +759,9 @@ namespace WebAssemblyBinary
 			}
 		}
 		template<typename Class>
-		typename Class::ClassExpression* decodeIntrinsic(const FunctionType& intrinsicType,const char* intrinsicName)
+		typename Class::ClassExpression* decodeIntrinsic(const FunctionType* intrinsicType,const char* intrinsicName)
 		{
-			return callImport<Class>(intrinsicType.returnType,getIntrinsicFunctionImport(intrinsicType,intrinsicName));
+			return callImport<Class>(intrinsicType->returnType,getIntrinsicFunctionImport(intrinsicType,intrinsicName));
 		}
 
 		// Computes the minimum or maximum of a set.
@@ -780,7 +780,7 @@ namespace WebAssemblyBinary
 		{
 			auto numParameters = in.immU32();
 			if(numParameters == 0) { return recordError<typename Type::Class>("minmax: must receive >0 parameters"); }
-			auto intrinsicImportIndex = getIntrinsicFunctionImport(FunctionType(Type::id,{Type::id,Type::id}),intrinsicName);
+			auto intrinsicImportIndex = getIntrinsicFunctionImport(FunctionType::get(Type::id,{Type::id,Type::id}),intrinsicName);
 			typename Type::TypeExpression* result = decodeExpression(Type());
 			for(uint32 parameterIndex = 1;parameterIndex < numParameters;++parameterIndex)
 			{
@@ -973,7 +973,7 @@ namespace WebAssemblyBinary
 		// Decodes a return based on the current function's return type.
 		VoidExpression* decodeReturn()
 		{
-			switch(currentFunction->type.returnType)
+			switch(currentFunction->type->returnType)
 			{
 			case TypeId::I32: return new(arena) Return<VoidClass>(decodeExpression(I32Type()));
 			case TypeId::F32: return new(arena) Return<VoidClass>(decodeExpression(F32Type()));
@@ -1179,16 +1179,16 @@ namespace WebAssemblyBinary
 				case F64OpEncoding::Ceil:     return decodeUnary<F64Type>(FloatOp::ceil);
 				case F64OpEncoding::Floor:    return decodeUnary<F64Type>(FloatOp::floor);
 				case F64OpEncoding::Sqrt:     return decodeUnary<F64Type>(FloatOp::sqrt);
-				case F64OpEncoding::Cos:     return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"cos");
-				case F64OpEncoding::Sin:      return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"sin");
-				case F64OpEncoding::Tan:      return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"tan");
-				case F64OpEncoding::ACos:     return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"acos");
-				case F64OpEncoding::ASin:     return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"asin");
-				case F64OpEncoding::ATan:     return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"atan");
-				case F64OpEncoding::ATan2:    return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64,TypeId::F64}),"atan2");
-				case F64OpEncoding::Exp:      return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"exp");
-				case F64OpEncoding::Ln:       return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64}),"log");
-				case F64OpEncoding::Pow:      return decodeIntrinsic<FloatClass>(FunctionType(TypeId::F64,{TypeId::F64,TypeId::F64}),"pow");
+				case F64OpEncoding::Cos:     return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"cos");
+				case F64OpEncoding::Sin:      return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"sin");
+				case F64OpEncoding::Tan:      return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"tan");
+				case F64OpEncoding::ACos:     return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"acos");
+				case F64OpEncoding::ASin:     return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"asin");
+				case F64OpEncoding::ATan:     return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"atan");
+				case F64OpEncoding::ATan2:    return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64,TypeId::F64}),"atan2");
+				case F64OpEncoding::Exp:      return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"exp");
+				case F64OpEncoding::Ln:       return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64}),"log");
+				case F64OpEncoding::Pow:      return decodeIntrinsic<FloatClass>(FunctionType::get(TypeId::F64,{TypeId::F64,TypeId::F64}),"pow");
 				default: throw new FatalDecodeException("invalid F64 opcode");
 				}
 			}
@@ -1305,15 +1305,17 @@ namespace WebAssemblyBinary
 				}
 				else numLocalI32s = imm;
 				
-				currentFunction->locals.resize(currentFunction->type.parameters.size() + numLocalI32s + numLocalF32s + numLocalF64s);
+				currentFunction->locals.resize(arena,currentFunction->type->parameters.size() + numLocalI32s + numLocalF32s + numLocalF64s);
+				currentFunction->locals.shrink(arena);
 				uintptr_t localIndex = 0;
 				
 				// Create locals for the function's parameters.
-				currentFunction->parameterLocalIndices.resize(currentFunction->type.parameters.size());
-				for(uintptr_t parameterIndex = 0;parameterIndex < currentFunction->type.parameters.size();++parameterIndex)
+				currentFunction->parameterLocalIndices.resize(arena,currentFunction->type->parameters.size());
+				currentFunction->parameterLocalIndices.shrink(arena);
+				for(uintptr_t parameterIndex = 0;parameterIndex < currentFunction->type->parameters.size();++parameterIndex)
 				{
 					currentFunction->parameterLocalIndices[parameterIndex] = localIndex;
-					currentFunction->locals[localIndex++] = {currentFunction->type.parameters[parameterIndex],nullptr};
+					currentFunction->locals[localIndex++] = {currentFunction->type->parameters[parameterIndex],nullptr};
 				}
 				
 				// Create the function local variables.
@@ -1326,7 +1328,7 @@ namespace WebAssemblyBinary
 
 				// Decode the function's statements.
 				auto voidExpression = decodeStatementList();
-				switch(currentFunction->type.returnType)
+				switch(currentFunction->type->returnType)
 				{
 				case TypeId::I32: currentFunction->expression = new(arena) Sequence<IntClass>(voidExpression,new(arena) Literal<I32Type>(0)); break;
 				case TypeId::F32: currentFunction->expression = new(arena) Sequence<FloatClass>(voidExpression,new(arena) Literal<F32Type>(0.0f)); break;
@@ -1345,7 +1347,7 @@ namespace WebAssemblyBinary
 			{
 				// The module has a single export. Call it "default"
 				auto functionIndex = in.boundedImmU32("export function index",module.functions.size());
-				module.exportNameToFunctionIndexMap["default"] = functionIndex;
+				module.exports.add("default",functionIndex);
 				break;
 			}
 			case ExportFormat::Record:
@@ -1358,7 +1360,7 @@ namespace WebAssemblyBinary
 					while(char c = in.single_char()) { exportName.append(arena,c); };
 
 					auto functionIndex = in.boundedImmU32("export function index",module.functions.size());
-					module.exportNameToFunctionIndexMap[exportName.c_str()] = functionIndex;
+					if(!module.exports.add(exportName.c_str(),functionIndex)) { throw new FatalDecodeException("duplicate export name"); }
 
 					// Also set the export name on the function.
 					module.functions[functionIndex]->name = exportName.c_str();
@@ -1376,11 +1378,12 @@ namespace WebAssemblyBinary
 			functionTypes.resize(numTypes);
 			for(uint32 typeIndex = 0;typeIndex < numTypes;++typeIndex)
 			{
-				functionTypes[typeIndex].returnType = in.returnType();
+				TypeId returnType = in.returnType();
 				uint32 numParameters = in.immU32();
-				functionTypes[typeIndex].parameters.resize(numParameters);
+				std::vector<TypeId> parameters(numParameters);
 				for(uint32 parameterIndex = 0; parameterIndex < numParameters; parameterIndex++)
-				{ functionTypes[typeIndex].parameters[parameterIndex] = in.type(); }
+				{ parameters[parameterIndex] = in.type(); }
+				functionTypes[typeIndex] = FunctionType::get(returnType,parameters);
 			}
 		}
 
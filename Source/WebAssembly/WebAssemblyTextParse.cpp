@@ -1,6 +1,9 @@
 #include "Core/Core.h"
 #include "Core/MemoryArena.h"
 #include "Core/SExpressions.h"
+#include "Core/FloatParsing.h"
+#include "Core/Parallel.h"
+#include "Core/StringHashMap.h"
 #include "AST/AST.h"
 #include "AST/ASTExpressions.h"
 #include "AST/ASTDispatch.h"
@@ -43,8 +46,7 @@ namespace WebAssemblyText
 	// Creates and records an error with the given message and location (taken from nodeIt).
 	template<typename Error> Error* recordError(std::vector<ErrorRecord*>& outErrors,SNodeIt nodeIt,std::string&& message)
 	{
-		auto locus = nodeIt.node ? nodeIt.node->startLocus : nodeIt.previousLocus;
-		auto error = new Error(locus.describe() + ": " + message + " (S-expression node is " + describeSNode(nodeIt) + ")");
+		auto error = new Error(nodeIt.getLocus().describe() + ": " + message + " (S-expression node is " + describeSNode(nodeIt) + ")");
 		outErrors.push_back(error);
 		return error;
 	}
@@ -77,6 +79,17 @@ namespace WebAssemblyText
 		else { return false; }
 	}
 
+	// Parse a V128 lane index from a S-expression node. Fails without consuming the node if the index isn't less than numLanes.
+	bool parseLaneIndex(SNodeIt& nodeIt,uintptr_t numLanes,uint8& outLaneIndex)
+	{
+		auto laneIndexNodeIt = nodeIt;
+		int64 laneIndex;
+		if(!parseInt(laneIndexNodeIt,laneIndex) || laneIndex < 0 || (uint64)laneIndex >= numLanes) { return false; }
+		outLaneIndex = (uint8)laneIndex;
+		nodeIt = laneIndexNodeIt;
+		return true;
+	}
+
 	// Parse a 64-bit float32 from a S-expression node.
 	bool parseFloat64(SNodeIt& nodeIt,float64& outDouble)
 	{
@@ -85,13 +98,22 @@ namespace WebAssemblyText
 		else { return false; }
 	}
 
+	// Parse a float32 from a S-expression node. Decimal nodes are parsed again from the source string, since rounding the node's float64 to a
+	// float32 may produce a different result than rounding the number directly.
+	bool parseFloat32(SNodeIt& nodeIt,float32& outFloat)
+	{
+		if(nodeIt && nodeIt->type == SExp::NodeType::Decimal) { FloatParsing::parseFloat32(nodeIt.locator->getString() + nodeIt->startOffset,outFloat); ++nodeIt; return true; }
+		else if(nodeIt && nodeIt->type == SExp::NodeType::Int) { outFloat = (float32)nodeIt->integer; ++nodeIt; return true; }
+		else { return false; }
+	}
+
 	// Parse a string from a S-expression node. Upon success, the string is copied into the provided memory arena.
 	bool parseString(SNodeIt& nodeIt,const char*& outString,size_t& outStringLength,Memory::Arena& arena)
 	{
 		if(nodeIt && nodeIt->type == SExp::NodeType::String)
 		{
-			outString = arena.copyToArena(nodeIt->string,nodeIt->stringLength + 1);
-			outStringLength = nodeIt->stringLength;
+			outString = arena.copyToArena(nodeIt->string,nodeIt->getStringLength() + 1);
+			outStringLength = nodeIt->getStringLength();
 			++nodeIt;
 			return true;
 		}
@@ -112,6 +134,39 @@ namespace WebAssemblyText
 		else { return false; }
 	}
 
+	// Parse a load or store symbol with an alignment suffix, e.g. i32.load/2. The suffix is the alignment in bytes, which must be a power of two.
+	// Upon success, outSymbol is set to the symbol without the suffix, and outAlignmentLog2 to the log2 of the alignment.
+	bool parseAlignedMemoryOpSymbol(SNodeIt& nodeIt,Symbol& outSymbol,int& outAlignmentLog2,std::vector<ErrorRecord*>& outErrors)
+	{
+		if(!nodeIt || nodeIt->type != SExp::NodeType::UnindexedSymbol) { return false; }
+		const char* suffix = strrchr(nodeIt->string,'/');
+		if(!suffix || !suffix[1]) { return false; }
+
+		const std::string opName(nodeIt->string,suffix - nodeIt->string);
+		uintptr_t symbolIndex;
+		if((opName.find(".load") == std::string::npos && opName.find(".store") == std::string::npos)
+		|| !getWASTSymbolIndexMap().find(opName.c_str(),opName.length(),symbolIndex)) { return false; }
+
+		// Alignments larger than a page can't be used by the JIT, since the instance memory is only page aligned.
+		const uint64 maxAlignment = 4096;
+		uint64 alignment = 0;
+		for(const char* nextChar = suffix + 1;*nextChar;++nextChar)
+		{
+			if(*nextChar < '0' || *nextChar > '9') { return false; }
+			if(alignment <= maxAlignment) { alignment = alignment * 10 + (*nextChar - '0'); }
+		}
+
+		// An invalid alignment is recorded as an error, but the op is still parsed with byte alignment to check the rest of it.
+		outAlignmentLog2 = 0;
+		if(!alignment || (alignment & (alignment - 1))) { recordError<ErrorRecord>(outErrors,nodeIt,"non-power-of-two alignment"); }
+		else if(alignment > maxAlignment) { recordError<ErrorRecord>(outErrors,nodeIt,"alignment is greater than 4096"); }
+		else { while((uint64(1) << outAlignmentLog2) < alignment) { ++outAlignmentLog2; } }
+
+		outSymbol = (Symbol)symbolIndex;
+		++nodeIt;
+		return true;
+	}
+
 	// Parse a S-expression tree node whose first child is an symbol. Sets outChildren to the first child after the symbol on success.
 	bool parseTaggedNode(SNodeIt nodeIt,Symbol tagSymbol,SNodeIt& outChildIt)
 	{
@@ -165,30 +220,29 @@ namespace WebAssemblyText
 	// Parse a name or an index.
 	// If a name is parsed that is contained in nameToIndex, the index of the name is assigned to outIndex and true is returned.
 	// If an index is parsed that is between 0 and numValidIndices, the index is assigned to outIndex and true is returned.
-	bool parseNameOrIndex(SNodeIt& nodeIt,const std::map<std::string,uintptr_t>& nameToIndex,size_t numValidIndices,uintptr_t& outIndex)
+	bool parseNameOrIndex(SNodeIt& nodeIt,const Core::StringHashMap<uintptr_t>& nameToIndex,size_t numValidIndices,uintptr_t& outIndex)
 	{
 		const char* name;
 		int64 parsedInt;
 		if(parseInt(nodeIt,parsedInt) && parsedInt >= 0 && (uintptr_t)parsedInt < numValidIndices) { outIndex = (uintptr_t)parsedInt; return true; }
 		else if(parseName(nodeIt,name))
 		{
-			auto it = nameToIndex.find(name);
-			if(it != nameToIndex.end()) { outIndex = it->second; return true; }
+			auto index = nameToIndex.get(name);
+			if(index) { outIndex = *index; return true; }
 			else { return false; }
 		}
 		else { return false; }
 	}
 
-	// Builds a map from name to index from an array of variables.
-	void buildVariableNameToIndexMapMap(const std::vector<Variable>& variables,std::map<std::string,uintptr_t>& outNameToIndexMap,std::vector<ErrorRecord*>& outErrors)
+	// Builds a map from name to index from an array of variables. The map refers to the variables' names, so they must outlive it.
+	void buildVariableNameToIndexMapMap(const Variable* variables,size_t numVariables,Core::StringHashMap<uintptr_t>& outNameToIndexMap,std::vector<ErrorRecord*>& outErrors)
 	{
-		for(uintptr_t variableIndex = 0;variableIndex < variables.size();++variableIndex)
+		for(uintptr_t variableIndex = 0;variableIndex < numVariables;++variableIndex)
 		{
 			const auto& variable = variables[variableIndex];
 			if(variable.name != nullptr)
 			{
-				if(outNameToIndexMap.count(variable.name)) { recordError<ErrorRecord>(outErrors,SNodeIt(nullptr),"duplicate variable name"); }
-				else { outNameToIndexMap[variable.name] = variableIndex; }
+				if(!outNameToIndexMap.add(variable.name,variableIndex)) { recordError<ErrorRecord>(outErrors,SNodeIt(nullptr),"duplicate variable name"); }
 			}
 		}
 	}
@@ -197,13 +251,15 @@ namespace WebAssemblyText
 	struct ModuleContext
 	{
 		Module* module;
-		std::map<std::string,uintptr_t> functionNameToIndexMap;
-		std::map<std::string,uintptr_t> globalNameToIndexMap;
-		std::map<std::string,uintptr_t> functionTableNameToIndexMap;
-		std::map<std::string,uintptr_t> functionImportNameToIndexMap;
+		Core::StringHashMap<uintptr_t> functionNameToIndexMap;
+		Core::StringHashMap<uintptr_t> globalNameToIndexMap;
+		Core::StringHashMap<uintptr_t> functionTableNameToIndexMap;
+		Core::StringHashMap<uintptr_t> functionImportNameToIndexMap;
 		std::vector<ErrorRecord*>& outErrors;
+		uintptr_t numThreads;
 
-		ModuleContext(Module* inModule,std::vector<ErrorRecord*>& inOutErrors): module(inModule), outErrors(inOutErrors) {}
+		ModuleContext(Module* inModule,std::vector<ErrorRecord*>& inOutErrors,uintptr_t inNumThreads = 1)
+		: module(inModule), outErrors(inOutErrors), numThreads(inNumThreads) {}
 
 		Module* parse(SNodeIt moduleNode);
 	};
@@ -212,13 +268,18 @@ namespace WebAssemblyText
 	struct FunctionContext
 	{
 		FunctionContext(ModuleContext& inModuleContext,Function* inFunction)
-		:	arena(inModuleContext.module->arena)
-		,	outErrors(inModuleContext.outErrors)
+		: FunctionContext(inModuleContext,inFunction,inModuleContext.module->arena,inModuleContext.outErrors) {}
+
+		// Allocates the function's expressions from inArena, and records errors in inOutErrors. This allows parsing multiple functions
+		// in the same module on different threads.
+		FunctionContext(ModuleContext& inModuleContext,Function* inFunction,Memory::Arena& inArena,std::vector<ErrorRecord*>& inOutErrors)
+		:	arena(inArena)
+		,	outErrors(inOutErrors)
 		,	moduleContext(inModuleContext)
 		,	function(inFunction)
 		{
 			// Build a map from local/parameter names to indices.
-			buildVariableNameToIndexMapMap(function->locals,localNameToIndexMap,outErrors);
+			buildVariableNameToIndexMapMap(function->locals.data(),function->locals.size(),localNameToIndexMap,outErrors);
 		}
 		
 		// Parses an expression of a specific type that's not known at compile time. Returns an UntypedExpression because the type is known to the caller.
@@ -250,8 +311,8 @@ namespace WebAssemblyText
 		std::vector<ErrorRecord*>& outErrors;
 		ModuleContext& moduleContext;
 		Function* function;
-		std::map<std::string,uintptr_t> localNameToIndexMap;
-		std::map<std::string,BranchTarget*> labelToBranchTargetMap;
+		Core::StringHashMap<uintptr_t> localNameToIndexMap;
+		Core::StringHashMap<BranchTarget*> labelToBranchTargetMap;
 
 		std::vector<BranchTarget*> scopedBranchTargets;
 	
@@ -260,7 +321,8 @@ namespace WebAssemblyText
 		{
 			SNodeIt nodeIt;
 			Symbol tag;
-			if(parseTreeNode(parentNodeIt,nodeIt) && parseSymbol(nodeIt,tag))
+			int explicitAlignmentLog2 = -1;
+			if(parseTreeNode(parentNodeIt,nodeIt) && (parseSymbol(nodeIt,tag) || parseAlignedMemoryOpSymbol(nodeIt,tag,explicitAlignmentLog2,outErrors)))
 			{
 				TypeId opType;
 				switch(tag)
@@ -277,6 +339,11 @@ namespace WebAssemblyText
 					throw; case Symbol::_##symbol##_##opTypeName:
 				#define DEFINE_BITYPED_OP(leftTypeName,rightTypeName,symbol) \
 					throw; case Symbol::_##symbol##_##leftTypeName##_##rightTypeName:
+				#define DISPATCH_LANE_TYPED_OP(laneTypeName,laneClassName,symbol,opClassName) \
+					throw; case Symbol::_##symbol##_lanes_##laneTypeName: opType = TypeId::laneTypeName; goto symbol##opClassName##LanesLabel;
+				#define DEFINE_LANE_TYPED_OP(laneClass,symbol) \
+					ENUM_AST_TYPES_##laneClass(DISPATCH_LANE_TYPED_OP,symbol,laneClass) \
+					throw; symbol##laneClass##LanesLabel:
 
 				#define DEFINE_UNARY_OP(class,symbol,opcode) DEFINE_TYPED_OP(class,symbol) { return parseUnaryExpression<class##Class>(opType,class##Op::opcode,nodeIt); }
 				#define DEFINE_BINARY_OP(class,symbol,opcode) DEFINE_TYPED_OP(class,symbol) { return parseBinaryExpression<class##Class>(opType,class##Op::opcode,nodeIt); }
@@ -285,6 +352,11 @@ namespace WebAssemblyText
 					{ return parseCastExpression<destType##Type::Class>(destType##Type::Op::opcode,TypeId::sourceType,TypeId::destType,nodeIt); }
 
 				DEFINE_UNTYPED_OP(nop)			{ return TypedExpression(Nop::get(),TypeId::Void); }
+				DEFINE_UNTYPED_OP(copy_memory)	{ return parseBulkMemoryExpression(VoidOp::copyMemory,"copy_memory",nodeIt); }
+				DEFINE_UNTYPED_OP(move_memory)	{ return parseBulkMemoryExpression(VoidOp::moveMemory,"move_memory",nodeIt); }
+				DEFINE_UNTYPED_OP(fill_memory)	{ return parseBulkMemoryExpression(VoidOp::fillMemory,"fill_memory",nodeIt); }
+				DEFINE_UNTYPED_OP(atomic_wait)	{ return parseAtomicExpression(TypeId::I32,IntOp::atomicWait,nodeIt); }
+				DEFINE_UNTYPED_OP(atomic_notify)	{ return parseAtomicExpression(TypeId::I32,IntOp::atomicNotify,nodeIt); }
 
 				DEFINE_TYPED_OP(Int,const)
 				{
@@ -301,20 +373,24 @@ namespace WebAssemblyText
 				}
 				DEFINE_TYPED_OP(Float,const)
 				{
-					float64 doubleValue;
-					if(!parseFloat64(nodeIt,doubleValue)) { return TypedExpression(recordError<Error<FloatClass>>(outErrors,nodeIt,"const: expected decimal"),opType); }
+					float32 floatValue = 0.0f;
+					float64 doubleValue = 0.0;
+					const bool isValid = opType == TypeId::F32 ? parseFloat32(nodeIt,floatValue) : parseFloat64(nodeIt,doubleValue);
+					if(!isValid) { return TypedExpression(recordError<Error<FloatClass>>(outErrors,nodeIt,"const: expected decimal"),opType); }
 					switch(opType)
 					{
-					case TypeId::F32: return TypedExpression(requireFullMatch(nodeIt,"const.f32",new(arena)Literal<F32Type>((float32)doubleValue)),TypeId::F32);
+					case TypeId::F32: return TypedExpression(requireFullMatch(nodeIt,"const.f32",new(arena)Literal<F32Type>(floatValue)),TypeId::F32);
 					case TypeId::F64: return TypedExpression(requireFullMatch(nodeIt,"const.f64",new(arena)Literal<F64Type>(doubleValue)),TypeId::F64);
 					default: throw;
 					}
 				}
 				
+				// Loads and stores have the natural alignment of their memory type unless the op has an alignment suffix.
+				#define GET_ALIGNMENT_LOG2(memoryType) (explicitAlignmentLog2 >= 0 ? (uint8)explicitAlignmentLog2 : getNaturalAlignmentLog2(TypeId::memoryType))
 				#define DEFINE_LOAD_OP(class,valueType,memoryType,loadSymbol,loadOp) DEFINE_TYPED_OP_FOR_TYPE(valueType,loadSymbol)	\
-					{ return parseLoadExpression<class##Class>(TypeId::valueType,TypeId::memoryType,class##Op::loadOp,false,true,nodeIt); }
+					{ return parseLoadExpression<class##Class>(TypeId::valueType,TypeId::memoryType,class##Op::loadOp,false,GET_ALIGNMENT_LOG2(memoryType),nodeIt); }
 				#define DEFINE_STORE_OP(class,valueType,memoryType,storeSymbol) DEFINE_TYPED_OP_FOR_TYPE(valueType,storeSymbol) \
-					{ return parseStoreExpression<class##Class>(TypeId::valueType,TypeId::memoryType,false,true,nodeIt); }
+					{ return parseStoreExpression<class##Class>(TypeId::valueType,TypeId::memoryType,false,GET_ALIGNMENT_LOG2(memoryType),nodeIt); }
 				#define DEFINE_MEMORY_OP(class,valueType,memoryType,loadSymbol,storeSymbol,loadOp) \
 					DEFINE_LOAD_OP(class,valueType,memoryType,loadSymbol,loadOp) \
 					DEFINE_STORE_OP(class,valueType,memoryType,storeSymbol)
@@ -350,6 +426,17 @@ namespace WebAssemblyText
 				DEFINE_BINARY_OP(Int,shr_s,shrSExt)
 				DEFINE_BINARY_OP(Int,shr_u,shrZExt)
 
+				#define DEFINE_ATOMIC_OP(symbol,opcode) DEFINE_TYPED_OP(Int,symbol) { return parseAtomicExpression(opType,IntOp::opcode,nodeIt); }
+				DEFINE_ATOMIC_OP(atomic_load,atomicLoad)
+				DEFINE_ATOMIC_OP(atomic_store,atomicStore)
+				DEFINE_ATOMIC_OP(atomic_add,atomicAdd)
+				DEFINE_ATOMIC_OP(atomic_sub,atomicSub)
+				DEFINE_ATOMIC_OP(atomic_and,atomicAnd)
+				DEFINE_ATOMIC_OP(atomic_or,atomicOr)
+				DEFINE_ATOMIC_OP(atomic_xor,atomicXor)
+				DEFINE_ATOMIC_OP(atomic_xchg,atomicExchange)
+				DEFINE_ATOMIC_OP(atomic_cmpxchg,atomicCompareExchange)
+
 				DEFINE_UNARY_OP(Float,neg,neg)
 				DEFINE_UNARY_OP(Float,abs,abs)
 				DEFINE_UNARY_OP(Float,ceil,ceil)
@@ -370,6 +457,31 @@ namespace WebAssemblyText
 				DEFINE_BINARY_OP(Bool,and,bitwiseAnd)
 				DEFINE_BINARY_OP(Bool,or,bitwiseOr)
 
+				// For the lane typed ops, opType is the lane type.
+				#define DEFINE_LANE_UNARY_OP(laneClass,symbol,opcode) DEFINE_LANE_TYPED_OP(laneClass,symbol) { return parseLaneUnaryExpression(opType,V128Op::opcode,nodeIt); }
+				#define DEFINE_LANE_BINARY_OP(laneClass,symbol,opcode) DEFINE_LANE_TYPED_OP(laneClass,symbol) { return parseLaneBinaryExpression(opType,V128Op::opcode,nodeIt); }
+
+				DEFINE_TYPED_OP_FOR_TYPE(V128,const) { return parseV128Literal(nodeIt); }
+				DEFINE_MEMORY_OP(V128,V128,V128,load,store,load)
+				DEFINE_UNARY_OP(V128,not,bitwiseNot)
+				DEFINE_BINARY_OP(V128,and,bitwiseAnd)
+				DEFINE_BINARY_OP(V128,or,bitwiseOr)
+				DEFINE_BINARY_OP(V128,xor,bitwiseXor)
+				DEFINE_LANE_UNARY_OP(Numeric,neg,neg)
+				DEFINE_LANE_UNARY_OP(Numeric,abs,abs)
+				DEFINE_LANE_UNARY_OP(Float,sqrt,sqrt)
+				DEFINE_LANE_BINARY_OP(Numeric,add,add)
+				DEFINE_LANE_BINARY_OP(Numeric,sub,sub)
+				DEFINE_LANE_BINARY_OP(Numeric,mul,mul)
+				DEFINE_LANE_BINARY_OP(Float,div,div)
+				DEFINE_LANE_BINARY_OP(Float,min,min)
+				DEFINE_LANE_BINARY_OP(Float,max,max)
+				DEFINE_LANE_TYPED_OP(Numeric,splat) { return parseSplatExpression(opType,nodeIt); }
+				DEFINE_LANE_TYPED_OP(Int,extract_lane) { return parseExtractLaneExpression<IntClass>(opType,nodeIt); }
+				DEFINE_LANE_TYPED_OP(Float,extract_lane) { return parseExtractLaneExpression<FloatClass>(opType,nodeIt); }
+				DEFINE_LANE_TYPED_OP(Numeric,replace_lane) { return parseReplaceLaneExpression(opType,nodeIt); }
+				DEFINE_LANE_TYPED_OP(Numeric,shuffle) { return parseShuffleExpression(opType,nodeIt); }
+
 				DEFINE_COMPARE_OP(Int,eq,eq) DEFINE_COMPARE_OP(Int,ne,ne)
 				DEFINE_COMPARE_OP(Float,eq,eq) DEFINE_COMPARE_OP(Float,ne,ne)
 				DEFINE_COMPARE_OP(Bool,eq,eq) DEFINE_COMPARE_OP(Bool,ne,ne)
@@ -454,6 +566,11 @@ namespace WebAssemblyText
 				#undef DEFINE_TYPED_OP
 				#undef DISPATCH_BITYPED_OP
 				#undef DEFINE_BITYPED_OP
+				#undef DISPATCH_LANE_TYPED_OP
+				#undef DEFINE_LANE_TYPED_OP
+				#undef DEFINE_LANE_UNARY_OP
+				#undef DEFINE_LANE_BINARY_OP
+				#undef GET_ALIGNMENT_LOG2
 				}
 			}
 			
@@ -487,14 +604,14 @@ namespace WebAssemblyText
 					const char* labelName;
 					bool hasEndLabel = parseName(nodeIt,labelName);
 					auto endTarget = new(arena)BranchTarget(resultType);
-					if(hasEndLabel && labelToBranchTargetMap.count(labelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"switch: break label name shadows outer label"); }
+					if(hasEndLabel && labelToBranchTargetMap.contains(labelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"switch: break label name shadows outer label"); }
 					
 					// Parse the switch key.
 					auto keyType = opType;
 					auto key = parseTypedExpression<IntClass>(keyType,nodeIt,"switch key");
 
 					// Add the switch's label to the in-scope labels.
-					if(hasEndLabel) { labelToBranchTargetMap[labelName] = endTarget; }
+					if(hasEndLabel) { labelToBranchTargetMap.add(labelName,endTarget); }
 					
 					// Count the number of switch cases.
 					size_t numArms = 0;
@@ -561,7 +678,7 @@ namespace WebAssemblyText
 					arms[numArms].value = parseTypedExpression<Class>(resultType,nodeIt,"switch default value");
 					
 					// Remove the switch end target from the in-scope branch targets.
-					if(hasEndLabel) { labelToBranchTargetMap.erase(labelName); }
+					if(hasEndLabel) { labelToBranchTargetMap.remove(labelName); }
 
 					// Create the Switch node.
 					auto result = new(arena)Switch<Class>(TypedExpression(key,keyType),numArms,numArms+1,arms,endTarget);
@@ -595,20 +712,20 @@ namespace WebAssemblyText
 					bool hasContinueLabel = parseName(nodeIt,continueLabelName);
 					if(hasBreakLabel)
 					{
-						if(labelToBranchTargetMap.count(breakLabelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"loop: break label name shadows outer label"); }
-						labelToBranchTargetMap[breakLabelName] = breakTarget;
+						if(labelToBranchTargetMap.contains(breakLabelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"loop: break label name shadows outer label"); }
+						labelToBranchTargetMap.add(breakLabelName,breakTarget);
 					}
 					if(hasContinueLabel)
 					{
-						if(labelToBranchTargetMap.count(continueLabelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"loop: continue label name shadows outer label"); }
-						labelToBranchTargetMap[continueLabelName] = continueTarget;
+						if(labelToBranchTargetMap.contains(continueLabelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"loop: continue label name shadows outer label"); }
+						labelToBranchTargetMap.add(continueLabelName,continueTarget);
 					}
 
 					// Parse the loop body.
 					auto expression = parseExpressionSequence<VoidClass>(TypeId::Void,nodeIt,"loop body");
 					
-					if(hasBreakLabel) { labelToBranchTargetMap.erase(breakLabelName); }
-					if(hasContinueLabel) { labelToBranchTargetMap.erase(continueLabelName); }
+					if(hasBreakLabel) { labelToBranchTargetMap.remove(breakLabelName); }
+					if(hasContinueLabel) { labelToBranchTargetMap.remove(continueLabelName); }
 
 					// Create the Loop node.
 					return new(arena)Loop<Class>(expression,breakTarget,continueTarget);
@@ -625,8 +742,8 @@ namespace WebAssemblyText
 					}
 					else if(parseName(nodeIt,name))
 					{
-						auto it = labelToBranchTargetMap.find(name);
-						if(it != labelToBranchTargetMap.end()) { branchTarget = it->second; }
+						auto namedBranchTarget = labelToBranchTargetMap.get(name);
+						if(namedBranchTarget) { branchTarget = *namedBranchTarget; }
 					}
 					else
 					{
@@ -648,7 +765,7 @@ namespace WebAssemblyText
 				DEFINE_PARAMETRIC_UNTYPED_OP(return)
 				{
 					// If the function's return type isn't void, parse an expression for the return value.
-					auto returnType = function->type.returnType;
+					auto returnType = function->type->returnType;
 					auto valueExpression = returnType == TypeId::Void ? nullptr
 						: parseTypedExpression(returnType,nodeIt,"return value");
 					
@@ -666,19 +783,19 @@ namespace WebAssemblyText
 
 					// Parse the call's parameters.
 					auto callFunction = moduleContext.module->functions[functionIndex];
-					auto parameters = new(arena)UntypedExpression*[callFunction->type.parameters.size()];
-					for(uintptr_t parameterIndex = 0;parameterIndex < callFunction->type.parameters.size();++parameterIndex)
+					auto parameters = new(arena)UntypedExpression*[callFunction->type->parameters.size()];
+					for(uintptr_t parameterIndex = 0;parameterIndex < callFunction->type->parameters.size();++parameterIndex)
 					{
-						auto parameterType = callFunction->type.parameters[parameterIndex];
+						auto parameterType = callFunction->type->parameters[parameterIndex];
 						auto parameterValue = parseTypedExpression(parameterType,nodeIt,"call parameter");
 						parameters[parameterIndex] = parameterValue;
 					}
 
 					// Create the Call node.
-					auto call = new(arena)Call(AnyOp::callDirect,getPrimaryTypeClass(callFunction->type.returnType),functionIndex,parameters);
+					auto call = new(arena)Call(AnyOp::callDirect,getPrimaryTypeClass(callFunction->type->returnType),functionIndex,parameters);
 
 					// Validate the function return type against the result type of this call.
-					auto result = coerceExpression(Class(),resultType,TypedExpression(call,callFunction->type.returnType),parentNodeIt,"call return value");
+					auto result = coerceExpression(Class(),resultType,TypedExpression(call,callFunction->type->returnType),parentNodeIt,"call return value");
 					return requireFullMatch(nodeIt,"call",result);
 				}
 				DEFINE_PARAMETRIC_UNTYPED_OP(call_import)
@@ -692,19 +809,19 @@ namespace WebAssemblyText
 
 					// Parse the call's parameters.
 					auto functionImport = moduleContext.module->functionImports[importIndex];
-					auto parameters = new(arena)UntypedExpression*[functionImport.type.parameters.size()];
-					for(uintptr_t parameterIndex = 0;parameterIndex < functionImport.type.parameters.size();++parameterIndex)
+					auto parameters = new(arena)UntypedExpression*[functionImport.type->parameters.size()];
+					for(uintptr_t parameterIndex = 0;parameterIndex < functionImport.type->parameters.size();++parameterIndex)
 					{
-						auto parameterType = functionImport.type.parameters[parameterIndex];
+						auto parameterType = functionImport.type->parameters[parameterIndex];
 						auto parameterValue = parseTypedExpression(parameterType,nodeIt,"call_import parameter");
 						parameters[parameterIndex] = parameterValue;
 					}
 
 					// Create the Call node.
-					auto call = new(arena)Call(AnyOp::callImport,getPrimaryTypeClass(functionImport.type.returnType),importIndex,parameters);
+					auto call = new(arena)Call(AnyOp::callImport,getPrimaryTypeClass(functionImport.type->returnType),importIndex,parameters);
 					
 					// Validate the function return type against the result type of this call.
-					auto result = coerceExpression(Class(),resultType,TypedExpression(call,functionImport.type.returnType),parentNodeIt,"call_import return value");
+					auto result = coerceExpression(Class(),resultType,TypedExpression(call,functionImport.type->returnType),parentNodeIt,"call_import return value");
 					return requireFullMatch(nodeIt,"call",result);
 				}
 				DEFINE_PARAMETRIC_UNTYPED_OP(call_indirect)
@@ -721,19 +838,19 @@ namespace WebAssemblyText
 
 					// Parse the call's parameters.
 					auto functionTable = moduleContext.module->functionTables[tableIndex];
-					auto parameters = arena.allocate<UntypedExpression*>(functionTable.type.parameters.size());
-					for(uintptr_t parameterIndex = 0;parameterIndex < functionTable.type.parameters.size();++parameterIndex)
+					auto parameters = arena.allocate<UntypedExpression*>(functionTable.type->parameters.size());
+					for(uintptr_t parameterIndex = 0;parameterIndex < functionTable.type->parameters.size();++parameterIndex)
 					{
-						auto parameterType = functionTable.type.parameters[parameterIndex];
+						auto parameterType = functionTable.type->parameters[parameterIndex];
 						auto parameterValue = parseTypedExpression(parameterType,nodeIt,"call_indirect parameter");
 						parameters[parameterIndex] = parameterValue;
 					}
 
 					// Create the CallIndirect node.
-					auto call = new(arena)CallIndirect(getPrimaryTypeClass(functionTable.type.returnType),tableIndex,functionIndex,parameters);
+					auto call = new(arena)CallIndirect(getPrimaryTypeClass(functionTable.type->returnType),tableIndex,functionIndex,parameters);
 					
 					// Validate the function return type against the result type of this call.
-					auto result = coerceExpression(Class(),resultType,TypedExpression(call,functionTable.type.returnType),parentNodeIt,"call_indirect return value");
+					auto result = coerceExpression(Class(),resultType,TypedExpression(call,functionTable.type->returnType),parentNodeIt,"call_indirect return value");
 					return requireFullMatch(nodeIt,"call_indirect",result);
 				}
 
@@ -742,13 +859,13 @@ namespace WebAssemblyText
 					// Parse an optional name for the label.
 					const char* labelName;
 					bool hasName = parseName(nodeIt,labelName);
-					if(hasName && labelToBranchTargetMap.count(labelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"label: name shadows outer label"); }
+					if(hasName && labelToBranchTargetMap.contains(labelName)) { return recordError<Error<Class>>(outErrors,nodeIt,"label: name shadows outer label"); }
 
 					// Create a branch target for the label.
 					auto branchTarget = new(arena)BranchTarget(resultType);
 
 					// Add the target to the in-scope branch targets.
-					if(hasName) { labelToBranchTargetMap[labelName] = branchTarget; }
+					if(hasName) { labelToBranchTargetMap.add(labelName,branchTarget); }
 					scopedBranchTargets.push_back(branchTarget);
 
 					// Parse the label body.
@@ -756,7 +873,7 @@ namespace WebAssemblyText
 
 					// Remove the target from the in-scope branch targets.
 					scopedBranchTargets.pop_back();
-					if(hasName) { labelToBranchTargetMap.erase(labelName); }
+					if(hasName) { labelToBranchTargetMap.remove(labelName); }
 					
 					// Create the Label node.
 					return new(arena)Label<Class>(branchTarget,expression);
@@ -765,13 +882,13 @@ namespace WebAssemblyText
 				DEFINE_PARAMETRIC_UNTYPED_OP(block)
 				{ return parseExpressionSequence<Class>(resultType,nodeIt,"block body"); }
 				DEFINE_PARAMETRIC_UNTYPED_OP(get_local)
-				{ return parseGetVariable<Class>(resultType,AnyOp::getLocal,localNameToIndexMap,function->locals,nodeIt); }
+				{ return parseGetVariable<Class>(resultType,AnyOp::getLocal,localNameToIndexMap,function->locals.data(),function->locals.size(),nodeIt); }
 				DEFINE_PARAMETRIC_UNTYPED_OP(load_global)
-				{ return parseGetVariable<Class>(resultType,AnyOp::getGlobal,moduleContext.globalNameToIndexMap,moduleContext.module->globals,nodeIt); }
+				{ return parseGetVariable<Class>(resultType,AnyOp::getGlobal,moduleContext.globalNameToIndexMap,moduleContext.module->globals.data(),moduleContext.module->globals.size(),nodeIt); }
 				DEFINE_PARAMETRIC_UNTYPED_OP(set_local)
-				{ return parseSetVariable<Class>(resultType,AnyOp::setLocal,localNameToIndexMap,function->locals,nodeIt); }
+				{ return parseSetVariable<Class>(resultType,AnyOp::setLocal,localNameToIndexMap,function->locals.data(),function->locals.size(),nodeIt); }
 				DEFINE_PARAMETRIC_UNTYPED_OP(store_global)
-				{ return parseSetVariable<Class>(resultType,AnyOp::setGlobal,moduleContext.globalNameToIndexMap,moduleContext.module->globals,nodeIt); }
+				{ return parseSetVariable<Class>(resultType,AnyOp::setGlobal,moduleContext.globalNameToIndexMap,moduleContext.module->globals.data(),moduleContext.module->globals.size(),nodeIt); }
 
 				#undef DEFINE_PARAMETRIC_UNTYPED_OP
 				#undef DISPATCH_PARAMETRIC_TYPED_OP
@@ -970,30 +1087,146 @@ namespace WebAssemblyText
 
 		// Parse a memory load operation.
 		template<typename Class>
-		TypedExpression parseLoadExpression(TypeId resultType,TypeId memoryType,typename Class::Op loadOp,bool isFarAddress,bool isAligned,SNodeIt nodeIt)
+		TypedExpression parseLoadExpression(TypeId resultType,TypeId memoryType,typename Class::Op loadOp,bool isFarAddress,uint8 alignmentLog2,SNodeIt nodeIt)
 		{
 			if(!isTypeClass(memoryType,Class::id))
 				{ return TypedExpression(recordError<Error<Class>>(outErrors,nodeIt,"load: memory type must be same type class as result"),resultType); }
 			
 			auto address = parseTypedExpression<IntClass>(isFarAddress ? TypeId::I64 : TypeId::I32,nodeIt,"load address");
 
-			auto result = new(arena) Load<Class>(loadOp,isFarAddress,isAligned,address,memoryType);
+			auto result = new(arena) Load<Class>(loadOp,isFarAddress,alignmentLog2,address,memoryType);
 			return TypedExpression(requireFullMatch(nodeIt,"load",result),resultType);
 		}
 
 		// Parse a memory store operation.
 		template<typename OperandClass>
-		TypedExpression parseStoreExpression(TypeId valueType,TypeId memoryType,bool isFarAddress,bool isAligned,SNodeIt nodeIt)
+		TypedExpression parseStoreExpression(TypeId valueType,TypeId memoryType,bool isFarAddress,uint8 alignmentLog2,SNodeIt nodeIt)
 		{
 			if(!isTypeClass(memoryType,OperandClass::id))
 				{ return TypedExpression(recordError<Error<VoidClass>>(outErrors,nodeIt,"store: memory type must be same type class as result"),TypeId::Void); }
 			
 			auto address = parseTypedExpression<IntClass>(isFarAddress ? TypeId::I64 : TypeId::I32,nodeIt,"store address");
 			auto value = parseTypedExpression<OperandClass>(valueType,nodeIt,"store value");
-			auto result = new(arena) Store<OperandClass>(isFarAddress,isAligned,address,TypedExpression(value,valueType),memoryType);
+			auto result = new(arena) Store<OperandClass>(isFarAddress,alignmentLog2,address,TypedExpression(value,valueType),memoryType);
 			return TypedExpression(requireFullMatch(nodeIt,"store",result),valueType);
 		}
 		
+		// Parse a bulk memory operation.
+		TypedExpression parseBulkMemoryExpression(VoidOp op,const char* opName,SNodeIt nodeIt)
+		{
+			auto destAddress = parseTypedExpression<IntClass>(TypeId::I32,nodeIt,"destination address");
+			auto source = parseTypedExpression<IntClass>(TypeId::I32,nodeIt,op == VoidOp::fillMemory ? "fill value" : "source address");
+			auto numBytes = parseTypedExpression<IntClass>(TypeId::I32,nodeIt,"number of bytes");
+			auto result = new(arena) BulkMemory(op,destAddress,source,numBytes);
+			return TypedExpression(requireFullMatch(nodeIt,opName,result),TypeId::Void);
+		}
+
+		// Parse an atomic memory operation.
+		TypedExpression parseAtomicExpression(TypeId opType,IntOp op,SNodeIt nodeIt)
+		{
+			auto address = parseTypedExpression<IntClass>(TypeId::I32,nodeIt,"atomic address");
+			Expression<IntClass>* operand = nullptr;
+			Expression<IntClass>* replacement = nullptr;
+			if(op != IntOp::atomicLoad) { operand = parseTypedExpression<IntClass>(Atomic::getOperandType(op,opType),nodeIt,"atomic operand"); }
+			if(op == IntOp::atomicCompareExchange || op == IntOp::atomicWait)
+				{ replacement = parseTypedExpression<IntClass>(Atomic::getReplacementType(op,opType),nodeIt,op == IntOp::atomicWait ? "timeout" : "replacement value"); }
+			auto result = new(arena) Atomic(op,address,operand,replacement);
+			return TypedExpression(requireFullMatch(nodeIt,getOpName(op),result),opType);
+		}
+		
+		// Parse a V128 literal: a lane type followed by a literal for each lane.
+		TypedExpression parseV128Literal(SNodeIt nodeIt)
+		{
+			TypeId laneType;
+			if(!parseType(nodeIt,laneType) || (!isTypeClass(laneType,TypeClassId::Int) && !isTypeClass(laneType,TypeClassId::Float)))
+				{ return TypedExpression(recordError<Error<V128Class>>(outErrors,nodeIt,"const: expected lane type"),TypeId::V128); }
+
+			NativeTypes::V128 value = {};
+			for(uintptr_t laneIndex = 0;laneIndex < getNumV128Lanes(laneType);++laneIndex)
+			{
+				int64 integer = 0;
+				float64 decimal = 0.0;
+				bool isValidLane;
+				switch(laneType)
+				{
+				case TypeId::I8: isValidLane = parseInt(nodeIt,integer); value.u8[laneIndex] = (uint8)integer; break;
+				case TypeId::I16: isValidLane = parseInt(nodeIt,integer); value.u16[laneIndex] = (uint16)integer; break;
+				case TypeId::I32: isValidLane = parseInt(nodeIt,integer); value.u32[laneIndex] = (uint32)integer; break;
+				case TypeId::I64: isValidLane = parseInt(nodeIt,integer); value.u64[laneIndex] = (uint64)integer; break;
+				case TypeId::F32: isValidLane = parseFloat32(nodeIt,value.f32[laneIndex]); break;
+				case TypeId::F64: isValidLane = parseFloat64(nodeIt,decimal); value.f64[laneIndex] = decimal; break;
+				default: throw;
+				}
+				if(!isValidLane) { return TypedExpression(recordError<Error<V128Class>>(outErrors,nodeIt,"const: expected a literal for each lane"),TypeId::V128); }
+			}
+			return TypedExpression(requireFullMatch(nodeIt,"const.v128",new(arena)Literal<V128Type>(value)),TypeId::V128);
+		}
+
+		// Parse an unary operation on each lane of a V128.
+		TypedExpression parseLaneUnaryExpression(TypeId laneType,V128Op op,SNodeIt nodeIt)
+		{
+			auto operand = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"unary operand");
+			auto result = new(arena) LaneUnary(op,laneType,operand);
+			return TypedExpression(requireFullMatch(nodeIt,getOpName(op),result),TypeId::V128);
+		}
+
+		// Parse a binary operation on each lane of a V128.
+		TypedExpression parseLaneBinaryExpression(TypeId laneType,V128Op op,SNodeIt nodeIt)
+		{
+			auto left = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"binary left operand");
+			auto right = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"binary right operand");
+			auto result = new(arena) LaneBinary(op,laneType,left,right);
+			return TypedExpression(requireFullMatch(nodeIt,getOpName(op),result),TypeId::V128);
+		}
+
+		// Parse a splat of a scalar to every lane of a V128.
+		TypedExpression parseSplatExpression(TypeId laneType,SNodeIt nodeIt)
+		{
+			auto scalar = parseTypedExpression(laneType,nodeIt,"splat scalar");
+			auto result = new(arena) Splat(TypedExpression(scalar,laneType));
+			return TypedExpression(requireFullMatch(nodeIt,"splat",result),TypeId::V128);
+		}
+
+		// Parse a read of a V128 lane.
+		template<typename Class>
+		TypedExpression parseExtractLaneExpression(TypeId laneType,SNodeIt nodeIt)
+		{
+			uint8 laneIndex;
+			if(!parseLaneIndex(nodeIt,getNumV128Lanes(laneType),laneIndex))
+				{ return TypedExpression(recordError<Error<Class>>(outErrors,nodeIt,"extract_lane: expected lane index"),laneType); }
+			auto vector = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"extract_lane vector");
+			auto result = new(arena) ExtractLane<Class>(vector,laneIndex);
+			return TypedExpression(requireFullMatch(nodeIt,"extract_lane",result),laneType);
+		}
+
+		// Parse a replacement of a V128 lane.
+		TypedExpression parseReplaceLaneExpression(TypeId laneType,SNodeIt nodeIt)
+		{
+			uint8 laneIndex;
+			if(!parseLaneIndex(nodeIt,getNumV128Lanes(laneType),laneIndex))
+				{ return TypedExpression(recordError<Error<V128Class>>(outErrors,nodeIt,"replace_lane: expected lane index"),TypeId::V128); }
+			auto vector = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"replace_lane vector");
+			auto scalar = parseTypedExpression(laneType,nodeIt,"replace_lane scalar");
+			auto result = new(arena) ReplaceLane(vector,TypedExpression(scalar,laneType),laneIndex);
+			return TypedExpression(requireFullMatch(nodeIt,"replace_lane",result),TypeId::V128);
+		}
+
+		// Parse a shuffle of the lanes of two V128s. There's an index for each lane of the result, which can select any lane of either operand.
+		TypedExpression parseShuffleExpression(TypeId laneType,SNodeIt nodeIt)
+		{
+			uint8 laneIndices[16] = {0};
+			auto numLanes = getNumV128Lanes(laneType);
+			for(uintptr_t laneIndex = 0;laneIndex < numLanes;++laneIndex)
+			{
+				if(!parseLaneIndex(nodeIt,numLanes * 2,laneIndices[laneIndex]))
+					{ return TypedExpression(recordError<Error<V128Class>>(outErrors,nodeIt,"shuffle: expected a lane index for each lane"),TypeId::V128); }
+			}
+			auto left = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"shuffle left operand");
+			auto right = parseTypedExpression<V128Class>(TypeId::V128,nodeIt,"shuffle right operand");
+			auto result = new(arena) Shuffle(laneType,left,right,laneIndices);
+			return TypedExpression(requireFullMatch(nodeIt,"shuffle",result),TypeId::V128);
+		}
+
 		// Parse a cast operation.
 		template<typename Class>
 		TypedExpression parseCastExpression(typename Class::Op op,TypeId sourceType,TypeId destType,SNodeIt nodeIt)
@@ -1005,10 +1238,10 @@ namespace WebAssemblyText
 		
 		// Parses a load from a local or global variable.
 		template<typename Class>
-		typename Class::ClassExpression* parseGetVariable(TypeId resultType,AnyOp op,const std::map<std::string,uintptr_t>& nameToIndexMap,const std::vector<Variable>& variables,SNodeIt nodeIt)
+		typename Class::ClassExpression* parseGetVariable(TypeId resultType,AnyOp op,const Core::StringHashMap<uintptr_t>& nameToIndexMap,const Variable* variables,size_t numVariables,SNodeIt nodeIt)
 		{
 			uintptr_t variableIndex;
-			if(!parseNameOrIndex(nodeIt,nameToIndexMap,variables.size(),variableIndex))
+			if(!parseNameOrIndex(nodeIt,nameToIndexMap,numVariables,variableIndex))
 			{
 				auto message = op == AnyOp::getLocal ? "get_local: expected local name or index" : "load_global: expected global name or index";
 				return recordError<Error<Class>>(outErrors,nodeIt,std::move(message));
@@ -1021,10 +1254,10 @@ namespace WebAssemblyText
 
 		// Parses a store to a local or global variable.
 		template<typename Class>
-		typename Class::ClassExpression* parseSetVariable(TypeId resultType,AnyOp op,const std::map<std::string,uintptr_t>& nameToIndexMap,const std::vector<Variable>& variables,SNodeIt nodeIt)
+		typename Class::ClassExpression* parseSetVariable(TypeId resultType,AnyOp op,const Core::StringHashMap<uintptr_t>& nameToIndexMap,const Variable* variables,size_t numVariables,SNodeIt nodeIt)
 		{
 			uintptr_t variableIndex;
-			if(!parseNameOrIndex(nodeIt,nameToIndexMap,variables.size(),variableIndex))
+			if(!parseNameOrIndex(nodeIt,nameToIndexMap,numVariables,variableIndex))
 			{
 				auto message = op == AnyOp::setLocal ? "set_local: expected local name or index" : "store_global: expected global name or index";
 				return recordError<Error<Class>>(outErrors,nodeIt,message);
@@ -1040,7 +1273,11 @@ namespace WebAssemblyText
 	Module* ModuleContext::parse(SNodeIt firstModuleChildNode)
 	{
 		// Do a first pass that only parses declarations before parsing definitions.
+		// The function declarations are parsed into these temporary arrays, which are reused for every function, and then copied to the arena.
 		bool hasMemoryNode = false;
+		std::vector<Variable> locals;
+		std::vector<uintptr_t> parameterLocalIndices;
+		std::vector<TypeId> parameterTypes;
 		for(auto nodeIt = firstModuleChildNode;nodeIt;++nodeIt)
 		{
 			SNodeIt childNodeIt;
@@ -1055,11 +1292,14 @@ namespace WebAssemblyText
 				if(parseName(childNodeIt,functionName))
 				{
 					function->name = module->arena.copyToArena(functionName,strlen(functionName)+1);
-					if(functionNameToIndexMap.count(functionName)) { recordError<ErrorRecord>(outErrors,childNodeIt,"duplicate function name"); }
-					else { functionNameToIndexMap[functionName] = functionIndex; }
+					if(!functionNameToIndexMap.add(function->name,functionIndex)) { recordError<ErrorRecord>(outErrors,childNodeIt,"duplicate function name"); }
 				}
 
 				bool hasResult = false;
+				TypeId returnType = TypeId::Void;
+				locals.clear();
+				parameterLocalIndices.clear();
+				parameterTypes.clear();
 				for(;childNodeIt;++childNodeIt)
 				{
 					SNodeIt innerChildNodeIt;
@@ -1067,30 +1307,33 @@ namespace WebAssemblyText
 					{
 						// Parse a result declaration.
 						if(hasResult) { recordError<ErrorRecord>(outErrors,childNodeIt,"duplicate result declaration"); continue; }
-						if(!parseType(innerChildNodeIt,function->type.returnType)) { recordError<ErrorRecord>(outErrors,innerChildNodeIt,"expected type"); continue; }
+						if(!parseType(innerChildNodeIt,returnType)) { recordError<ErrorRecord>(outErrors,innerChildNodeIt,"expected type"); continue; }
 						hasResult = true;
 						if(innerChildNodeIt) { recordError<ErrorRecord>(outErrors,innerChildNodeIt,"unexpected input following result declaration"); continue; }
 					}
 					else if(parseTaggedNode(childNodeIt,Symbol::_param,innerChildNodeIt))
 					{
 						// Parse a parameter declaration.
-						const uintptr_t baseLocalIndex = function->locals.size();
-						const size_t numParameters = parseVariables(innerChildNodeIt,function->locals,outErrors,module->arena);
+						const uintptr_t baseLocalIndex = locals.size();
+						const size_t numParameters = parseVariables(innerChildNodeIt,locals,outErrors,module->arena);
 						for(uintptr_t parameterIndex = 0;parameterIndex < numParameters;++parameterIndex)
 						{
-							function->parameterLocalIndices.push_back(baseLocalIndex + parameterIndex);
-							function->type.parameters.push_back(function->locals[baseLocalIndex + parameterIndex].type);
+							parameterLocalIndices.push_back(baseLocalIndex + parameterIndex);
+							parameterTypes.push_back(locals[baseLocalIndex + parameterIndex].type);
 						}
 						if(innerChildNodeIt) { recordError<ErrorRecord>(outErrors,innerChildNodeIt,"unexpected input following parameter declaration"); continue; }
 					}
 					else if(parseTaggedNode(childNodeIt,Symbol::_local,innerChildNodeIt))
 					{
 						// Parse a local declaration.
-						parseVariables(innerChildNodeIt,function->locals,outErrors,module->arena);
+						parseVariables(innerChildNodeIt,locals,outErrors,module->arena);
 						if(innerChildNodeIt) { recordError<ErrorRecord>(outErrors,innerChildNodeIt,"unexpected input following local declaration"); continue; }
 					}
 					else { break; } // Stop parsing when we reach the first func child that isn't a param, result, or local.
 				}
+				function->type = FunctionType::get(returnType,parameterTypes);
+				function->locals.assign(module->arena,locals.data(),locals.size());
+				function->parameterLocalIndices.assign(module->arena,parameterLocalIndices.data(),parameterLocalIndices.size());
 			}
 			else if(parseTaggedNode(nodeIt,Symbol::_import,childNodeIt))
 			{
@@ -1101,8 +1344,7 @@ namespace WebAssemblyText
 				if(parseName(childNodeIt,importInternalName))
 				{
 					importInternalName = module->arena.copyToArena(importInternalName,strlen(importInternalName) + 1);
-					if(functionImportNameToIndexMap.count(importInternalName)) { recordError<ErrorRecord>(outErrors,SNodeIt(nullptr),"duplicate variable name"); }
-					else { functionImportNameToIndexMap[importInternalName] = importIndex; }
+					if(!functionImportNameToIndexMap.add(importInternalName,importIndex)) { recordError<ErrorRecord>(outErrors,SNodeIt(nullptr),"duplicate variable name"); }
 				}
 
 				// Parse a mandatory import string.
@@ -1152,7 +1394,7 @@ namespace WebAssemblyText
 					// Create the import.
 					std::vector<TypeId> parameterTypes;
 					for(auto parameter : parameters) { parameterTypes.push_back(parameter.type); }
-					module->functionImports.push_back({FunctionType(returnType,parameterTypes),importExternalName});
+					module->functionImports.push_back({FunctionType::get(returnType,parameterTypes),importExternalName});
 				}
 
 				if(childNodeIt) { recordError<ErrorRecord>(outErrors,childNodeIt,"unexpected input following import declaration"); continue; }
@@ -1219,7 +1461,7 @@ namespace WebAssemblyText
 				for(auto countNodeIt = childNodeIt;countNodeIt;++countNodeIt)
 				{ ++numFunctions; }
 
-				FunctionType functionType;
+				const FunctionType* functionType = FunctionType::get();
 				auto functionIndices = new(module->arena) uintptr_t[numFunctions];
 				if(!numFunctions) { recordError<ErrorRecord>(outErrors,nodeIt,"function table must contain atleast 1 function"); }
 				else
@@ -1248,9 +1490,18 @@ namespace WebAssemblyText
 		}
 
 		// Build a global name to index map.
-		buildVariableNameToIndexMapMap(module->globals,globalNameToIndexMap,outErrors);
+		buildVariableNameToIndexMapMap(module->globals.data(),module->globals.size(),globalNameToIndexMap,outErrors);
 
-		// Do a second pass that parses definitions as well.
+		// Do a second pass that parses definitions as well. The function bodies are only collected here, and parsed after the other
+		// definitions. Each definition records errors in its own list, so the errors can be merged in the order of the definitions.
+		struct FunctionBody
+		{
+			Function* function;
+			SNodeIt bodyNodeIt;
+			uintptr_t definitionIndex;
+		};
+		std::vector<FunctionBody> functionBodies;
+		std::vector<std::vector<ErrorRecord*>> definitionErrors;
 		intptr_t currentFunctionIndex = 0;
 		for(auto nodeIt = firstModuleChildNode;nodeIt;++nodeIt)
 		{
@@ -1270,109 +1521,154 @@ namespace WebAssemblyText
 					{ break; }
 				};
 
-				// Parse the function's body.
-				auto function = module->functions[currentFunctionIndex++];
-				FunctionContext functionContext(*this,function);
-				function->expression = functionContext.parseExpressionSequence(function->type.returnType,childNodeIt,"function body");
+				functionBodies.push_back({module->functions[currentFunctionIndex++],childNodeIt,definitionErrors.size()});
+				definitionErrors.emplace_back();
 			}
 			else if(parseTaggedNode(nodeIt,Symbol::_export,childNodeIt))
 			{
 				// Parse an export definition.
+				definitionErrors.emplace_back();
+				auto& exportErrors = definitionErrors.back();
 				const char* exportName;
 				size_t nameLength;
 				if(!parseString(childNodeIt,exportName,nameLength,module->arena))
-					{ recordError<ErrorRecord>(outErrors,childNodeIt,"expected export name string"); continue; }
+					{ recordError<ErrorRecord>(exportErrors,childNodeIt,"expected export name string"); continue; }
 				uintptr_t functionIndex;
 				if(!parseNameOrIndex(childNodeIt,functionNameToIndexMap,module->functions.size(),functionIndex))
-					{ recordError<ErrorRecord>(outErrors,childNodeIt,"expected function name or index"); continue; }
-				module->exportNameToFunctionIndexMap[exportName] = functionIndex;
-				if(childNodeIt) { recordError<ErrorRecord>(outErrors,childNodeIt,"unexpected input following export declaration"); continue; }
+					{ recordError<ErrorRecord>(exportErrors,childNodeIt,"expected function name or index"); continue; }
+				if(!module->exports.add(exportName,functionIndex)) { recordError<ErrorRecord>(exportErrors,childNodeIt,"duplicate export name"); continue; }
+				if(childNodeIt) { recordError<ErrorRecord>(exportErrors,childNodeIt,"unexpected input following export declaration"); continue; }
 			}
 		}
+
+		// Parse the function bodies, which only read the module's declarations. Each thread allocates expressions from its own arena,
+		// and the arenas are transferred to the module once all the bodies are parsed.
+		const uintptr_t numBodyThreads = std::max<uintptr_t>(1,std::min<uintptr_t>(numThreads,functionBodies.size()));
+		std::unique_ptr<Memory::Arena[]> threadArenas(new Memory::Arena[numBodyThreads]);
+		Parallel::forEach(functionBodies.size(),numBodyThreads,[&](uintptr_t threadIndex,uintptr_t bodyIndex)
+		{
+			const FunctionBody& functionBody = functionBodies[bodyIndex];
+			FunctionContext functionContext(*this,functionBody.function,threadArenas[threadIndex],definitionErrors[functionBody.definitionIndex]);
+			functionBody.function->expression = functionContext.parseExpressionSequence(functionBody.function->type->returnType,functionBody.bodyNodeIt,"function body");
+		});
+		for(uintptr_t threadIndex = 0;threadIndex < numBodyThreads;++threadIndex) { module->arena.absorb(threadArenas[threadIndex]); }
+
+		for(auto& errors : definitionErrors) { outErrors.insert(outErrors.end(),errors.begin(),errors.end()); }
 		
 		return module;
 	}
 
+	// Parses an assert_eq node. The assertion may invoke an export of any of the modules.
+	bool parseAssertEq(SNodeIt rootNodeIt,SNodeIt childNodeIt,const std::vector<Module*>& modules,std::vector<ErrorRecord*>& outErrors,AssertEq& outAssertEq)
+	{
+		Memory::ScopedArena scopedArena;
+
+		SNodeIt invokeChildIt;
+		if(!parseTaggedNode(childNodeIt++,Symbol::_invoke,invokeChildIt))
+			{ recordError<ErrorRecord>(outErrors,childNodeIt,"expected invoke expression"); return false; }
+
+		// Parse the export name to invoke.
+		const char* invokeExportName;
+		size_t invokeExportNameLength;
+		SNodeIt savedExportNameIt = invokeChildIt;
+		if(!parseString(invokeChildIt,invokeExportName,invokeExportNameLength,scopedArena))
+			{ recordError<ErrorRecord>(outErrors,invokeChildIt,"expected export name string"); return false; }
+
+		// Find the named export in one of the modules.
+		Module* exportModule = nullptr;
+		uintptr_t exportFunctionIndex = 0;
+		for(auto module : modules)
+		{
+			auto export_ = module->exports.get(invokeExportName);
+			if(export_)
+			{
+				exportModule = module;
+				exportFunctionIndex = export_->functionIndex;
+				break;
+			}
+		}
+		if(!exportModule) { recordError<ErrorRecord>(outErrors,savedExportNameIt,"couldn't find export with this name"); return false; }
+
+		// Set up a dummy module, function, and parsing context to parse the invoke parameters in.
+		Module* dummyModule = new AST::Module;
+		Function dummyFunction;
+		ModuleContext dummyModuleContext(dummyModule,outErrors);
+		FunctionContext dummyFunctionContext(dummyModuleContext,&dummyFunction);
+
+		// Parse the invoke's parameters.
+		auto function = exportModule->functions[exportFunctionIndex];
+		std::vector<TypedExpression> parameters(function->type->parameters.size());
+		for(uintptr_t parameterIndex = 0;parameterIndex < function->type->parameters.size();++parameterIndex)
+		{
+			auto parameterType = function->type->parameters[parameterIndex];
+			auto parameterValue = dummyFunctionContext.parseTypedExpression(parameterType,invokeChildIt,"invoke parameter");
+			parameters[parameterIndex] = TypedExpression(parameterValue,parameterType);
+		}
+		
+		// Verify that all of the invoke's parameters were matched.
+		if(invokeChildIt) { recordExcessInputError<ErrorRecord>(outErrors,invokeChildIt,"invoke parameters"); return false; }
+
+		// Parse the expected value of the invoke.
+		auto returnType = function->type->returnType;
+		auto value = TypedExpression(dummyFunctionContext.parseTypedExpression(returnType,childNodeIt,"assert_eq reference value"),returnType);
+		
+		// Verify that all of the invoke's parameters were matched.
+		if(childNodeIt) { recordExcessInputError<ErrorRecord>(outErrors,childNodeIt,"assert_eq expected value"); return false; }
+
+		outAssertEq = {dummyModule,exportModule,exportFunctionIndex,std::move(parameters),value,rootNodeIt->startOffset};
+		return true;
+	}
+
 	// Parses a module from a WAST string.
-	bool parse(const char* string,File& outFile)
+	bool parse(const char* string,File& outFile,uintptr_t numThreads)
 	{
 		const SExp::SymbolIndexMap& symbolIndexMap = getWASTSymbolIndexMap();
 		
 		// Parse S-expressions from the string.
 		Memory::ScopedArena scopedArena;
 		auto rootNode = SExp::parse(string,scopedArena,symbolIndexMap);
+		outFile.sourceLocator = std::make_shared<SExp::SourceLocator>(string);
 		
-		// Parse modules from S-expressions.
-		for(auto rootNodeIt = SNodeIt(rootNode);rootNodeIt;++rootNodeIt)
+		// Find the module definitions and assertions.
+		std::vector<SNodeIt> moduleNodeIts;
+		std::vector<std::pair<SNodeIt,SNodeIt>> assertEqNodeIts;
+		for(auto rootNodeIt = SNodeIt(rootNode,outFile.sourceLocator.get());rootNodeIt;++rootNodeIt)
 		{
 			SNodeIt childNodeIt;
-			if(parseTaggedNode(rootNodeIt,Symbol::_module,childNodeIt))
-			{
-				// Parse a module definition.
-				outFile.modules.push_back(ModuleContext(new Module(),outFile.errors).parse(childNodeIt));
-			}
+			if(parseTaggedNode(rootNodeIt,Symbol::_module,childNodeIt)) { moduleNodeIts.push_back(childNodeIt); }
+			else if(parseTaggedNode(rootNodeIt,Symbol::_assert_eq,childNodeIt)) { assertEqNodeIts.push_back(std::make_pair(rootNodeIt,childNodeIt)); }
+			else if(rootNodeIt->type == SExp::NodeType::Error) { recordError<ErrorRecord>(outFile.errors,rootNodeIt,"S-expression parse error"); }
+		}
+
+		// Parse the modules, which are independent of each other. Each module allocates from its own arena, and records errors in
+		// its own list, so they may be parsed on different threads. The results are merged in the order they occur in the file.
+		std::vector<Module*> modules(moduleNodeIts.size());
+		std::vector<std::vector<ErrorRecord*>> moduleErrors(moduleNodeIts.size());
+		// The threads are divided between the modules, and each module uses its share to parse its function bodies in parallel.
+		const uintptr_t numThreadsPerModule = std::max<uintptr_t>(1,numThreads / std::max<uintptr_t>(1,moduleNodeIts.size()));
+		Parallel::forEach(moduleNodeIts.size(),numThreads,[&](uintptr_t,uintptr_t moduleIndex)
+		{
+			modules[moduleIndex] = ModuleContext(new Module(),moduleErrors[moduleIndex],numThreadsPerModule).parse(moduleNodeIts[moduleIndex]);
+		});
+		for(uintptr_t moduleIndex = 0;moduleIndex < modules.size();++moduleIndex)
+		{
+			outFile.modules.push_back(modules[moduleIndex]);
+			outFile.errors.insert(outFile.errors.end(),moduleErrors[moduleIndex].begin(),moduleErrors[moduleIndex].end());
 		}
 		
-		// Parse the assertions.
-		for(auto rootNodeIt = SNodeIt(rootNode);rootNodeIt;++rootNodeIt)
+		// Parse the assertions, which only read from the modules.
+		std::vector<AssertEq> assertEqs(assertEqNodeIts.size());
+		std::vector<uint8> assertEqIsValid(assertEqNodeIts.size());
+		std::vector<std::vector<ErrorRecord*>> assertEqErrors(assertEqNodeIts.size());
+		Parallel::forEach(assertEqNodeIts.size(),numThreads,[&](uintptr_t,uintptr_t assertEqIndex)
 		{
-			SNodeIt childNodeIt;
-			if(parseTaggedNode(rootNodeIt,Symbol::_assert_eq,childNodeIt))
-			{
-				SNodeIt invokeChildIt;
-				if(!parseTaggedNode(childNodeIt++,Symbol::_invoke,invokeChildIt))
-					{ recordError<ErrorRecord>(outFile.errors,childNodeIt,"expected invoke expression"); continue; }
-
-				// Parse the export name to invoke.
-				const char* invokeExportName;
-				size_t invokeExportNameLength;
-				SNodeIt savedExportNameIt = invokeChildIt;
-				if(!parseString(invokeChildIt,invokeExportName,invokeExportNameLength,scopedArena))
-					{ recordError<ErrorRecord>(outFile.errors,invokeChildIt,"expected export name string"); continue; }
-
-				// Find the named export in one of the modules.
-				Module* exportModule = nullptr;
-				uintptr_t exportFunctionIndex = 0;
-				for(auto module : outFile.modules)
-				{
-					auto exportIt = module->exportNameToFunctionIndexMap.find(invokeExportName);
-					if(exportIt != module->exportNameToFunctionIndexMap.end())
-					{
-						exportModule = module;
-						exportFunctionIndex = exportIt->second;
-						break;
-					}
-				}
-				if(!exportModule) { recordError<ErrorRecord>(outFile.errors,savedExportNameIt,"couldn't find export with this name"); continue; }
-
-				// Set up a dummy module, function, and parsing context to parse the invoke parameters in.
-				Module* dummyModule = new AST::Module;
-				Function dummyFunction;
-				ModuleContext dummyModuleContext(dummyModule,outFile.errors);
-				FunctionContext dummyFunctionContext(dummyModuleContext,&dummyFunction);
-
-				// Parse the invoke's parameters.
-				auto function = exportModule->functions[exportFunctionIndex];
-				std::vector<TypedExpression> parameters(function->type.parameters.size());
-				for(uintptr_t parameterIndex = 0;parameterIndex < function->type.parameters.size();++parameterIndex)
-				{
-					auto parameterType = function->type.parameters[parameterIndex];
-					auto parameterValue = dummyFunctionContext.parseTypedExpression(parameterType,invokeChildIt,"invoke parameter");
-					parameters[parameterIndex] = TypedExpression(parameterValue,parameterType);
-				}
-				
-				// Verify that all of the invoke's parameters were matched.
-				if(invokeChildIt) { recordExcessInputError<ErrorRecord>(outFile.errors,invokeChildIt,"invoke parameters"); continue; }
-
-				// Parse the expected value of the invoke.
-				auto returnType = function->type.returnType;
-				auto value = TypedExpression(dummyFunctionContext.parseTypedExpression(returnType,childNodeIt,"assert_eq reference value"),returnType);
-				
-				// Verify that all of the invoke's parameters were matched.
-				if(childNodeIt) { recordExcessInputError<ErrorRecord>(outFile.errors,childNodeIt,"assert_eq expected value"); continue; }
-
-				outFile.assertEqs.push_back({dummyModule,exportModule,exportFunctionIndex,std::move(parameters),value,rootNodeIt->startLocus});
-			}
+			const auto& nodeIts = assertEqNodeIts[assertEqIndex];
+			assertEqIsValid[assertEqIndex] = parseAssertEq(nodeIts.first,nodeIts.second,outFile.modules,assertEqErrors[assertEqIndex],assertEqs[assertEqIndex]);
+		});
+		for(uintptr_t assertEqIndex = 0;assertEqIndex < assertEqs.size();++assertEqIndex)
+		{
+			if(assertEqIsValid[assertEqIndex]) { outFile.assertEqs.push_back(std::move(assertEqs[assertEqIndex])); }
+			outFile.errors.insert(outFile.errors.end(),assertEqErrors[assertEqIndex].begin(),assertEqErrors[assertEqIndex].end());
 		}
 
 		return !outFile.errors.size();
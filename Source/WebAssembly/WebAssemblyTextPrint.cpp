@@ -130,6 +130,16 @@ namespace WebAssemblyText
 		SNodeOutputStream createTaggedSubtree(Symbol symbol) { auto subtree = createSubtree(); subtree << symbol; return subtree; }
 		SNodeOutputStream createTypedTaggedSubtree(TypeId type,Symbol symbol) { auto subtree = createSubtree(); subtree << getTypedSymbol(type,symbol); return subtree; }
 		SNodeOutputStream createBitypedTaggedSubtree(TypeId leftType,Symbol symbol,TypeId rightType) { auto subtree = createSubtree(); subtree << getBitypedSymbol(leftType,symbol,rightType); return subtree; }
+		SNodeOutputStream createLaneTypedTaggedSubtree(TypeId laneType,Symbol symbol) { auto subtree = createSubtree(); subtree << getLaneTypedSymbol(laneType,symbol); return subtree; }
+
+		// Creates a subtree for a load or store. If the op doesn't have the natural alignment of its memory type, its symbol has an alignment suffix: e.g. i32.load/1.
+		SNodeOutputStream createMemoryOpTaggedSubtree(TypeId type,Symbol symbol,TypeId memoryType,uint8 alignmentLog2)
+		{
+			if(alignmentLog2 == getNaturalAlignmentLog2(memoryType)) { return createTypedTaggedSubtree(type,symbol); }
+			auto subtree = createSubtree();
+			subtree << std::string(wastSymbols[(uintptr_t)getTypedSymbol(type,symbol)]) + "/" + std::to_string(uint64(1) << alignmentLog2);
+			return subtree;
+		}
 
 		SNodeOutputStream printFunction(uintptr_t functionIndex);
 		SNodeOutputStream print();
@@ -193,6 +203,15 @@ namespace WebAssemblyText
 			//else { return createTypedTaggedSubtree(TypeId::F64,Symbol::_const) << literal->value; }
 		}
 
+		DispatchResult visitLiteral(const Literal<V128Type>* literal)
+		{
+			// Output V128 literals as I32 lanes, so they round-trip exactly.
+			auto subtree = createTypedTaggedSubtree(TypeId::V128,Symbol::_const);
+			subtree << TypeId::I32;
+			for(uintptr_t laneIndex = 0;laneIndex < 4;++laneIndex) { subtree << literal->value.u32[laneIndex]; }
+			return subtree;
+		}
+
 		template<typename Class>
 		DispatchResult visitError(TypeId type,const Error<Class>* error)
 		{
@@ -222,7 +241,7 @@ namespace WebAssemblyText
 		DispatchResult visitLoad(TypeId type,const Load<Class>* load,OpAsType)
 		{
 			assert(load->memoryType == type);
-			return createTypedTaggedSubtree(type,getOpSymbol(load->op()))
+			return createMemoryOpTaggedSubtree(type,getOpSymbol(load->op()),load->memoryType,load->alignmentLog2)
 				<< dispatch(*this,load->address,load->isFarAddress ? TypeId::I64 : TypeId::I32);
 		}
 		template<typename OpAsType>
@@ -235,14 +254,14 @@ namespace WebAssemblyText
 			case TypeId::I16: symbol = load->op() == IntOp::loadSExt ? Symbol::_load16_s : Symbol::_load16_u; break;
 			default:;
 			}
-			return createTypedTaggedSubtree(type,symbol)
+			return createMemoryOpTaggedSubtree(type,symbol,load->memoryType,load->alignmentLog2)
 				<< dispatch(*this,load->address,load->isFarAddress ? TypeId::I64 : TypeId::I32);
 		}
 		template<typename Class>
 		DispatchResult visitStore(const Store<Class>* store)
 		{
 			assert(store->memoryType == store->value.type);
-			return createTypedTaggedSubtree(store->value.type,getOpSymbol(store->op()))
+			return createMemoryOpTaggedSubtree(store->value.type,getOpSymbol(store->op()),store->memoryType,store->alignmentLog2)
 				<< dispatch(*this,store->address,store->isFarAddress ? TypeId::I64 : TypeId::I32)
 				<< dispatch(*this,store->value);
 		}
@@ -255,7 +274,7 @@ namespace WebAssemblyText
 			case TypeId::I16: symbol = Symbol::_store16; break;
 			default:;
 			}
-			return createTypedTaggedSubtree(store->value.type,symbol)
+			return createMemoryOpTaggedSubtree(store->value.type,symbol,store->memoryType,store->alignmentLog2)
 				<< dispatch(*this,store->address,store->isFarAddress ? TypeId::I64 : TypeId::I32)
 				<< dispatch(*this,store->value);
 		}
@@ -284,9 +303,9 @@ namespace WebAssemblyText
 			auto functionName = call->op() == AnyOp::callDirect ? getFunctionName(call->functionIndex) : getFunctionImportName(call->functionIndex);
 			auto functionType = call->op() == AnyOp::callDirect ? module->functions[call->functionIndex]->type : module->functionImports[call->functionIndex].type;
 			subtreeStream << functionName;
-			for(uintptr_t parameterIndex = 0;parameterIndex < functionType.parameters.size();++parameterIndex)
+			for(uintptr_t parameterIndex = 0;parameterIndex < functionType->parameters.size();++parameterIndex)
 			{
-				subtreeStream << dispatch(*this,call->parameters[parameterIndex],functionType.parameters[parameterIndex]);
+				subtreeStream << dispatch(*this,call->parameters[parameterIndex],functionType->parameters[parameterIndex]);
 			}
 			return subtreeStream;
 		}
@@ -296,9 +315,9 @@ namespace WebAssemblyText
 				<< getFunctionTableName(callIndirect->tableIndex)
 				<< dispatch(*this,callIndirect->functionIndex,TypeId::I32);
 			auto functionType = module->functionTables[callIndirect->tableIndex].type;
-			for(uintptr_t parameterIndex = 0;parameterIndex < functionType.parameters.size();++parameterIndex)
+			for(uintptr_t parameterIndex = 0;parameterIndex < functionType->parameters.size();++parameterIndex)
 			{
-				subtreeStream << dispatch(*this,callIndirect->parameters[parameterIndex],functionType.parameters[parameterIndex]);
+				subtreeStream << dispatch(*this,callIndirect->parameters[parameterIndex],functionType->parameters[parameterIndex]);
 			}
 			return subtreeStream;
 		}
@@ -357,7 +376,7 @@ namespace WebAssemblyText
 		DispatchResult visitReturn(TypeId type,const Return<Class>* ret)
 		{
 			auto subtreeStream = createTaggedSubtree(Symbol::_return);
-			if(function->type.returnType != TypeId::Void) { subtreeStream << dispatch(*this,ret->value,function->type.returnType); }
+			if(function->type->returnType != TypeId::Void) { subtreeStream << dispatch(*this,ret->value,function->type->returnType); }
 			return subtreeStream;
 		}
 		template<typename Class>
@@ -393,14 +412,66 @@ namespace WebAssemblyText
 		{
 			return dispatch(*this,discardResult->expression);
 		}
+		DispatchResult visitBulkMemory(const BulkMemory* bulkMemory)
+		{
+			return createTaggedSubtree(getOpSymbol(bulkMemory->op()))
+				<< dispatch(*this,bulkMemory->destAddress,TypeId::I32)
+				<< dispatch(*this,bulkMemory->source,TypeId::I32)
+				<< dispatch(*this,bulkMemory->numBytes,TypeId::I32);
+		}
+		template<typename OpAsType>
+		DispatchResult visitAtomic(TypeId type,const Atomic* atomic,OpAsType)
+		{
+			auto subtree = atomic->op() == IntOp::atomicWait || atomic->op() == IntOp::atomicNotify
+				? createTaggedSubtree(getOpSymbol(atomic->op()))
+				: createTypedTaggedSubtree(type,getOpSymbol(atomic->op()));
+			subtree << dispatch(*this,atomic->address,TypeId::I32);
+			if(atomic->operand) { subtree << dispatch(*this,atomic->operand,Atomic::getOperandType(atomic->op(),type)); }
+			if(atomic->replacement) { subtree << dispatch(*this,atomic->replacement,Atomic::getReplacementType(atomic->op(),type)); }
+			return subtree;
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneUnary(const LaneUnary* laneUnary,OpAsType)
+		{
+			return createLaneTypedTaggedSubtree(laneUnary->laneType,getOpSymbol(laneUnary->op())) << dispatch(*this,laneUnary->operand);
+		}
+		template<typename OpAsType>
+		DispatchResult visitLaneBinary(const LaneBinary* laneBinary,OpAsType)
+		{
+			return createLaneTypedTaggedSubtree(laneBinary->laneType,getOpSymbol(laneBinary->op()))
+				<< dispatch(*this,laneBinary->left)
+				<< dispatch(*this,laneBinary->right);
+		}
+		DispatchResult visitSplat(const Splat* splat)
+		{
+			return createLaneTypedTaggedSubtree(splat->scalar.type,Symbol::_splat_lanes) << dispatch(*this,splat->scalar);
+		}
+		template<typename Class>
+		DispatchResult visitExtractLane(TypeId type,const ExtractLane<Class>* extractLane)
+		{
+			return createLaneTypedTaggedSubtree(type,Symbol::_extract_lane_lanes) << extractLane->laneIndex << dispatch(*this,extractLane->vector);
+		}
+		DispatchResult visitReplaceLane(const ReplaceLane* replaceLane)
+		{
+			return createLaneTypedTaggedSubtree(replaceLane->scalar.type,Symbol::_replace_lane_lanes)
+				<< replaceLane->laneIndex
+				<< dispatch(*this,replaceLane->vector)
+				<< dispatch(*this,replaceLane->scalar);
+		}
+		DispatchResult visitShuffle(const Shuffle* shuffle)
+		{
+			auto subtree = createLaneTypedTaggedSubtree(shuffle->laneType,Symbol::_shuffle_lanes);
+			for(uintptr_t laneIndex = 0;laneIndex < getNumV128Lanes(shuffle->laneType);++laneIndex) { subtree << shuffle->laneIndices[laneIndex]; }
+			return subtree << dispatch(*this,shuffle->left) << dispatch(*this,shuffle->right);
+		}
 	};
 
 	SNodeOutputStream ModulePrintContext::printFunction(uintptr_t functionIndex)
 	{
 		// Before printing, lower the function's expressions into those supported by WAST.
-		Function loweredFunction = *module->functions[functionIndex];
+		Function loweredFunction(arena,*module->functions[functionIndex]);
 		LoweringVisitor loweringVisitor(arena,module,&loweredFunction);
-		loweredFunction.expression = loweringVisitor(TypedExpression(loweredFunction.expression,loweredFunction.type.returnType)).expression;
+		loweredFunction.expression = loweringVisitor(TypedExpression(loweredFunction.expression,loweredFunction.type->returnType)).expression;
 		
 		FunctionPrintContext functionContext(arena,module,&loweredFunction);
 		auto functionStream = createTaggedSubtree(Symbol::_func);
@@ -419,10 +490,10 @@ namespace WebAssemblyText
 		}
 
 		// Print the function return type.
-		if(loweredFunction.type.returnType != TypeId::Void)
+		if(loweredFunction.type->returnType != TypeId::Void)
 		{
 			auto resultStream = createTaggedSubtree(Symbol::_result);
-			resultStream << loweredFunction.type.returnType;
+			resultStream << loweredFunction.type->returnType;
 			functionStream << resultStream;
 		}
 
@@ -445,7 +516,7 @@ namespace WebAssemblyText
 		}
 
 		// Print the function's expression.
-		functionStream << dispatch(functionContext,loweredFunction.expression,loweredFunction.type.returnType);
+		functionStream << dispatch(functionContext,loweredFunction.expression,loweredFunction.type->returnType);
 
 		return functionStream;
 	}
@@ -484,13 +555,13 @@ namespace WebAssemblyText
 			importStream << SNodeOutputStream::StringAtom(import.name,strlen(import.name));
 
 			auto paramStream = createTaggedSubtree(Symbol::_param);
-			for(auto parameterType : import.type.parameters) { paramStream << parameterType; }
+			for(auto parameterType : import.type->parameters) { paramStream << parameterType; }
 			importStream << paramStream;
 
-			if(import.type.returnType != TypeId::Void)
+			if(import.type->returnType != TypeId::Void)
 			{
 				auto resultStream = createTaggedSubtree(Symbol::_result);
-				resultStream << import.type.returnType;
+				resultStream << import.type->returnType;
 				importStream << resultStream;
 			}
 			moduleStream << importStream;
@@ -522,11 +593,11 @@ namespace WebAssemblyText
 			moduleStream << tableStream;
 		}
 
-		// Print the module exports.
-		for(auto exportIt : module->exportNameToFunctionIndexMap)
+		// Print the module exports, in the order they were declared.
+		for(auto export_ : module->exports)
 		{
-			auto exportName = exportIt.first;
-			auto exportFunctionIndex = exportIt.second;
+			auto exportName = export_.name;
+			auto exportFunctionIndex = export_.functionIndex;
 			auto exportStream = createTaggedSubtree(Symbol::_export);
 			exportStream << SNodeOutputStream::StringAtom(exportName,strlen(exportName));
 			exportStream << getFunctionName(exportFunctionIndex);
@@ -561,4 +632,10 @@ namespace WebAssemblyText
 		Memory::ScopedArena scopedArena;
 		return SExp::print((SExp::Node*)ModulePrintContext(scopedArena,module).print().getRoot(),wastSymbols);
 	}
+
+	void print(const Module* module,Core::OutputBuffer& outputBuffer)
+	{
+		Memory::ScopedArena scopedArena;
+		SExp::print((SExp::Node*)ModulePrintContext(scopedArena,module).print().getRoot(),wastSymbols,outputBuffer);
+	}
 }
\ No newline at end of file
@@ -9,35 +9,41 @@ namespace WebAssemblyText
 	#define I64LowerCaseString "i64"
 	#define F32LowerCaseString "f32"
 	#define F64LowerCaseString "f64"
+	#define V128LowerCaseString "v128"
 	#define BoolLowerCaseString "bool"
 	#define VoidLowerCaseString "void"
 
+	// The names of the lane types of a V128, which are used as the prefix of the lane typed symbols.
+	#define I8LanesString "i8x16"
+	#define I16LanesString "i16x8"
+	#define I32LanesString "i32x4"
+	#define I64LanesString "i64x2"
+	#define F32LanesString "f32x4"
+	#define F64LanesString "f64x2"
+
 	// Declare an array, indexed by the symbol enum, containing the symbol string.
 	const char* wastSymbols[(size_t)Symbol::num] =
 	{
 		#define AST_TYPE(typeName,className,symbol) typeName##LowerCaseString "." #symbol,
 		#define AST_TYPE_PAIR(typeName1,typeName2,symbol) typeName1##LowerCaseString "." #symbol "/" typeName2##LowerCaseString,
+		#define AST_LANE_TYPE(typeName,className,symbol) typeName##LanesString "." #symbol,
 		#define WAST_SYMBOL(symbol) #symbol ,
 		#define TYPED_WAST_SYMBOL(symbol) #symbol , ENUM_AST_TYPES(AST_TYPE,symbol)
 		#define BITYPED_WAST_SYMBOL(symbol) #symbol , ENUM_AST_TYPE_PAIRS(AST_TYPE_PAIR,symbol)
+		#define LANE_TYPED_WAST_SYMBOL(symbol) "lanes." #symbol , ENUM_AST_TYPES_Numeric(AST_LANE_TYPE,symbol)
 		ENUM_OPCODE_SYMBOLS()
 		#undef AST_TYPE
 		#undef AST_TYPE_PAIR
+		#undef AST_LANE_TYPE
 		#undef WAST_SYMBOL
 		#undef TYPED_WAST_SYMBOL
 		#undef BITYPED_WAST_SYMBOL
+		#undef LANE_TYPED_WAST_SYMBOL
 	};
 
 	const SExp::SymbolIndexMap& getWASTSymbolIndexMap()
 	{
-		static bool isInitialized = false;
-		static SExp::SymbolIndexMap symbolIndexMap;
-		if(!isInitialized)
-		{
-			auto numSymbols = sizeof(wastSymbols) / sizeof(wastSymbols[0]);
-			for(uintptr_t symbolIndex = 0;symbolIndex < numSymbols;++symbolIndex) { symbolIndexMap[wastSymbols[symbolIndex]] = symbolIndex; }
-			isInitialized = true;
-		}
+		static const SExp::SymbolIndexMap symbolIndexMap(wastSymbols,sizeof(wastSymbols) / sizeof(wastSymbols[0]));
 		return symbolIndexMap;
 	}
 }
\ No newline at end of file
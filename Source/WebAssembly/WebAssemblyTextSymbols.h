@@ -40,6 +40,9 @@ namespace WebAssemblyText
 		WAST_SYMBOL(return) \
 		WAST_SYMBOL(block) \
 		WAST_SYMBOL(nop) \
+		WAST_SYMBOL(copy_memory) \
+		WAST_SYMBOL(move_memory) \
+		WAST_SYMBOL(fill_memory) \
 		WAST_SYMBOL(get_local) \
 		WAST_SYMBOL(load_global) \
 		WAST_SYMBOL(set_local) \
@@ -81,7 +84,18 @@ namespace WebAssemblyText
 		TYPED_WAST_SYMBOL(xor) \
 		TYPED_WAST_SYMBOL(shl) \
 		TYPED_WAST_SYMBOL(shr_s) \
-		TYPED_WAST_SYMBOL(shr_u)
+		TYPED_WAST_SYMBOL(shr_u) \
+		TYPED_WAST_SYMBOL(atomic_load) \
+		TYPED_WAST_SYMBOL(atomic_store) \
+		TYPED_WAST_SYMBOL(atomic_add) \
+		TYPED_WAST_SYMBOL(atomic_sub) \
+		TYPED_WAST_SYMBOL(atomic_and) \
+		TYPED_WAST_SYMBOL(atomic_or) \
+		TYPED_WAST_SYMBOL(atomic_xor) \
+		TYPED_WAST_SYMBOL(atomic_xchg) \
+		TYPED_WAST_SYMBOL(atomic_cmpxchg) \
+		WAST_SYMBOL(atomic_wait) \
+		WAST_SYMBOL(atomic_notify)
 
 	#define ENUM_WAST_FLOAT_OPCODE_SYMBOLS() \
 		TYPED_WAST_SYMBOL(ceil) \
@@ -115,6 +129,21 @@ namespace WebAssemblyText
 		TYPED_WAST_SYMBOL(gt) \
 		TYPED_WAST_SYMBOL(ge)
 
+	#define ENUM_WAST_V128_OPCODE_SYMBOLS() \
+		LANE_TYPED_WAST_SYMBOL(neg) \
+		LANE_TYPED_WAST_SYMBOL(abs) \
+		LANE_TYPED_WAST_SYMBOL(sqrt) \
+		LANE_TYPED_WAST_SYMBOL(add) \
+		LANE_TYPED_WAST_SYMBOL(sub) \
+		LANE_TYPED_WAST_SYMBOL(mul) \
+		LANE_TYPED_WAST_SYMBOL(div) \
+		LANE_TYPED_WAST_SYMBOL(min) \
+		LANE_TYPED_WAST_SYMBOL(max) \
+		LANE_TYPED_WAST_SYMBOL(splat) \
+		LANE_TYPED_WAST_SYMBOL(extract_lane) \
+		LANE_TYPED_WAST_SYMBOL(replace_lane) \
+		LANE_TYPED_WAST_SYMBOL(shuffle)
+
 	#define ENUM_WAST_TYPE_SYMBOLS() \
 		WAST_SYMBOL(typeBase) \
 		WAST_SYMBOL(i8) \
@@ -123,6 +152,7 @@ namespace WebAssemblyText
 		WAST_SYMBOL(i64) \
 		WAST_SYMBOL(f32) \
 		WAST_SYMBOL(f64) \
+		WAST_SYMBOL(v128) \
 		WAST_SYMBOL(bool) \
 		WAST_SYMBOL(void)
 
@@ -133,6 +163,7 @@ namespace WebAssemblyText
 		ENUM_WAST_INT_OPCODE_SYMBOLS() \
 		ENUM_WAST_FLOAT_OPCODE_SYMBOLS() \
 		ENUM_WAST_BOOL_OPCODE_SYMBOLS() \
+		ENUM_WAST_V128_OPCODE_SYMBOLS() \
 		ENUM_WAST_TYPE_SYMBOLS()
 
 	// Declare an enum with all the symbols used by WAST.
@@ -140,15 +171,19 @@ namespace WebAssemblyText
 	{
 		#define AST_TYPE(typeName,className,symbol) _##symbol##_##typeName,
 		#define AST_TYPE_PAIR(typeName1,typeName2,symbol) _##symbol##_##typeName1##_##typeName2,
+		#define AST_LANE_TYPE(typeName,className,symbol) _##symbol##_lanes_##typeName,
 		#define WAST_SYMBOL(symbol) _##symbol,
 		#define TYPED_WAST_SYMBOL(symbol) _##symbol, ENUM_AST_TYPES(AST_TYPE,symbol)
 		#define BITYPED_WAST_SYMBOL(symbol) _##symbol, ENUM_AST_TYPE_PAIRS(AST_TYPE_PAIR,symbol)
+		#define LANE_TYPED_WAST_SYMBOL(symbol) _##symbol##_lanes, ENUM_AST_TYPES_Numeric(AST_LANE_TYPE,symbol)
 		ENUM_OPCODE_SYMBOLS()
 		#undef AST_TYPE
 		#undef AST_TYPE_PAIR
+		#undef AST_LANE_TYPE
 		#undef WAST_SYMBOL
 		#undef TYPED_WAST_SYMBOL
 		#undef BITYPED_WAST_SYMBOL
+		#undef LANE_TYPED_WAST_SYMBOL
 		num
 	};
 
@@ -170,6 +205,13 @@ namespace WebAssemblyText
 		auto numEnumeratedTypes  = (uintptr_t)TypeId::num - 1;
 		return Symbol((uintptr_t)baseSymbol + 1 + leftTypeIndex + rightTypeIndex * numEnumeratedTypes);
 	}
+
+	// Returns the symbol for a V128 op on lanes of the given numeric type: e.g. i32x4.add.
+	inline Symbol getLaneTypedSymbol(TypeId laneType,Symbol baseSymbol)
+	{
+		assert(laneType != TypeId::None && laneType <= TypeId::F64);
+		return Symbol((uintptr_t)baseSymbol + (uintptr_t)laneType);
+	}
 	
 	template<typename Class>
 	Symbol getAnyOpSymbol(typename Class::Op op)
@@ -229,6 +271,18 @@ namespace WebAssemblyText
 		MAP_OP_SYMBOL(reinterpretFloat,reinterpret)
 		MAP_OP_SYMBOL(reinterpretBool,reinterpret)
 		MAP_OP_SYMBOL(lit,const)
+		MAP_OP_SYMBOL(atomicLoad,atomic_load)
+		MAP_OP_SYMBOL(atomicStore,atomic_store)
+		MAP_OP_SYMBOL(atomicAdd,atomic_add)
+		MAP_OP_SYMBOL(atomicSub,atomic_sub)
+		MAP_OP_SYMBOL(atomicAnd,atomic_and)
+		MAP_OP_SYMBOL(atomicOr,atomic_or)
+		MAP_OP_SYMBOL(atomicXor,atomic_xor)
+		MAP_OP_SYMBOL(atomicExchange,atomic_xchg)
+		MAP_OP_SYMBOL(atomicCompareExchange,atomic_cmpxchg)
+		MAP_OP_SYMBOL(atomicWait,atomic_wait)
+		MAP_OP_SYMBOL(atomicNotify,atomic_notify)
+		MAP_OP_SYMBOL(extractLane,extract_lane_lanes)
 		#undef MAP_OP_SYMBOL
 		default: return getAnyOpSymbol<IntClass>(op);
 		}
@@ -260,11 +314,40 @@ namespace WebAssemblyText
 		MAP_OP_SYMBOL(reinterpretInt,reinterpret)
 		MAP_OP_SYMBOL(lit,const)
 		MAP_OP_SYMBOL(sqrt,sqrt)
+		MAP_OP_SYMBOL(extractLane,extract_lane_lanes)
 		#undef MAP_OP_SYMBOL
 		default: return getAnyOpSymbol<FloatClass>(op);
 		}
 	}
 
+	// The symbols for the lane ops and splat, replaceLane, and shuffle are the base of the lane typed symbols.
+	inline Symbol getOpSymbol(V128Op op)
+	{
+		switch(op)
+		{
+		#define MAP_OP_SYMBOL(op,symbol) case V128Op::op: return Symbol::_##symbol;
+		MAP_OP_SYMBOL(bitwiseNot,not)
+		MAP_OP_SYMBOL(bitwiseAnd,and)
+		MAP_OP_SYMBOL(bitwiseOr,or)
+		MAP_OP_SYMBOL(bitwiseXor,xor)
+		MAP_OP_SYMBOL(neg,neg_lanes)
+		MAP_OP_SYMBOL(abs,abs_lanes)
+		MAP_OP_SYMBOL(sqrt,sqrt_lanes)
+		MAP_OP_SYMBOL(add,add_lanes)
+		MAP_OP_SYMBOL(sub,sub_lanes)
+		MAP_OP_SYMBOL(mul,mul_lanes)
+		MAP_OP_SYMBOL(div,div_lanes)
+		MAP_OP_SYMBOL(min,min_lanes)
+		MAP_OP_SYMBOL(max,max_lanes)
+		MAP_OP_SYMBOL(lit,const)
+		MAP_OP_SYMBOL(splat,splat_lanes)
+		MAP_OP_SYMBOL(replaceLane,replace_lane_lanes)
+		MAP_OP_SYMBOL(shuffle,shuffle_lanes)
+		#undef MAP_OP_SYMBOL
+		default: return getAnyOpSymbol<V128Class>(op);
+		}
+	}
+
 	inline Symbol getOpSymbol(BoolOp op)
 	{
 		switch(op)
@@ -298,6 +381,9 @@ namespace WebAssemblyText
 		{
 		#define MAP_OP_SYMBOL(op,symbol) case VoidOp::op: return Symbol::_##symbol;
 		MAP_OP_SYMBOL(nop,nop)
+		MAP_OP_SYMBOL(copyMemory,copy_memory)
+		MAP_OP_SYMBOL(moveMemory,move_memory)
+		MAP_OP_SYMBOL(fillMemory,fill_memory)
 		#undef MAP_OP_SYMBOL
 		default: return getAnyOpSymbol<VoidClass>(op);
 		}
@@ -0,0 +1,43 @@
+// Compares formatting with the host's vfprintf against formatting with printf compiled into the module.
+// Build the two variants with Emscripten, and pack their asm.js into the polyfill prototype's binary format:
+//   emcc -O2 Benchmark.cpp -o host.js
+//   emcc -O2 -DWASM_PRINTF Benchmark.cpp -o wasm.js
+//   pack-asmjs host.js host.wasm
+//   pack-asmjs wasm.js wasm.wasm
+// and compare the execution time Run prints for each:
+//   Run -binary host.wasm host.js.mem _main 2>/dev/null
+//   Run -binary wasm.wasm wasm.js.mem _main 2>/dev/null
+#include <stdio.h>
+#include <stdarg.h>
+
+static void formatLine(const char* format,...)
+{
+	va_list argList;
+	va_start(argList,format);
+	#ifdef WASM_PRINTF
+		// Format in the module with vsnprintf, and only pass the result to the host.
+		char buffer[256];
+		int numChars = vsnprintf(buffer,sizeof(buffer),format,argList);
+		fwrite(buffer,1,numChars < (int)sizeof(buffer) ? numChars : sizeof(buffer) - 1,stderr);
+	#else
+		// Pass the format string and arguments to the host's _vfprintf.
+		vfprintf(stderr,format,argList);
+	#endif
+	va_end(argList);
+}
+
+int main()
+{
+	static const char* names[] = {"alpha","beta","gamma","delta"};
+	enum { numLines = 1000000 };
+	unsigned int checksum = 0;
+	for(int lineIndex = 0;lineIndex < numLines;++lineIndex)
+	{
+		double value = lineIndex * 0.001;
+		formatLine("%8d %-6s %08x %10.4f %e %5.1f%%\n",lineIndex,names[lineIndex & 3],lineIndex * 2654435761u,value,value * value,(lineIndex % 1000) / 10.0);
+		checksum = checksum * 31 + lineIndex;
+	}
+	fflush(stderr);
+	printf("checksum: %u\n",checksum);
+	return 0;
+}
\ No newline at end of file